@@ -0,0 +1,163 @@
+// BKTree.c ... BK-tree over the words of an inverted index
+//
+// Every child of a node is labelled with its edit distance d(node, child).
+// For a query q at distance d from a node, any word within k of q lies
+// under a child labelled d-k .. d+k, so the other subtrees are skipped.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "BKTree.h"
+
+#define MAXWORD 100
+
+typedef struct BKNode *BKLink;
+
+typedef struct BKNode {
+    char *word;         // points into the inverted index
+    int dist;           // edit distance from the parent's word
+    BKLink child;       // first child
+    BKLink sibling;     // next child of the same parent
+} BKNode;
+
+typedef struct BKTreeRep {
+    BKLink root;
+    int nwords;
+} BKTreeRep;
+
+static void addWords (BKTree bk, InvertedIndexBST tree);
+static void insertWord (BKTree bk, char *word);
+static void dropNodes (BKLink n);
+static int search (BKLink n, char *word, int k, char *matches[], int max, int nfound);
+
+BKTree newBKTree (InvertedIndexBST tree) {
+    BKTree new = malloc (sizeof (*new));
+    assert(new != NULL);
+    new->root = NULL;
+    new->nwords = 0;
+    addWords (new, tree);
+    return new;
+}
+
+void dropBKTree (BKTree bk) {
+    if (bk == NULL) return;
+    dropNodes (bk->root);
+    free (bk);
+}
+
+int BKTreeSearch (BKTree bk, char *word, int k, char *matches[], int max) {
+    if (bk->root == NULL) return 0;
+    return search (bk->root, word, k, matches, max, 0);
+}
+
+TfIdfList retrieveFuzzy (InvertedIndexBST tree, BKTree bk, char *searchWords[], int k, int D) {
+    int n = 0, max = 64;
+    char **words = malloc ((max + 1) * sizeof (char *));
+    assert(words != NULL);
+    for (int i = 0; searchWords[i] != NULL; i++) {
+        int found = BKTreeSearch (bk, searchWords[i], k, &words[n], max - n);
+        if (n + found > max) {
+            // not enough room: grow and search again
+            while (n + found > max) max *= 2;
+            words = realloc (words, (max + 1) * sizeof (char *));
+            assert(words != NULL);
+            found = BKTreeSearch (bk, searchWords[i], k, &words[n], max - n);
+        }
+        // keep only the first appearance of each dictionary word
+        int end = n + found;
+        for (int j = n; j < end; j++) {
+            int dup = 0;
+            for (int m = 0; m < n && !dup; m++) dup = (words[m] == words[j]);
+            if (!dup) words[n++] = words[j];
+        }
+    }
+    words[n] = NULL;
+    TfIdfList result = retrieve (tree, words, D);
+    free (words);
+    return result;
+}
+
+int editDistance (char *s, char *t) {
+    int m = strlen (t);
+    int prev[MAXWORD + 1], curr[MAXWORD + 1];
+    assert(m <= MAXWORD);
+    for (int j = 0; j <= m; j++) prev[j] = j;
+    for (int i = 1; s[i - 1] != '\0'; i++) {
+        curr[0] = i;
+        for (int j = 1; j <= m; j++) {
+            int sub = prev[j - 1] + (s[i - 1] != t[j - 1]);
+            int del = prev[j] + 1;
+            int ins = curr[j - 1] + 1;
+            curr[j] = sub < del ? (sub < ins ? sub : ins) : (del < ins ? del : ins);
+        }
+        memcpy (prev, curr, (m + 1) * sizeof (int));
+    }
+    return prev[m];
+}
+
+// Helper: insert the index's words in order
+static void addWords (BKTree bk, InvertedIndexBST tree) {
+    if (tree == NULL) return;
+    addWords (bk, tree->left);
+    insertWord (bk, tree->word);
+    addWords (bk, tree->right);
+}
+
+// Helper: descend along children labelled with the distance to each node
+static void insertWord (BKTree bk, char *word) {
+    BKLink new = malloc (sizeof (*new));
+    assert(new != NULL);
+    *new = (BKNode) { .word = word, .dist = 0, .child = NULL, .sibling = NULL };
+    bk->nwords++;
+    if (bk->root == NULL) {
+        bk->root = new;
+        return;
+    }
+
+    BKLink n = bk->root;
+    while (1) {
+        int d = editDistance (word, n->word);
+        if (d == 0) {
+            // already present
+            free (new);
+            bk->nwords--;
+            return;
+        }
+        BKLink c = n->child;
+        while (c != NULL && c->dist != d) c = c->sibling;
+        if (c == NULL) {
+            new->dist = d;
+            new->sibling = n->child;
+            n->child = new;
+            return;
+        }
+        n = c;
+    }
+}
+
+static void dropNodes (BKLink n) {
+    while (n != NULL) {
+        BKLink next = n->sibling;
+        dropNodes (n->child);
+        free (n);
+        n = next;
+    }
+}
+
+// Helper: collect matches under n; nfound counts matches so far
+static int search (BKLink n, char *word, int k, char *matches[], int max, int nfound) {
+    int d = editDistance (word, n->word);
+    if (d <= k) {
+        if (nfound < max) matches[nfound] = n->word;
+        nfound++;
+    }
+    for (BKLink c = n->child; c != NULL; c = c->sibling) {
+        if (c->dist >= d - k && c->dist <= d + k) {
+            nfound = search (c, word, k, matches, max, nfound);
+        }
+    }
+    return nfound;
+}
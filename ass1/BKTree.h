@@ -0,0 +1,33 @@
+// BKTree.h ... BK-tree over the words of an inverted index
+//
+// Finds every dictionary word within edit distance k of a query word,
+// pruning by the triangle inequality instead of comparing with every word.
+
+#ifndef _BKTREE_GUARD
+#define _BKTREE_GUARD
+
+#include "invertedIndex.h"
+
+typedef struct BKTreeRep *BKTree;
+
+// build a BK-tree of every word in the index; it points at the index's words
+BKTree newBKTree (InvertedIndexBST tree);
+
+// free memory associated with the BK-tree (not the words)
+void dropBKTree (BKTree bk);
+
+/** Store up to max words within edit distance k of word in matches[].
+    Returns the total number of such words, which may be more than max.
+*/
+int BKTreeSearch (BKTree bk, char *word, int k, char *matches[], int max);
+
+/** Like retrieve, but each search word is replaced by all the dictionary
+    words within edit distance k of it.  Each dictionary word is counted
+    once, even if it is close to several search words.
+*/
+TfIdfList retrieveFuzzy (InvertedIndexBST tree, BKTree bk, char *searchWords[], int k, int D);
+
+// Levenshtein distance between two words
+int editDistance (char *s, char *t);
+
+#endif
@@ -0,0 +1,261 @@
+// BTree.c ... B-tree term dictionary for the inverted index
+//
+// Each node holds up to BTREE_MAXKEYS words.  The first 8 bytes of every
+// word are packed big-endian into prefix[], so comparing two prefixes as
+// integers gives the same answer as strcmp on those bytes; the separately
+// allocated word is only read when two prefixes are equal.  Nodes are
+// allocated on cache-line boundaries with prefix[] first, so a search
+// scans one or two lines per level instead of chasing a pointer per key.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "BTree.h"
+
+#define CACHE_LINE 64
+#define BTREE_MINDEG 8
+#define BTREE_MAXKEYS (2 * BTREE_MINDEG - 1)
+
+typedef struct BTreeNode *BLink;
+
+typedef struct BTreeNode {
+    Prefix prefix[BTREE_MAXKEYS];   // first 8 bytes of word[i], big-endian
+    int nkeys;
+    int leaf;
+    char *word[BTREE_MAXKEYS];
+    FileList files[BTREE_MAXKEYS];
+    BLink child[BTREE_MAXKEYS + 1];
+} BTreeNode;
+
+typedef struct BTreeRep {
+    BLink root;
+    int nterms;
+    size_t bytes;   // heap bytes held by nodes, words and FileLists
+} BTreeRep;
+
+static BLink newBNode (int leaf);
+static size_t nodeBytes (void);
+static FileList addPosting (BTree t, FileList head, char *filename);
+static void dropBNode (BLink n);
+static int keyCmp (Prefix kp, char *word, BLink n, int i);
+static void splitChild (BLink x, int i);
+static void walk (BLink n, void (*visit) (char *, FileList, void *), void *cl);
+static void printTerm (char *word, FileList files, void *cl);
+
+BTree newBTree (void) {
+    BTree new = malloc (sizeof (*new));
+    assert(new != NULL);
+    new->root = NULL;
+    new->nterms = 0;
+    new->bytes = sizeof (*new);
+    return new;
+}
+
+void dropBTree (BTree t) {
+    if (t == NULL) return;
+    dropBNode (t->root);
+    free (t);
+}
+
+void BTreeInsert (BTree t, char *word, char *filename) {
+    Prefix kp = packPrefix (word);
+    if (t->root == NULL) {
+        t->root = newBNode (1);
+        t->bytes += nodeBytes ();
+    }
+    // split a full root before descending, so every split has room above it
+    if (t->root->nkeys == BTREE_MAXKEYS) {
+        BLink s = newBNode (0);
+        s->child[0] = t->root;
+        splitChild (s, 0);
+        t->root = s;
+        t->bytes += 2 * nodeBytes ();
+    }
+
+    BLink n = t->root;
+    while (1) {
+        int i = 0;
+        int c = 1;
+        while (i < n->nkeys && (c = keyCmp (kp, word, n, i)) > 0) i++;
+        if (i < n->nkeys && c == 0) {
+            n->files[i] = addPosting (t, n->files[i], filename);
+            return;
+        }
+        if (n->leaf) {
+            int move = n->nkeys - i;
+            memmove (&n->prefix[i + 1], &n->prefix[i], move * sizeof (Prefix));
+            memmove (&n->word[i + 1], &n->word[i], move * sizeof (char *));
+            memmove (&n->files[i + 1], &n->files[i], move * sizeof (FileList));
+            n->prefix[i] = kp;
+            n->word[i] = malloc (strlen (word) + 1);
+            assert(n->word[i] != NULL);
+            strcpy (n->word[i], word);
+            n->files[i] = newFileList (filename);
+            n->nkeys++;
+            t->nterms++;
+            t->bytes += strlen (word) + 1 + sizeof (struct FileListNode) + 100;
+            return;
+        }
+        if (n->child[i]->nkeys == BTREE_MAXKEYS) {
+            splitChild (n, i);
+            t->bytes += nodeBytes ();
+            // the median of the child now sits at i
+            c = keyCmp (kp, word, n, i);
+            if (c == 0) {
+                n->files[i] = addPosting (t, n->files[i], filename);
+                return;
+            }
+            if (c > 0) i++;
+        }
+        n = n->child[i];
+    }
+}
+
+FileList BTreeFind (BTree t, char *word) {
+    Prefix kp = packPrefix (word);
+    BLink n = t->root;
+    while (n != NULL) {
+        int i = 0;
+        int c = 1;
+        while (i < n->nkeys && (c = keyCmp (kp, word, n, i)) > 0) i++;
+        if (i < n->nkeys && c == 0) return n->files[i];
+        if (n->leaf) return NULL;
+        n = n->child[i];
+    }
+    return NULL;
+}
+
+void BTreeWalk (BTree t, void (*visit) (char *word, FileList files, void *cl), void *cl) {
+    walk (t->root, visit, cl);
+}
+
+void BTreePrint (BTree t, FILE *fp) {
+    BTreeWalk (t, printTerm, fp);
+}
+
+int BTreeNumTerms (BTree t) {
+    return t->nterms;
+}
+
+size_t BTreeBytes (BTree t) {
+    return t->bytes;
+}
+
+int BTreeDepth (BTree t) {
+    int d = 0;
+    for (BLink n = t->root; n != NULL; n = n->leaf ? NULL : n->child[0]) d++;
+    return d;
+}
+
+// Helper: allocate an empty node on a cache-line boundary
+static BLink newBNode (int leaf) {
+    BLink new = aligned_alloc (CACHE_LINE, nodeBytes ());
+    assert(new != NULL);
+    new->nkeys = 0;
+    new->leaf = leaf;
+    return new;
+}
+
+// Helper: size of a node rounded up to whole cache lines
+static size_t nodeBytes (void) {
+    return (sizeof (BTreeNode) + CACHE_LINE - 1) / CACHE_LINE * CACHE_LINE;
+}
+
+// Helper: insertFilename, also counting the bytes of a new FileListNode
+static FileList addPosting (BTree t, FileList head, char *filename) {
+    for (FileList curr = head; curr != NULL; curr = curr->next) {
+        if (strcmp(filename, curr->filename) == 0) {
+            curr->tf++;
+            return head;
+        }
+    }
+    t->bytes += sizeof (struct FileListNode) + 100;
+    return insertFilename (head, filename);
+}
+
+// Helper: free a subtree together with its words and FileLists
+static void dropBNode (BLink n) {
+    if (n == NULL) return;
+    for (int i = 0; i < n->nkeys; i++) {
+        free (n->word[i]);
+        FileList curr = n->files[i];
+        while (curr != NULL) {
+            FileList next = curr->next;
+            free (curr->filename);
+            free (curr);
+            curr = next;
+        }
+    }
+    if (!n->leaf) {
+        for (int i = 0; i <= n->nkeys; i++) dropBNode (n->child[i]);
+    }
+    free (n);
+}
+
+Prefix packPrefix (char *word) {
+    Prefix p = 0;
+    int ended = 0;
+    for (int i = 0; i < 8; i++) {
+        unsigned char c = ended ? 0 : (unsigned char) word[i];
+        if (c == '\0') ended = 1;
+        p = (p << 8) | c;
+    }
+    return p;
+}
+
+// Helper: compare word (with prefix kp) against key i of node n, like strcmp
+static int keyCmp (Prefix kp, char *word, BLink n, int i) {
+    if (kp != n->prefix[i]) return (kp < n->prefix[i]) ? -1 : 1;
+    // equal prefixes that contain the terminator are equal words
+    if ((kp & 0xff) == 0) return 0;
+    return strcmp (word + 8, n->word[i] + 8);
+}
+
+// Helper: split the full child i of x, moving its median key up into x
+static void splitChild (BLink x, int i) {
+    BLink y = x->child[i];
+    BLink z = newBNode (y->leaf);
+    int t = BTREE_MINDEG;
+
+    z->nkeys = t - 1;
+    memcpy (z->prefix, &y->prefix[t], (t - 1) * sizeof (Prefix));
+    memcpy (z->word, &y->word[t], (t - 1) * sizeof (char *));
+    memcpy (z->files, &y->files[t], (t - 1) * sizeof (FileList));
+    if (!y->leaf) memcpy (z->child, &y->child[t], t * sizeof (BLink));
+    y->nkeys = t - 1;
+
+    int move = x->nkeys - i;
+    memmove (&x->child[i + 2], &x->child[i + 1], move * sizeof (BLink));
+    memmove (&x->prefix[i + 1], &x->prefix[i], move * sizeof (Prefix));
+    memmove (&x->word[i + 1], &x->word[i], move * sizeof (char *));
+    memmove (&x->files[i + 1], &x->files[i], move * sizeof (FileList));
+    x->child[i + 1] = z;
+    x->prefix[i] = y->prefix[t - 1];
+    x->word[i] = y->word[t - 1];
+    x->files[i] = y->files[t - 1];
+    x->nkeys++;
+}
+
+// Helper: in-order traversal
+static void walk (BLink n, void (*visit) (char *, FileList, void *), void *cl) {
+    if (n == NULL) return;
+    for (int i = 0; i < n->nkeys; i++) {
+        if (!n->leaf) walk (n->child[i], visit, cl);
+        visit (n->word[i], n->files[i], cl);
+    }
+    if (!n->leaf) walk (n->child[n->nkeys], visit, cl);
+}
+
+// Helper: print one line of the index
+static void printTerm (char *word, FileList files, void *cl) {
+    FILE *fp = cl;
+    fprintf(fp, "%s ", word);
+    for (FileList cur = files; cur != NULL; cur = cur->next) {
+        fprintf(fp, "%s ", cur->filename);
+    }
+    fprintf(fp, "\n");
+}
@@ -0,0 +1,49 @@
+// BTree.h ... B-tree term dictionary for the inverted index
+//
+// An alternative backend to InvertedIndexBST: wide nodes (one per few
+// cache lines) holding up to BTREE_MAXKEYS terms, with the first 8 bytes
+// of each term packed inline so most comparisons never touch the string.
+
+#ifndef _BTREE_GUARD
+#define _BTREE_GUARD
+
+#include <stdio.h>
+
+#include "invertedIndex.h"
+
+typedef struct BTreeRep *BTree;
+
+// the first 8 bytes of a word, packed so that they compare like strcmp
+typedef unsigned long long Prefix;
+
+// create an empty B-tree
+BTree newBTree (void);
+
+// free the B-tree, its words and their FileLists
+void dropBTree (BTree t);
+
+// add an occurrence of word in filename (same semantics as insertIntoBST)
+void BTreeInsert (BTree t, char *word, char *filename);
+
+// return the FileList for word, or NULL if it is not in the tree
+FileList BTreeFind (BTree t, char *word);
+
+// visit every word in ascending order
+void BTreeWalk (BTree t, void (*visit) (char *word, FileList files, void *cl), void *cl);
+
+// output the dictionary in the same format as printInvertedIndex
+void BTreePrint (BTree t, FILE *fp);
+
+// number of distinct words in the tree
+int BTreeNumTerms (BTree t);
+
+// heap bytes used by the tree, its words and FileLists
+size_t BTreeBytes (BTree t);
+
+// depth of the tree (number of node levels)
+int BTreeDepth (BTree t);
+
+// pack the first 8 bytes of word, zero padded, most significant first
+Prefix packPrefix (char *word);
+
+#endif
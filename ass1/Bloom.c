@@ -0,0 +1,140 @@
+// Bloom.c ... blocked Bloom filter over words
+//
+// The top half of a word's 64-bit hash picks one 512-bit block; k bit
+// positions inside that block come from the bottom half, stepped through
+// an LCG.  Taking both from the same bits would tie the choice of bits to
+// the choice of block whenever the number of blocks is even, and double
+// hashing modulo 512 makes the k positions of different words overlap
+// more than independent ones would.  The filter is sized for the rate
+// of the blocked filter, which is a little worse than an unblocked one.
+
+#include <assert.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Bloom.h"
+
+#define BLOCK_BITS 512
+#define BLOCK_WORDS (BLOCK_BITS / 64)
+#define LN2 0.69314718055994530942
+
+typedef struct BloomRep {
+    uint64_t *bits;     // nblocks * BLOCK_WORDS words, cache-line aligned
+    size_t nblocks;
+    int nhashes;        // bits set per word
+    int nitems;         // words added so far
+    double fpRate;      // requested false-positive rate
+} BloomRep;
+
+static uint64_t hashWord (char *word);
+static size_t blockOf (Bloom b, uint64_t h);
+static double blockedFp (int k, double wordsPerBlock);
+static uint32_t nextBit (uint32_t *x);
+
+Bloom newBloom (int nitems, double fpRate) {
+    assert(fpRate > 0 && fpRate < 1);
+    if (nitems < 1) nitems = 1;
+    Bloom new = malloc (sizeof (*new));
+    assert(new != NULL);
+
+    // optimal m/n = -ln p / (ln 2)^2, k = (m/n) ln 2
+    double bitsPerItem = -log (fpRate) / (LN2 * LN2);
+    double nbits = ceil (bitsPerItem * nitems);
+    new->nblocks = (size_t) ceil (nbits / BLOCK_BITS);
+    new->nhashes = (int) lround (bitsPerItem * LN2);
+    if (new->nhashes < 1) new->nhashes = 1;
+    // ... but some blocks get more than their share of words, so grow
+    // the filter until the blocked rate meets the target too
+    while (blockedFp (new->nhashes, (double) nitems / new->nblocks) > fpRate)
+        new->nblocks += new->nblocks / 32 + 1;
+    new->nitems = 0;
+    new->fpRate = fpRate;
+
+    new->bits = aligned_alloc (64, new->nblocks * BLOCK_WORDS * sizeof (uint64_t));
+    assert(new->bits != NULL);
+    for (size_t i = 0; i < new->nblocks * BLOCK_WORDS; i++) new->bits[i] = 0;
+    return new;
+}
+
+void dropBloom (Bloom b) {
+    if (b == NULL) return;
+    free (b->bits);
+    free (b);
+}
+
+void BloomAdd (Bloom b, char *word) {
+    uint64_t h = hashWord (word);
+    uint64_t *block = &b->bits[blockOf (b, h) * BLOCK_WORDS];
+    uint32_t x = (uint32_t) h;
+    for (int i = 0; i < b->nhashes; i++) {
+        uint32_t bit = nextBit (&x);
+        block[bit / 64] |= (uint64_t) 1 << (bit % 64);
+    }
+    b->nitems++;
+}
+
+int BloomMayContain (Bloom b, char *word) {
+    uint64_t h = hashWord (word);
+    uint64_t *block = &b->bits[blockOf (b, h) * BLOCK_WORDS];
+    uint32_t x = (uint32_t) h;
+    for (int i = 0; i < b->nhashes; i++) {
+        uint32_t bit = nextBit (&x);
+        if ((block[bit / 64] & ((uint64_t) 1 << (bit % 64))) == 0) return 0;
+    }
+    return 1;
+}
+
+size_t BloomBytes (Bloom b) {
+    return b->nblocks * BLOCK_WORDS * sizeof (uint64_t);
+}
+
+void BloomReport (Bloom b, FILE *fp) {
+    double m = (double) b->nblocks * BLOCK_BITS;
+    double expected = blockedFp (b->nhashes, (double) b->nitems / b->nblocks);
+    fprintf(fp, "bloom: %d words, %zu bytes (%.2f bits/word), %d hashes, "
+            "target fp %.4f, expected fp %.4f\n",
+            b->nitems, BloomBytes (b), m / (b->nitems > 0 ? b->nitems : 1),
+            b->nhashes, b->fpRate, expected);
+}
+
+// Helper: the block for hash h, from its top 32 bits, scaled onto
+// 0..nblocks-1 with a multiply rather than a modulus (fastrange)
+static size_t blockOf (Bloom b, uint64_t h) {
+    return (size_t) (((h >> 32) * (uint64_t) b->nblocks) >> 32);
+}
+
+// Helper: false-positive rate of k hashes into blocks holding
+// wordsPerBlock words on average; the words in a block are Poisson
+// distributed, and each block is a small unblocked filter
+static double blockedFp (int k, double wordsPerBlock) {
+    double fp = 0;
+    double p = exp (-wordsPerBlock);    // P(block has j words), from j = 0
+    int most = (int) (wordsPerBlock + 10 * sqrt (wordsPerBlock) + 10);
+    for (int j = 0; j <= most; j++) {
+        fp += p * pow (1 - pow (1 - 1.0 / BLOCK_BITS, (double) k * j), k);
+        p *= wordsPerBlock / (j + 1);
+    }
+    return fp;
+}
+
+// Helper: the next bit position in a block, from the top bits of a
+// 32-bit LCG seeded with the bottom half of the hash
+static uint32_t nextBit (uint32_t *x) {
+    *x = *x * 0x2C9277B5u + 0xAC564B05u;
+    return *x >> (32 - 9);  // BLOCK_BITS is 2^9
+}
+
+// Helper: FNV-1a with a final avalanche so both halves are usable
+static uint64_t hashWord (char *word) {
+    uint64_t h = 14695981039346656037ULL;
+    for (unsigned char *c = (unsigned char *) word; *c != '\0'; c++) {
+        h ^= *c;
+        h *= 1099511628211ULL;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
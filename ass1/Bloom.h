@@ -0,0 +1,32 @@
+// Bloom.h ... blocked Bloom filter over words
+//
+// Answers "definitely not present" or "maybe present".  All the bits for
+// one word live in a single 64-byte block, so a query touches one cache line.
+
+#ifndef _BLOOM_GUARD
+#define _BLOOM_GUARD
+
+#include <stddef.h>
+#include <stdio.h>
+
+typedef struct BloomRep *Bloom;
+
+// create a filter sized for nitems words at the given false-positive rate
+Bloom newBloom (int nitems, double fpRate);
+
+// free memory associated with the filter
+void dropBloom (Bloom b);
+
+// add a word to the filter
+void BloomAdd (Bloom b, char *word);
+
+// return 0 if word was never added, 1 if it may have been
+int BloomMayContain (Bloom b, char *word);
+
+// number of bytes used by the filter's bit array
+size_t BloomBytes (Bloom b);
+
+// print size, hash count and expected false-positive rate
+void BloomReport (Bloom b, FILE *fp);
+
+#endif
@@ -0,0 +1,244 @@
+// Compact.c ... a frozen, read-only struct-of-arrays copy of an index
+//
+// Two in-order walks of the tree: the first counts words, postings and
+// string bytes, the second fills the arrays, so each array is allocated
+// once at its final size.  Offsets and file numbers are 32 bits.
+//
+// compactReport counts both the bytes asked of malloc and what glibc's
+// malloc actually sets aside for them (an 8-byte header, rounded up to a
+// multiple of 16, at least 32), since the tree's cost is mostly in its
+// many small blocks.
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "BTree.h"
+#include "Compact.h"
+
+typedef struct CompactIndexRep {
+    int nwords;
+    char *wordPool;             // words, in order, each '\0'-terminated
+    uint32_t *wordOff;          // nwords offsets into wordPool
+    uint32_t *postOff;          // nwords + 1 offsets into files and tf
+    unsigned *files;            // file number of each posting
+    double *tf;
+    int nfiles;
+    char *namePool;             // filenames, in order
+    uint32_t *nameOff;          // nfiles offsets into namePool
+    size_t wordBytes, nameBytes, npostings;
+} CompactIndexRep;
+
+typedef struct Fill {
+    CompactIndex ci;
+    int w;
+    size_t word, post;
+} Fill;
+
+typedef struct Cost {
+    size_t asked;
+    size_t held;
+} Cost;
+
+static void addName (char *word, FileList files, void *cl);
+static void countTree (InvertedIndexBST t, CompactIndex ci);
+static void fillTree (InvertedIndexBST t, Fill *f);
+static unsigned findName (CompactIndex ci, char *filename);
+static size_t chunk (size_t n);
+static void treeCost (InvertedIndexBST t, Cost *nodes, Cost *words, Cost *posts, Cost *names);
+static void printRow (FILE *fp, char *what, size_t asked, size_t held);
+
+CompactIndex freezeInvertedIndex (InvertedIndexBST tree) {
+    CompactIndex new = calloc (1, sizeof (*new));
+    assert(new != NULL);
+
+    BTree names = newBTree ();
+    collectNames (names, tree);
+    new->nameOff = malloc ((BTreeNumTerms (names) + 1) * sizeof (uint32_t));
+    assert(new->nameOff != NULL);
+    BTreeWalk (names, addName, new);       // counts nfiles and nameBytes
+    new->namePool = malloc (new->nameBytes + 1);
+    assert(new->namePool != NULL);
+    new->nfiles = 0;
+    BTreeWalk (names, addName, new);       // now fills the pool
+    dropBTree (names);
+
+    countTree (tree, new);
+    new->wordPool = malloc (new->wordBytes + 1);
+    new->wordOff = malloc ((new->nwords + 1) * sizeof (uint32_t));
+    new->postOff = malloc ((new->nwords + 1) * sizeof (uint32_t));
+    new->files = malloc ((new->npostings + 1) * sizeof (unsigned));
+    new->tf = malloc ((new->npostings + 1) * sizeof (double));
+    assert(new->wordPool != NULL && new->wordOff != NULL && new->postOff != NULL
+        && new->files != NULL && new->tf != NULL);
+    Fill f = { new, 0, 0, 0 };
+    fillTree (tree, &f);
+    new->postOff[new->nwords] = f.post;
+    return new;
+}
+
+void dropCompactIndex (CompactIndex ci) {
+    if (ci == NULL) return;
+    free (ci->wordPool);
+    free (ci->wordOff);
+    free (ci->postOff);
+    free (ci->files);
+    free (ci->tf);
+    free (ci->namePool);
+    free (ci->nameOff);
+    free (ci);
+}
+
+int compactNumWords (CompactIndex ci) {
+    return ci->nwords;
+}
+
+int compactFind (CompactIndex ci, char *word) {
+    int lo = 0, hi = ci->nwords - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        int diff = strcmp(word, ci->wordPool + ci->wordOff[mid]);
+        if (diff == 0) return mid;
+        if (diff < 0) {
+            hi = mid - 1;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return -1;
+}
+
+char *compactWord (CompactIndex ci, int w) {
+    return ci->wordPool + ci->wordOff[w];
+}
+
+int compactPostings (CompactIndex ci, int w, unsigned **files, double **tf) {
+    *files = &ci->files[ci->postOff[w]];
+    *tf = &ci->tf[ci->postOff[w]];
+    return ci->postOff[w + 1] - ci->postOff[w];
+}
+
+char *compactFilename (CompactIndex ci, unsigned f) {
+    return ci->namePool + ci->nameOff[f];
+}
+
+void compactReport (CompactIndex ci, InvertedIndexBST tree, FILE *fp) {
+    Cost nodes = {0, 0}, words = {0, 0}, posts = {0, 0}, names = {0, 0};
+    treeCost (tree, &nodes, &words, &posts, &names);
+    fprintf(fp, "%-22s %14s %14s\n", "tree", "asked", "held");
+    printRow (fp, "InvertedIndexNodes", nodes.asked, nodes.held);
+    printRow (fp, "words (100 bytes)", words.asked, words.held);
+    printRow (fp, "FileListNodes", posts.asked, posts.held);
+    printRow (fp, "filenames (100 bytes)", names.asked, names.held);
+    size_t treeAsked = nodes.asked + words.asked + posts.asked + names.asked;
+    size_t treeHeld = nodes.held + words.held + posts.held + names.held;
+    printRow (fp, "total", treeAsked, treeHeld);
+
+    struct { char *what; size_t n; } part[] = {
+        { "header", sizeof (CompactIndexRep) },
+        { "word pool", ci->wordBytes + 1 },
+        { "word offsets", (ci->nwords + 1) * sizeof (uint32_t) },
+        { "posting offsets", (ci->nwords + 1) * sizeof (uint32_t) },
+        { "posting files", (ci->npostings + 1) * sizeof (unsigned) },
+        { "posting tf", (ci->npostings + 1) * sizeof (double) },
+        { "filename pool", ci->nameBytes + 1 },
+        { "filename offsets", (ci->nfiles + 1) * sizeof (uint32_t) },
+    };
+    int nparts = sizeof (part) / sizeof (part[0]);
+    size_t asked = 0, held = 0;
+    fprintf(fp, "%-22s %14s %14s\n", "compact", "asked", "held");
+    for (int i = 0; i < nparts; i++) {
+        printRow (fp, part[i].what, part[i].n, chunk (part[i].n));
+        asked += part[i].n;
+        held += chunk (part[i].n);
+    }
+    printRow (fp, "total", asked, held);
+    fprintf(fp, "%d words, %zu postings, %d files: compact is %.1f%% of the tree (held)\n",
+        ci->nwords, ci->npostings, ci->nfiles, treeHeld > 0 ? 100.0 * held / treeHeld : 0);
+}
+
+// Helper: BTreeWalk visitor; size the filename pool, or fill it once it exists
+static void addName (char *word, FileList files, void *cl) {
+    CompactIndex ci = cl;
+    if (ci->namePool == NULL) {
+        ci->nameOff[ci->nfiles++] = ci->nameBytes;
+        ci->nameBytes += strlen (word) + 1;
+    } else {
+        strcpy (ci->namePool + ci->nameOff[ci->nfiles++], word);
+    }
+}
+
+// Helper: count the words, postings and word bytes of the tree
+static void countTree (InvertedIndexBST t, CompactIndex ci) {
+    if (t == NULL) return;
+    countTree (t->left, ci);
+    ci->nwords++;
+    ci->wordBytes += strlen (t->word) + 1;
+    for (FileList curr = t->fileList; curr != NULL; curr = curr->next) ci->npostings++;
+    countTree (t->right, ci);
+}
+
+// Helper: copy the tree's words and postings into the arrays, in order
+static void fillTree (InvertedIndexBST t, Fill *f) {
+    if (t == NULL) return;
+    fillTree (t->left, f);
+    CompactIndex ci = f->ci;
+    ci->wordOff[f->w] = f->word;
+    strcpy (ci->wordPool + f->word, t->word);
+    f->word += strlen (t->word) + 1;
+    ci->postOff[f->w] = f->post;
+    for (FileList curr = t->fileList; curr != NULL; curr = curr->next) {
+        ci->files[f->post] = findName (ci, curr->filename);
+        ci->tf[f->post++] = curr->tf;
+    }
+    f->w++;
+    fillTree (t->right, f);
+}
+
+// Helper: binary search for a filename's number
+static unsigned findName (CompactIndex ci, char *filename) {
+    int lo = 0, hi = ci->nfiles - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        int diff = strcmp(filename, ci->namePool + ci->nameOff[mid]);
+        if (diff == 0) return mid;
+        if (diff < 0) {
+            hi = mid - 1;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    assert(0);
+    return 0;
+}
+
+// Helper: bytes glibc malloc holds for a request of n bytes
+static size_t chunk (size_t n) {
+    size_t size = (n + 8 + 15) & ~(size_t) 15;
+    return size < 32 ? 32 : size;
+}
+
+// Helper: add up the blocks the tree is made of (see newBST and newFileList)
+static void treeCost (InvertedIndexBST t, Cost *nodes, Cost *words, Cost *posts, Cost *names) {
+    if (t == NULL) return;
+    nodes->asked += sizeof (struct InvertedIndexNode);
+    nodes->held += chunk (sizeof (struct InvertedIndexNode));
+    words->asked += 100;
+    words->held += chunk (100);
+    for (FileList curr = t->fileList; curr != NULL; curr = curr->next) {
+        posts->asked += sizeof (struct FileListNode);
+        posts->held += chunk (sizeof (struct FileListNode));
+        names->asked += 100;
+        names->held += chunk (100);
+    }
+    treeCost (t->left, nodes, words, posts, names);
+    treeCost (t->right, nodes, words, posts, names);
+}
+
+static void printRow (FILE *fp, char *what, size_t asked, size_t held) {
+    fprintf(fp, "  %-20s %14zu %14zu\n", what, asked, held);
+}
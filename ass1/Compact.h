@@ -0,0 +1,40 @@
+// Compact.h ... a frozen, read-only struct-of-arrays copy of an index
+//
+// Words are kept in one string pool, in order, found by binary search
+// over an array of offsets.  Each word's postings are a range of two
+// parallel arrays (file number and tf), and filenames are another pool.
+// The copy does not share anything with the tree it was made from.
+
+#ifndef _COMPACT_GUARD
+#define _COMPACT_GUARD
+
+#include <stdio.h>
+
+#include "invertedIndex.h"
+
+typedef struct CompactIndexRep *CompactIndex;
+
+// make a compact copy of tree
+CompactIndex freezeInvertedIndex (InvertedIndexBST tree);
+
+void dropCompactIndex (CompactIndex ci);
+
+// number of words, and the number of the word (in word order), or -1
+int compactNumWords (CompactIndex ci);
+int compactFind (CompactIndex ci, char *word);
+
+// the text of word number w
+char *compactWord (CompactIndex ci, int w);
+
+/** Set *files and *tf to word w's postings, in filename order, and return
+    how many there are.  The arrays belong to the index.
+*/
+int compactPostings (CompactIndex ci, int w, unsigned **files, double **tf);
+
+// the name of file number f
+char *compactFilename (CompactIndex ci, unsigned f);
+
+// print the bytes used by each part of ci, and by the tree it came from
+void compactReport (CompactIndex ci, InvertedIndexBST tree, FILE *fp);
+
+#endif
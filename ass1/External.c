@@ -0,0 +1,361 @@
+// External.c ... bounded-memory (SPIMI) index build for large collections
+//
+// Single-pass in-memory indexing: postings for the files read so far are
+// collected in a BTree dictionary; when its byte count reaches the budget
+// the dictionary is written in word order as a run file and emptied.
+// Run lines hold raw occurrence counts ("word file count ..."), because a
+// file's word total is only known once the whole file has been read.
+// The runs are then k-way merged with a min-heap on the current word of
+// each run, and the counts turned into relative tf as the index is written.
+// At most MAXFANIN runs are open at once: while there are more, groups of
+// them are merged into longer runs (still holding counts) first.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "BTree.h"
+#include "External.h"
+
+#define MAXNAME 100
+#define MAXFANIN 16     // runs merged at once
+
+typedef struct Doc {
+    char *name;
+    long nwords;
+} Doc;
+
+typedef struct Run {
+    FILE *fp;
+    char *line;     // current line, split in place by nextLine
+    size_t cap;
+    char *word;     // first token of line
+    char *rest;     // the "file count ..." pairs after it
+} Run;
+
+typedef struct Posting {
+    char *file;
+    long count;
+} Posting;
+
+static int flushRun (BTree dict, char *indexFilename, int nrun);
+static void writeRunTerm (char *word, FileList files, void *cl);
+static char *runName (char *indexFilename, int nrun);
+static int mergeInto (char *indexFilename, int lo, int hi, Doc *docs, int ndocs, char *outName);
+static int nextLine (Run *r);
+static void mergeRuns (Run *runs, int nruns, Doc *docs, int ndocs, FILE *out);
+static void heapPush (int *heap, int *n, Run *runs, int r);
+static int heapPop (int *heap, int *n, Run *runs);
+static int cmpDoc (const void *a, const void *b);
+static int cmpPosting (const void *a, const void *b);
+
+int generateInvertedIndexExternal (char *collectionFilename, char *indexFilename, size_t memBudget) {
+    FILE *fp = fopen(collectionFilename, "r");
+    if (fp == NULL) return -1;
+
+    char file_name[MAXNAME];
+    char word[MAXNAME];
+    int ndocs = 0, maxdocs = 16, nruns = 0;
+    Doc *docs = malloc (maxdocs * sizeof (Doc));
+    assert(docs != NULL);
+    BTree dict = newBTree ();
+
+    int ok = 1;
+    while (ok && fscanf(fp, "%99s", file_name) != EOF) {
+        FILE *txt = fopen (file_name, "r");
+        if (txt == NULL) continue;
+        long nwords = 0;
+        while (fscanf(txt, "%99s", word) != EOF) {
+            nwords++;
+            // a word that normalises to "" (e.g. ".") would make a run
+            // line, and so an index line, with no word at its start
+            if (normaliseWord (word)[0] == '\0') continue;
+            BTreeInsert (dict, word, file_name);
+            if (BTreeBytes (dict) >= memBudget) {
+                ok = flushRun (dict, indexFilename, nruns++);
+                dropBTree (dict);
+                dict = newBTree ();
+                if (!ok) break;
+            }
+        }
+        fclose (txt);
+
+        if (ndocs == maxdocs) {
+            maxdocs *= 2;
+            docs = realloc (docs, maxdocs * sizeof (Doc));
+            assert(docs != NULL);
+        }
+        docs[ndocs].name = malloc (strlen (file_name) + 1);
+        assert(docs[ndocs].name != NULL);
+        strcpy (docs[ndocs].name, file_name);
+        docs[ndocs].nwords = nwords;
+        ndocs++;
+    }
+    fclose (fp);
+    if (ok && BTreeNumTerms (dict) > 0) ok = flushRun (dict, indexFilename, nruns++);
+    dropBTree (dict);
+
+    // word totals are looked up by name during the merge
+    qsort (docs, ndocs, sizeof (Doc), cmpDoc);
+
+    // runs first .. nruns - 1 are still to be merged; new runs are numbered on
+    int first = 0;
+    while (ok && nruns - first > MAXFANIN) {
+        int last = nruns;
+        for (int lo = first; ok && lo < last; lo += MAXFANIN) {
+            int hi = (lo + MAXFANIN < last) ? lo + MAXFANIN : last;
+            char *name = runName (indexFilename, nruns++);
+            ok = mergeInto (indexFilename, lo, hi, NULL, 0, name);
+            free (name);
+        }
+        first = last;
+    }
+    if (ok) ok = mergeInto (indexFilename, first, nruns, docs, ndocs, indexFilename);
+
+    // after an error, some runs may not have been merged (and removed) yet
+    for (int i = 0; !ok && i < nruns; i++) {
+        char *name = runName (indexFilename, i);
+        remove (name);
+        free (name);
+    }
+    for (int i = 0; i < ndocs; i++) free (docs[i].name);
+    free (docs);
+    return ok ? ndocs : -1;
+}
+
+InvertedIndexBST loadInvertedIndex (char *indexFilename) {
+    FILE *fp = fopen (indexFilename, "r");
+    if (fp == NULL) return NULL;
+
+    int n = 0, max = 1024;
+    InvertedIndexBST *nodes = malloc (max * sizeof (InvertedIndexBST));
+    assert(nodes != NULL);
+    char *line = NULL;
+    size_t cap = 0;
+    while (getline (&line, &cap, fp) != -1) {
+        char *save;
+        char *word = strtok_r (line, " \n", &save);
+        char *file = strtok_r (NULL, " \n", &save);
+        char *tf = strtok_r (NULL, " \n", &save);
+        if (word == NULL || file == NULL || tf == NULL) continue;
+
+        InvertedIndexBST new = newBST (word, file);
+        new->fileList->tf = atof (tf);
+        FileList last = new->fileList;
+        while ((file = strtok_r (NULL, " \n", &save)) != NULL
+                && (tf = strtok_r (NULL, " \n", &save)) != NULL) {
+            last->next = newFileList (file);
+            last = last->next;
+            last->tf = atof (tf);
+        }
+
+        if (n == max) {
+            max *= 2;
+            nodes = realloc (nodes, max * sizeof (InvertedIndexBST));
+            assert(nodes != NULL);
+        }
+        nodes[n++] = new;
+    }
+    free (line);
+    fclose (fp);
+
+    // the words are already in order, so link them up as a balanced tree
+    InvertedIndexBST tree = buildBalanced (nodes, 0, n - 1);
+    free (nodes);
+    return tree;
+}
+
+// Helper: write the dictionary out as run number nrun; returns 0 if the
+// run could not be written
+static int flushRun (BTree dict, char *indexFilename, int nrun) {
+    char *name = runName (indexFilename, nrun);
+    FILE *fp = fopen (name, "w");
+    int ok = fp != NULL;
+    if (ok) {
+        BTreeWalk (dict, writeRunTerm, fp);
+        ok = !ferror (fp);
+        if (fclose (fp) != 0) ok = 0;
+    }
+    free (name);
+    return ok;
+}
+
+// Helper: one run line; tf still holds the raw count here
+static void writeRunTerm (char *word, FileList files, void *cl) {
+    FILE *fp = cl;
+    fprintf(fp, "%s", word);
+    for (FileList cur = files; cur != NULL; cur = cur->next) {
+        fprintf(fp, " %s %ld", cur->filename, (long) cur->tf);
+    }
+    fprintf(fp, "\n");
+}
+
+// Helper: name of run file nrun, e.g. "index.txt.run3"
+static char *runName (char *indexFilename, int nrun) {
+    size_t len = strlen (indexFilename) + 16;
+    char *name = malloc (len);
+    assert(name != NULL);
+    snprintf (name, len, "%s.run%d", indexFilename, nrun);
+    return name;
+}
+
+// Helper: merge runs lo .. hi - 1 into outName, and remove them; the
+// result is a run if docs is NULL, else the index.  Returns 0 if a run
+// could not be read or outName written, and then removes outName too
+static int mergeInto (char *indexFilename, int lo, int hi, Doc *docs, int ndocs, char *outName) {
+    int n = hi - lo;
+    int ok = 1;
+    Run *runs = calloc (n > 0 ? n : 1, sizeof (Run));
+    assert(runs != NULL);
+    for (int i = 0; i < n; i++) {
+        char *name = runName (indexFilename, lo + i);
+        runs[i].fp = fopen (name, "r");
+        if (runs[i].fp == NULL) ok = 0;
+        free (name);
+    }
+    FILE *out = ok ? fopen (outName, "w") : NULL;
+    if (out != NULL) {
+        mergeRuns (runs, n, docs, ndocs, out);
+        for (int i = 0; i < n; i++) {
+            if (ferror (runs[i].fp)) ok = 0;
+        }
+        if (ferror (out)) ok = 0;
+        if (fclose (out) != 0) ok = 0;
+        if (!ok) remove (outName);
+    } else {
+        ok = 0;
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (runs[i].fp != NULL) fclose (runs[i].fp);
+        free (runs[i].line);
+        char *name = runName (indexFilename, lo + i);
+        remove (name);
+        free (name);
+    }
+    free (runs);
+    return ok;
+}
+
+// Helper: read the next line of a run, returns 0 at end of run
+static int nextLine (Run *r) {
+    if (getline (&r->line, &r->cap, r->fp) == -1) return 0;
+    r->line[strcspn (r->line, "\n")] = '\0';
+    r->word = r->line;
+    r->rest = strchr (r->line, ' ');
+    if (r->rest != NULL) *r->rest++ = '\0';
+    else r->rest = r->line + strlen (r->line);
+    return 1;
+}
+
+// Helper: merge the runs into one longer run, or if docs is not NULL,
+// into the final index
+static void mergeRuns (Run *runs, int nruns, Doc *docs, int ndocs, FILE *out) {
+    int *heap = malloc ((nruns > 0 ? nruns : 1) * sizeof (int));
+    int *same = malloc ((nruns > 0 ? nruns : 1) * sizeof (int));
+    assert(heap != NULL && same != NULL);
+    int nheap = 0;
+    int npost = 0, maxpost = 64;
+    Posting *post = malloc (maxpost * sizeof (Posting));
+    assert(post != NULL);
+
+    for (int i = 0; i < nruns; i++) {
+        if (nextLine (&runs[i])) heapPush (heap, &nheap, runs, i);
+    }
+
+    while (nheap > 0) {
+        // take every run whose current line is for the smallest word
+        int nsame = 0;
+        same[nsame++] = heapPop (heap, &nheap, runs);
+        char *word = runs[same[0]].word;
+        while (nheap > 0 && strcmp (runs[heap[0]].word, word) == 0) {
+            same[nsame++] = heapPop (heap, &nheap, runs);
+        }
+
+        npost = 0;
+        for (int i = 0; i < nsame; i++) {
+            char *save;
+            char *file = strtok_r (runs[same[i]].rest, " ", &save);
+            char *count;
+            while (file != NULL && (count = strtok_r (NULL, " ", &save)) != NULL) {
+                if (npost == maxpost) {
+                    maxpost *= 2;
+                    post = realloc (post, maxpost * sizeof (Posting));
+                    assert(post != NULL);
+                }
+                post[npost++] = (Posting) { file, atol (count) };
+                file = strtok_r (NULL, " ", &save);
+            }
+        }
+        // a file split across two runs appears twice; add its counts
+        qsort (post, npost, sizeof (Posting), cmpPosting);
+
+        fprintf(out, "%s", word);
+        for (int i = 0; i < npost; i++) {
+            long count = post[i].count;
+            while (i + 1 < npost && strcmp (post[i + 1].file, post[i].file) == 0) {
+                count += post[++i].count;
+            }
+            if (docs == NULL) {
+                fprintf(out, " %s %ld", post[i].file, count);
+                continue;
+            }
+            Doc key = { post[i].file, 0 };
+            Doc *doc = bsearch (&key, docs, ndocs, sizeof (Doc), cmpDoc);
+            double n_word = (doc != NULL) ? doc->nwords : 1;
+            fprintf(out, " %s %.17g", post[i].file, count / n_word);
+        }
+        fprintf(out, "\n");
+
+        for (int i = 0; i < nsame; i++) {
+            if (nextLine (&runs[same[i]])) heapPush (heap, &nheap, runs, same[i]);
+        }
+    }
+    free (post);
+    free (same);
+    free (heap);
+}
+
+// Helper: add run r to the min-heap ordered on each run's current word
+static void heapPush (int *heap, int *n, Run *runs, int r) {
+    int i = (*n)++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (strcmp (runs[heap[parent]].word, runs[r].word) <= 0) break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = r;
+}
+
+// Helper: remove and return the run with the smallest current word
+static int heapPop (int *heap, int *n, Run *runs) {
+    int top = heap[0];
+    int last = heap[--(*n)];
+    int i = 0;
+    while (2 * i + 1 < *n) {
+        int child = 2 * i + 1;
+        if (child + 1 < *n
+                && strcmp (runs[heap[child + 1]].word, runs[heap[child]].word) < 0) {
+            child++;
+        }
+        if (strcmp (runs[last].word, runs[heap[child]].word) <= 0) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (*n > 0) heap[i] = last;
+    return top;
+}
+
+static int cmpDoc (const void *a, const void *b) {
+    return strcmp (((const Doc *) a)->name, ((const Doc *) b)->name);
+}
+
+static int cmpPosting (const void *a, const void *b) {
+    return strcmp (((const Posting *) a)->file, ((const Posting *) b)->file);
+}
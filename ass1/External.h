@@ -0,0 +1,30 @@
+// External.h ... bounded-memory (SPIMI) index build for large collections
+//
+// The on-disk index has one line per word, in ascending order:
+//     word file1 tf1 file2 tf2 ...
+// with the files of each word in ascending order.
+
+#ifndef _EXTERNAL_GUARD
+#define _EXTERNAL_GUARD
+
+#include <stddef.h>
+
+#include "invertedIndex.h"
+
+/** Build the inverted index for the files named in collectionFilename and
+    write it to indexFilename, holding at most about memBudget bytes of
+    postings in memory.  Whenever the budget is reached the postings are
+    written out as a sorted run file (indexFilename.run0, .run1, ...); the
+    runs are then merged into indexFilename, a bounded number at a time,
+    and removed.  Returns the number of documents read, or -1 if the
+    collection could not be read or a run or the index written; the run
+    files are removed either way.
+*/
+int generateInvertedIndexExternal (char *collectionFilename, char *indexFilename, size_t memBudget);
+
+/** Load an index written by generateInvertedIndexExternal into memory as a
+    balanced InvertedIndexBST.  Returns NULL if the file cannot be read.
+*/
+InvertedIndexBST loadInvertedIndex (char *indexFilename);
+
+#endif
@@ -0,0 +1,211 @@
+// Forward.c ... a forward index (file -> tf-idf vector) and "more like this"
+//
+// The vectors are made in one in-order walk of the inverted index, so each
+// vector is in word order.  A word found in every file has an idf of 0;
+// it adds nothing to any cosine, so it is left out of the vectors.
+//
+// moreLikeThis never compares all pairs of files: it walks the postings of
+// the words in the query file's vector, accumulating the dot product with
+// every file they lead to.  Only files that share a word are touched, and
+// the words in every file, which have the longest postings, are skipped
+// altogether.  Each word keeps a copy of its postings as arrays of Doc
+// numbers and weights, so the walk neither chases FileList pointers nor
+// looks filenames up.
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "BTree.h"
+#include "Forward.h"
+
+// a word's postings, as Doc numbers and tf-idf weights
+typedef struct Word {
+    InvertedIndexBST node;
+    int n;
+    int *docs;
+    double *weight;
+} Word;
+
+typedef struct Entry {
+    Word *word;
+    double weight;              // tf * idf in this file
+} Entry;
+
+typedef struct Doc {
+    char *filename;
+    Entry *vec;                 // in word order
+    int n, size;
+    double norm;
+} Doc;
+
+typedef struct ForwardIndexRep {
+    int ndocs;
+    Doc *docs;                  // in filename order
+    int nwords, maxwords;
+    Word **words;               // words with a non-zero idf
+} ForwardIndexRep;
+
+static void addName (char *word, FileList files, void *cl);
+static void addVectors (ForwardIndex fi, InvertedIndexBST tree, int D);
+static int findDoc (ForwardIndex fi, char *filename);
+static int bySimilarity (const void *a, const void *b);
+
+ForwardIndex newForwardIndex (InvertedIndexBST tree, int D) {
+    ForwardIndex new = malloc (sizeof (*new));
+    assert(new != NULL);
+
+    // the distinct filenames, in order
+    BTree names = newBTree ();
+    collectNames (names, tree);
+    new->docs = calloc (BTreeNumTerms (names) + 1, sizeof (Doc));
+    assert(new->docs != NULL);
+    new->ndocs = 0;
+    new->nwords = new->maxwords = 0;
+    new->words = NULL;
+    BTreeWalk (names, addName, new);
+    dropBTree (names);
+
+    addVectors (new, tree, D);
+    for (int d = 0; d < new->ndocs; d++) {
+        double sum = 0;
+        for (int i = 0; i < new->docs[d].n; i++) {
+            sum += new->docs[d].vec[i].weight * new->docs[d].vec[i].weight;
+        }
+        new->docs[d].norm = sqrt(sum);
+    }
+    return new;
+}
+
+void dropForwardIndex (ForwardIndex fi) {
+    if (fi == NULL) return;
+    for (int d = 0; d < fi->ndocs; d++) {
+        free (fi->docs[d].filename);
+        free (fi->docs[d].vec);
+    }
+    for (int w = 0; w < fi->nwords; w++) {
+        free (fi->words[w]->docs);
+        free (fi->words[w]->weight);
+        free (fi->words[w]);
+    }
+    free (fi->words);
+    free (fi->docs);
+    free (fi);
+}
+
+int moreLikeThis (ForwardIndex fi, char *filename, Similar out[], int k) {
+    int q = findDoc (fi, filename);
+    if (q < 0) return -1;
+    Doc *query = &fi->docs[q];
+
+    double *dot = calloc (fi->ndocs, sizeof (double));
+    int *touched = malloc (fi->ndocs * sizeof (int));
+    char *seen = calloc (fi->ndocs, sizeof (char));
+    assert(dot != NULL && touched != NULL && seen != NULL);
+    int ntouched = 0;
+    for (int i = 0; i < query->n; i++) {
+        Word *w = query->vec[i].word;
+        double qw = query->vec[i].weight;
+        for (int j = 0; j < w->n; j++) {
+            int d = w->docs[j];
+            if (!seen[d]) {
+                seen[d] = 1;
+                touched[ntouched++] = d;
+            }
+            dot[d] += qw * w->weight[j];
+        }
+    }
+
+    Similar *cand = malloc ((ntouched > 0 ? ntouched : 1) * sizeof (Similar));
+    assert(cand != NULL);
+    int ncand = 0;
+    for (int i = 0; i < ntouched; i++) {
+        if (touched[i] == q) continue;
+        Doc *doc = &fi->docs[touched[i]];
+        cand[ncand].filename = doc->filename;
+        cand[ncand++].cosine = dot[touched[i]] / (query->norm * doc->norm);
+    }
+    qsort (cand, ncand, sizeof (Similar), bySimilarity);
+    int n = ncand < k ? ncand : k;
+    memcpy (out, cand, n * sizeof (Similar));
+
+    free (cand);
+    free (seen);
+    free (touched);
+    free (dot);
+    return n;
+}
+
+// Helper: BTreeWalk visitor; give the next Doc this filename
+static void addName (char *word, FileList files, void *cl) {
+    ForwardIndex fi = cl;
+    Doc *doc = &fi->docs[fi->ndocs++];
+    doc->filename = malloc (strlen (word) + 1);
+    assert(doc->filename != NULL);
+    strcpy (doc->filename, word);
+}
+
+// Helper: append each word of the tree, in order, to its files' vectors
+static void addVectors (ForwardIndex fi, InvertedIndexBST tree, int D) {
+    if (tree == NULL) return;
+    addVectors (fi, tree->left, D);
+
+    int total_file = docFreq (tree);
+    double idf = termIdf (D, total_file);
+    if (idf > 0) {
+        Word *w = malloc (sizeof (Word));
+        assert(w != NULL);
+        w->node = tree;
+        w->n = total_file;
+        w->docs = malloc (w->n * sizeof (int));
+        w->weight = malloc (w->n * sizeof (double));
+        assert(w->docs != NULL && w->weight != NULL);
+        if (fi->nwords == fi->maxwords) {
+            fi->maxwords = fi->maxwords > 0 ? 2 * fi->maxwords : 1024;
+            fi->words = realloc (fi->words, fi->maxwords * sizeof (Word *));
+            assert(fi->words != NULL);
+        }
+        fi->words[fi->nwords++] = w;
+
+        int j = 0;
+        for (FileList curr = tree->fileList; curr != NULL; curr = curr->next, j++) {
+            w->docs[j] = findDoc (fi, curr->filename);
+            w->weight[j] = curr->tf * idf;
+            Doc *doc = &fi->docs[w->docs[j]];
+            if (doc->n == doc->size) {
+                doc->size = doc->size > 0 ? 2 * doc->size : 16;
+                doc->vec = realloc (doc->vec, doc->size * sizeof (Entry));
+                assert(doc->vec != NULL);
+            }
+            doc->vec[doc->n++] = (Entry) { w, w->weight[j] };
+        }
+    }
+    addVectors (fi, tree->right, D);
+}
+
+// Helper: binary search for filename; -1 if it is not there
+static int findDoc (ForwardIndex fi, char *filename) {
+    int lo = 0, hi = fi->ndocs - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        int diff = strcmp(filename, fi->docs[mid].filename);
+        if (diff == 0) return mid;
+        if (diff < 0) {
+            hi = mid - 1;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return -1;
+}
+
+// Helper: descending cosine, then ascending filename
+static int bySimilarity (const void *a, const void *b) {
+    const Similar *x = a, *y = b;
+    if (x->cosine != y->cosine) return x->cosine > y->cosine ? -1 : 1;
+    return strcmp(x->filename, y->filename);
+}
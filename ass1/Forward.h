@@ -0,0 +1,37 @@
+// Forward.h ... a forward index (file -> tf-idf vector) and "more like this"
+//
+// Each file's vector holds a tf-idf weight for every word in the file.
+// The vectors point into the inverted index they were built from, so that
+// index must outlive the forward index.
+
+#ifndef _FORWARD_GUARD
+#define _FORWARD_GUARD
+
+#include "invertedIndex.h"
+
+typedef struct ForwardIndexRep *ForwardIndex;
+
+typedef struct Similar {
+    char *filename;     // owned by the forward index
+    double cosine;
+} Similar;
+
+// build the vectors of every file in tree, using D documents for the idf
+ForwardIndex newForwardIndex (InvertedIndexBST tree, int D);
+
+// free the forward index (not the tree it was built from)
+void dropForwardIndex (ForwardIndex fi);
+
+/** The forward index generateInvertedIndex built alongside tree (see
+    useForwardIndex), or NULL if there is none.
+*/
+ForwardIndex forwardIndexOf (InvertedIndexBST tree);
+
+/** Store in out[] the (at most) k files most similar to filename by cosine
+    similarity of their tf-idf vectors, most similar first, ties in filename
+    order.  Only files sharing a word of non-zero idf with filename are
+    considered.  Returns the number stored, or -1 if filename is unknown.
+*/
+int moreLikeThis (ForwardIndex fi, char *filename, Similar out[], int k);
+
+#endif
@@ -0,0 +1,337 @@
+// Impact.c ... impact-ordered postings and score-at-a-time top-k queries
+//
+// Impacts are uniform steps of the largest tf-idf in the index, rounded,
+// and at least 1; postings with a tf-idf of 0 (words in every file) are
+// left out as they cannot change a sum.  Each word's postings are sorted
+// by impact, then by file, and cut into segments of equal impact.
+//
+// A query keeps one integer accumulator per file and repeatedly reads the
+// segment with the highest impact among its words (Anh and Moffat's
+// score-at-a-time evaluation).  R, the sum over the words of their next
+// unread impact, bounds what any file can still gain.  Whenever the impact
+// being read drops, the top k + 1 files are picked out: if the k-th leads
+// the next by more than R, no other file can reach the top k.  Reading then
+// stops, and the top k's sums are completed by searching the unread
+// segments (each in file order) for just those k files, so the results are
+// the same as reading everything.
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "BTree.h"
+#include "Query.h"
+#include "Impact.h"
+
+typedef struct Segment {
+    int impact;
+    int n;
+    int *docs;                  // in filename order
+} Segment;
+
+typedef struct ImpactList {
+    char *word;                 // owned by the tree
+    int nseg;
+    Segment *seg;               // highest impact first
+    int *docs;                  // storage for every segment's docs
+} ImpactList;
+
+typedef struct ImpactIndexRep {
+    int ndocs;
+    char **names;               // filenames, in order
+    int nwords;
+    ImpactList *words;          // in word order
+    int levels;
+    double step;                // tf-idf of one unit of impact
+} ImpactIndexRep;
+
+// a posting while it is being sorted, or a file's sum while ranking
+typedef struct Posting {
+    int impact;
+    int doc;
+} Posting;
+
+// a query word, and the next segment of it to read
+typedef struct Cursor {
+    ImpactList *list;
+    int next;
+} Cursor;
+
+static void addName (char *word, FileList files, void *cl);
+static void maxScore (InvertedIndexBST t, int D, double *max, int *nwords);
+static void addLists (ImpactIndex ix, InvertedIndexBST t, int D);
+static int findName (ImpactIndex ix, char *filename);
+static ImpactList *findList (ImpactIndex ix, char *word);
+static int byImpact (const void *a, const void *b);
+static int nextImpact (Cursor *c);
+static int selectTop (int *acc, int *touched, int n, int max, Posting top[]);
+static void finishTop (Cursor *cur, int ncur, Posting top[], int k);
+static int hasDoc (Segment *seg, int doc);
+
+ImpactIndex newImpactIndex (InvertedIndexBST tree, int D, int bits) {
+    assert(bits >= 1 && bits <= 16);
+    ImpactIndex new = malloc (sizeof (*new));
+    assert(new != NULL);
+
+    BTree names = newBTree ();
+    collectNames (names, tree);
+    new->names = malloc ((BTreeNumTerms (names) + 1) * sizeof (char *));
+    assert(new->names != NULL);
+    new->ndocs = 0;
+    BTreeWalk (names, addName, new);
+    dropBTree (names);
+
+    double max = 0;
+    int nwords = 0;
+    maxScore (tree, D, &max, &nwords);
+    new->levels = (1 << bits) - 1;
+    new->step = (max > 0) ? max / new->levels : 1;
+    new->words = malloc ((nwords + 1) * sizeof (ImpactList));
+    assert(new->words != NULL);
+    new->nwords = 0;
+    addLists (new, tree, D);
+    return new;
+}
+
+void dropImpactIndex (ImpactIndex ix) {
+    if (ix == NULL) return;
+    for (int i = 0; i < ix->nwords; i++) {
+        free (ix->words[i].seg);
+        free (ix->words[i].docs);
+    }
+    for (int d = 0; d < ix->ndocs; d++) free (ix->names[d]);
+    free (ix->words);
+    free (ix->names);
+    free (ix);
+}
+
+int impactRetrieve (ImpactIndex ix, char *searchWords[], int k, long budget,
+                    TfIdfResult out[], long *processed) {
+    if (k <= 0) {
+        if (processed != NULL) *processed = 0;
+        return 0;
+    }
+    int nwords = 0;
+    while (searchWords[nwords] != NULL) nwords++;
+    Cursor *cur = malloc ((nwords + 1) * sizeof (Cursor));
+    int *acc = calloc (ix->ndocs + 1, sizeof (int));
+    int *touched = malloc ((ix->ndocs + 1) * sizeof (int));
+    Posting *top = malloc ((k + 2) * sizeof (Posting));
+    assert(cur != NULL && acc != NULL && touched != NULL && top != NULL);
+    int ncur = 0;
+    for (int w = 0; w < nwords; w++) {
+        ImpactList *list = findList (ix, searchWords[w]);
+        if (list != NULL && list->nseg > 0) cur[ncur++] = (Cursor) { list, 0 };
+    }
+
+    long R = 0;
+    for (int c = 0; c < ncur; c++) R += nextImpact (&cur[c]);
+    int ntouched = 0, ntop = 0;
+    int best = 0;               // the highest sum so far
+    long read = 0;
+    int level = -1;
+    int done = 0;
+    while (R > 0) {
+        // the unread segment with the highest impact
+        int c = 0;
+        for (int i = 1; i < ncur; i++) {
+            if (nextImpact (&cur[i]) > nextImpact (&cur[c])) c = i;
+        }
+        int impact = nextImpact (&cur[c]);
+        if (impact != level && level >= 0) {
+            if (budget > 0 && read >= budget) break;
+            // the top k can only be settled once the leader is out of reach
+            if (best > R) {
+                ntop = selectTop (acc, touched, ntouched, k + 1, top);
+                if (ntop >= k && top[k - 1].impact > (ntop > k ? top[k].impact : 0) + R) {
+                    finishTop (cur, ncur, top, k);
+                    done = 1;
+                    break;
+                }
+            }
+        }
+        level = impact;
+
+        Segment *s = &cur[c].list->seg[cur[c].next++];
+        for (int i = 0; i < s->n; i++) {
+            int d = s->docs[i];
+            if (acc[d] == 0) touched[ntouched++] = d;
+            acc[d] += impact;
+            if (acc[d] > best) best = acc[d];
+        }
+        read += s->n;
+        R -= impact - nextImpact (&cur[c]);
+    }
+    if (!done) ntop = selectTop (acc, touched, ntouched, k, top);
+
+    int n = ntop < k ? ntop : k;
+    for (int i = 0; i < n; i++) {
+        out[i].filename = ix->names[top[i].doc];
+        out[i].tfidf_sum = top[i].impact * ix->step;
+    }
+    if (processed != NULL) *processed = read;
+    free (top);
+    free (touched);
+    free (acc);
+    free (cur);
+    return n;
+}
+
+// Helper: the (at most) max best files in result order; returns how many
+static int selectTop (int *acc, int *touched, int n, int max, Posting top[]) {
+    int ntop = 0;
+    for (int i = 0; i < n; i++) {
+        Posting p = { acc[touched[i]], touched[i] };
+        if (ntop == max && byImpact (&p, &top[ntop - 1]) > 0) continue;
+        int j = (ntop < max) ? ntop++ : ntop - 1;
+        while (j > 0 && byImpact (&p, &top[j - 1]) < 0) {
+            top[j] = top[j - 1];
+            j--;
+        }
+        top[j] = p;
+    }
+    return ntop;
+}
+
+// Helper: add the unread impacts of the top k files to their sums, and re-rank
+static void finishTop (Cursor *cur, int ncur, Posting top[], int k) {
+    for (int i = 0; i < k; i++) {
+        for (int c = 0; c < ncur; c++) {
+            for (int s = cur[c].next; s < cur[c].list->nseg; s++) {
+                Segment *seg = &cur[c].list->seg[s];
+                if (hasDoc (seg, top[i].doc)) {
+                    top[i].impact += seg->impact;
+                    break;  // a file has one posting per word
+                }
+            }
+        }
+    }
+    qsort (top, k, sizeof (Posting), byImpact);
+}
+
+// Helper: binary search of a segment for doc
+static int hasDoc (Segment *seg, int doc) {
+    int lo = 0, hi = seg->n - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (seg->docs[mid] == doc) return 1;
+        if (seg->docs[mid] > doc) {
+            hi = mid - 1;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return 0;
+}
+
+// Helper: impact of the cursor's next segment, 0 once it has read them all
+static int nextImpact (Cursor *c) {
+    return (c->next < c->list->nseg) ? c->list->seg[c->next].impact : 0;
+}
+
+// Helper: BTreeWalk visitor; append the filename to ix->names
+static void addName (char *word, FileList files, void *cl) {
+    ImpactIndex ix = cl;
+    ix->names[ix->ndocs] = malloc (strlen (word) + 1);
+    assert(ix->names[ix->ndocs] != NULL);
+    strcpy (ix->names[ix->ndocs++], word);
+}
+
+// Helper: the largest tf-idf of any posting, and the number of words
+static void maxScore (InvertedIndexBST t, int D, double *max, int *nwords) {
+    if (t == NULL) return;
+    double idf = termIdf (D, docFreq (t));
+    for (FileList curr = t->fileList; curr != NULL; curr = curr->next) {
+        if (curr->tf * idf > *max) *max = curr->tf * idf;
+    }
+    (*nwords)++;
+    maxScore (t->left, D, max, nwords);
+    maxScore (t->right, D, max, nwords);
+}
+
+// Helper: make the ImpactList of each word in the tree, in word order
+static void addLists (ImpactIndex ix, InvertedIndexBST t, int D) {
+    if (t == NULL) return;
+    addLists (ix, t->left, D);
+
+    double idf = termIdf (D, docFreq (t));
+    int n = 0;
+    for (FileList curr = t->fileList; curr != NULL; curr = curr->next) n++;
+    Posting *p = malloc (n * sizeof (Posting));
+    assert(p != NULL);
+    int np = 0;
+    for (FileList curr = t->fileList; curr != NULL; curr = curr->next) {
+        double score = curr->tf * idf;
+        if (score <= 0) continue;
+        int impact = (int) lround(score / ix->step);
+        if (impact < 1) impact = 1;
+        if (impact > ix->levels) impact = ix->levels;
+        p[np++] = (Posting) { impact, findName (ix, curr->filename) };
+    }
+    qsort (p, np, sizeof (Posting), byImpact);
+
+    ImpactList *list = &ix->words[ix->nwords++];
+    list->word = t->word;
+    list->nseg = 0;
+    for (int i = 0; i < np; i++) {
+        if (i == 0 || p[i].impact != p[i - 1].impact) list->nseg++;
+    }
+    list->seg = malloc ((list->nseg + 1) * sizeof (Segment));
+    list->docs = malloc ((np + 1) * sizeof (int));
+    assert(list->seg != NULL && list->docs != NULL);
+    int s = -1;
+    for (int i = 0; i < np; i++) {
+        if (i == 0 || p[i].impact != p[i - 1].impact) {
+            s++;
+            list->seg[s] = (Segment) { p[i].impact, 0, &list->docs[i] };
+        }
+        list->docs[i] = p[i].doc;
+        list->seg[s].n++;
+    }
+    free (p);
+
+    addLists (ix, t->right, D);
+}
+
+// Helper: binary search for a filename's number
+static int findName (ImpactIndex ix, char *filename) {
+    int lo = 0, hi = ix->ndocs - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        int diff = strcmp(filename, ix->names[mid]);
+        if (diff == 0) return mid;
+        if (diff < 0) {
+            hi = mid - 1;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return -1;
+}
+
+// Helper: binary search for a word's ImpactList, or NULL
+static ImpactList *findList (ImpactIndex ix, char *word) {
+    int lo = 0, hi = ix->nwords - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        int diff = strcmp(word, ix->words[mid].word);
+        if (diff == 0) return &ix->words[mid];
+        if (diff < 0) {
+            hi = mid - 1;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+// Helper: descending impact (or sum), then ascending file
+static int byImpact (const void *a, const void *b) {
+    const Posting *x = a, *y = b;
+    if (x->impact != y->impact) return x->impact > y->impact ? -1 : 1;
+    return x->doc - y->doc;
+}
@@ -0,0 +1,36 @@
+// Impact.h ... impact-ordered postings and score-at-a-time top-k queries
+//
+// Each posting's tf-idf is quantised to a small integer impact, and each
+// word's postings are grouped by impact, highest first.  A query reads
+// the groups of all its words in order of impact and can stop early: in
+// exact mode once the top k can no longer change, or after a budget of
+// postings.  The index points at the words of the tree it was built from,
+// so that tree must outlive it.
+
+#ifndef _IMPACT_GUARD
+#define _IMPACT_GUARD
+
+#include "invertedIndex.h"
+#include "Query.h"
+
+typedef struct ImpactIndexRep *ImpactIndex;
+
+/** Build impact-ordered postings for tree (over D documents), with
+    impacts of 1 to 2^bits - 1 (1 <= bits <= 16).
+*/
+ImpactIndex newImpactIndex (InvertedIndexBST tree, int D, int bits);
+
+void dropImpactIndex (ImpactIndex ix);
+
+/** Store in out[] the (at most) k files with the highest sum of impacts
+    over searchWords, highest first, ties in filename order; tfidf_sum is
+    the sum of impacts scaled back to tf-idf.  If budget is 0, the results
+    are exactly those of scoring every posting; otherwise reading may also
+    stop early, once (about) budget postings have been read.  Returns the
+    number of results, and sets *processed (if not NULL) to the number of
+    postings read; with k <= 0 nothing is read and 0 is returned.
+*/
+int impactRetrieve (ImpactIndex ix, char *searchWords[], int k, long budget,
+                    TfIdfResult out[], long *processed);
+
+#endif
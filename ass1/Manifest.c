@@ -0,0 +1,360 @@
+// Manifest.c ... incremental rebuilds of an on-disk index
+//
+// Each file named in the collection is stat()ed.  A file whose size and
+// mtime match its manifest entry is not read at all; otherwise its
+// contents are hashed (64-bit FNV-1a), and only if the hash differs too
+// is it tokenized, into a BTree dictionary as in External.c.  The new
+// index is then one pass over the old one in word order: postings of
+// changed and removed files are dropped, the other postings are copied
+// as they are (tf text and all), and the dictionary's words are merged in.
+// The index and manifest are written to ".tmp" files and renamed over the
+// old ones, so an interrupted rebuild leaves the old pair in place.
+// With no usable old index, the files are only hashed and counted here and
+// the index is built by generateInvertedIndexExternal, within its budget.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "BTree.h"
+#include "External.h"
+#include "Manifest.h"
+
+#define MAXNAME 100
+#define FULL_BUILD_BUDGET (64 << 20)     // bytes of postings a full build holds
+
+typedef unsigned long long Hash;
+
+typedef struct Entry {
+    char *name;
+    long long size;
+    long long mtime;            // nanoseconds
+    Hash hash;
+    long nwords;
+} Entry;
+
+typedef struct Term {
+    char *word;
+    FileList files;             // raw counts, from the dictionary
+} Term;
+
+typedef struct Terms {
+    Term *t;
+    int n, max;
+} Terms;
+
+typedef struct Posting {
+    char *file;
+    char *tf;                   // the old index's text, or NULL for a new count
+    long count;
+} Posting;
+
+static Entry *readManifest (char *manifestFilename, int *n);
+static int writeManifest (char *manifestFilename, Entry *entries, int n);
+static char *withSuffix (char *filename, char *suffix);
+static int hashFile (char *filename, Hash *hash);
+static long tokenize (char *filename, BTree dict);
+static void addTerm (char *word, FileList files, void *cl);
+static void writeWord (FILE *out, char *word, char *oldPostings, Term *new,
+                       char **stale, int nstale, Entry *docs, int ndocs);
+static int isStale (char *file, char **stale, int nstale);
+static int cmpEntry (const void *a, const void *b);
+static int cmpName (const void *a, const void *b);
+static int cmpPosting (const void *a, const void *b);
+
+int rebuildInvertedIndex (char *collectionFilename, char *indexFilename, RebuildStats *stats) {
+    RebuildStats s = {0, 0, 0, 0, 0};
+    FILE *fp = fopen (collectionFilename, "r");
+    if (fp == NULL) return -1;
+    char *manifestFilename = withSuffix (indexFilename, ".manifest");
+    FILE *old = fopen (indexFilename, "r");
+
+    // the old index and its manifest are only any use together
+    int nold = 0;
+    Entry *oldEntries = (old != NULL) ? readManifest (manifestFilename, &nold) : NULL;
+    if (old != NULL && oldEntries == NULL) {
+        fclose (old);
+        old = NULL;
+    }
+    char *seen = calloc (nold + 1, 1);
+    assert(seen != NULL);
+
+    int n = 0, max = 16;
+    Entry *entries = malloc (max * sizeof (Entry));
+    int nstale = 0;
+    char **stale = malloc ((nold + 1) * sizeof (char *));
+    assert(entries != NULL && stale != NULL);
+    BTree dict = newBTree ();
+    char file_name[MAXNAME];
+    while (fscanf(fp, "%99s", file_name) != EOF) {
+        struct stat st;
+        if (stat (file_name, &st) != 0) continue;
+        Entry e = { file_name, st.st_size, st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec, 0, 0 };
+
+        Entry *was = (oldEntries != NULL)
+                   ? bsearch (&e, oldEntries, nold, sizeof (Entry), cmpEntry) : NULL;
+        if (was != NULL && seen[was - oldEntries]) continue;     // listed twice
+        if (was != NULL && was->size == e.size && was->mtime == e.mtime) {
+            e.hash = was->hash;
+            e.nwords = was->nwords;
+            s.unchanged++;
+        } else {
+            if (!hashFile (file_name, &e.hash)) continue;
+            if (was != NULL && was->size == e.size && was->hash == e.hash) {
+                e.nwords = was->nwords;
+                s.touched++;
+            } else {
+                e.nwords = tokenize (file_name, (old != NULL) ? dict : NULL);
+                if (was != NULL) {
+                    stale[nstale++] = was->name;
+                    s.changed++;
+                } else {
+                    s.added++;
+                }
+            }
+        }
+        if (was != NULL) seen[was - oldEntries] = 1;
+
+        if (n == max) {
+            max *= 2;
+            entries = realloc (entries, max * sizeof (Entry));
+            assert(entries != NULL);
+        }
+        e.name = malloc (strlen (file_name) + 1);
+        assert(e.name != NULL);
+        strcpy (e.name, file_name);
+        entries[n++] = e;
+    }
+    fclose (fp);
+    for (int i = 0; i < nold; i++) {
+        if (!seen[i]) {
+            stale[nstale++] = oldEntries[i].name;
+            s.removed++;
+        }
+    }
+    qsort (stale, nstale, sizeof (char *), cmpName);
+
+    int ok = 1;
+    if (old == NULL) {
+        ok = (generateInvertedIndexExternal (collectionFilename, indexFilename, FULL_BUILD_BUDGET) >= 0);
+    } else if (nstale > 0 || BTreeNumTerms (dict) > 0) {
+        Terms terms = { NULL, 0, 0 };
+        BTreeWalk (dict, addTerm, &terms);
+        // word totals of the new files are looked up by name
+        Entry *docs = malloc ((n + 1) * sizeof (Entry));
+        assert(docs != NULL);
+        memcpy (docs, entries, n * sizeof (Entry));
+        qsort (docs, n, sizeof (Entry), cmpEntry);
+
+        char *tmpName = withSuffix (indexFilename, ".tmp");
+        FILE *out = fopen (tmpName, "w");
+        if (out != NULL) {
+            char *line = NULL;
+            size_t cap = 0;
+            int t = 0;
+            while (getline (&line, &cap, old) != -1) {
+                line[strcspn (line, "\n")] = '\0';
+                char *rest = strchr (line, ' ');
+                if (rest != NULL) *rest++ = '\0';
+                else rest = line + strlen (line);
+                while (t < terms.n && strcmp (terms.t[t].word, line) < 0) {
+                    writeWord (out, terms.t[t].word, NULL, &terms.t[t], stale, nstale, docs, n);
+                    t++;
+                }
+                Term *new = NULL;
+                if (t < terms.n && strcmp (terms.t[t].word, line) == 0) new = &terms.t[t++];
+                writeWord (out, line, rest, new, stale, nstale, docs, n);
+            }
+            for (; t < terms.n; t++) {
+                writeWord (out, terms.t[t].word, NULL, &terms.t[t], stale, nstale, docs, n);
+            }
+            free (line);
+            ok = (fclose (out) == 0 && rename (tmpName, indexFilename) == 0);
+        } else {
+            ok = 0;
+        }
+        free (tmpName);
+        free (docs);
+        free (terms.t);
+    }
+    if (ok) ok = writeManifest (manifestFilename, entries, n);
+
+    if (old != NULL) fclose (old);
+    dropBTree (dict);
+    for (int i = 0; i < nold; i++) free (oldEntries[i].name);
+    free (oldEntries);
+    for (int i = 0; i < n; i++) free (entries[i].name);
+    free (entries);
+    free (stale);
+    free (seen);
+    free (manifestFilename);
+    if (stats != NULL) *stats = s;
+    return ok ? n : -1;
+}
+
+// Helper: read a manifest into an array in name order; NULL if there is none
+static Entry *readManifest (char *manifestFilename, int *n) {
+    FILE *fp = fopen (manifestFilename, "r");
+    *n = 0;
+    if (fp == NULL) return NULL;
+    int max = 16;
+    Entry *entries = malloc (max * sizeof (Entry));
+    assert(entries != NULL);
+    char name[MAXNAME];
+    Entry e;
+    while (fscanf(fp, "%99s %lld %lld %llx %ld", name, &e.size, &e.mtime, &e.hash, &e.nwords) == 5) {
+        if (*n == max) {
+            max *= 2;
+            entries = realloc (entries, max * sizeof (Entry));
+            assert(entries != NULL);
+        }
+        e.name = malloc (strlen (name) + 1);
+        assert(e.name != NULL);
+        strcpy (e.name, name);
+        entries[(*n)++] = e;
+    }
+    fclose (fp);
+    qsort (entries, *n, sizeof (Entry), cmpEntry);
+    return entries;
+}
+
+// Helper: write the manifest, in collection order, through a ".tmp" file
+static int writeManifest (char *manifestFilename, Entry *entries, int n) {
+    char *tmpName = withSuffix (manifestFilename, ".tmp");
+    FILE *fp = fopen (tmpName, "w");
+    int ok = (fp != NULL);
+    if (ok) {
+        for (int i = 0; i < n; i++) {
+            fprintf(fp, "%s %lld %lld %016llx %ld\n", entries[i].name, entries[i].size,
+                entries[i].mtime, entries[i].hash, entries[i].nwords);
+        }
+        ok = (fclose (fp) == 0 && rename (tmpName, manifestFilename) == 0);
+    }
+    free (tmpName);
+    return ok;
+}
+
+// Helper: filename followed by suffix, e.g. "index.txt.manifest"
+static char *withSuffix (char *filename, char *suffix) {
+    char *name = malloc (strlen (filename) + strlen (suffix) + 1);
+    assert(name != NULL);
+    strcpy (name, filename);
+    strcat (name, suffix);
+    return name;
+}
+
+// Helper: 64-bit FNV-1a hash of a file's contents; 0 if it can't be read
+static int hashFile (char *filename, Hash *hash) {
+    FILE *fp = fopen (filename, "rb");
+    if (fp == NULL) return 0;
+    unsigned char buf[65536];
+    Hash h = 14695981039346656037ULL;
+    size_t len;
+    while ((len = fread (buf, 1, sizeof (buf), fp)) > 0) {
+        for (size_t i = 0; i < len; i++) {
+            h ^= buf[i];
+            h *= 1099511628211ULL;
+        }
+    }
+    fclose (fp);
+    *hash = h;
+    return 1;
+}
+
+// Helper: add the file's words to dict, as generateInvertedIndexExternal
+// does, or only count them if dict is NULL; returns the word count
+static long tokenize (char *filename, BTree dict) {
+    FILE *txt = fopen (filename, "r");
+    if (txt == NULL) return 0;
+    char word[MAXNAME];
+    long nwords = 0;
+    while (fscanf(txt, "%99s", word) != EOF) {
+        nwords++;
+        if (dict != NULL && normaliseWord (word)[0] != '\0')
+            BTreeInsert (dict, word, filename);
+    }
+    fclose (txt);
+    return nwords;
+}
+
+// Helper: BTreeWalk visitor; collect the dictionary's words in order
+static void addTerm (char *word, FileList files, void *cl) {
+    Terms *terms = cl;
+    if (terms->n == terms->max) {
+        terms->max = terms->max ? 2 * terms->max : 1024;
+        terms->t = realloc (terms->t, terms->max * sizeof (Term));
+        assert(terms->t != NULL);
+    }
+    terms->t[terms->n++] = (Term) { word, files };
+}
+
+// Helper: one index line; the old postings that are still current, merged
+// with the new ones.  Nothing is written if no postings are left.
+static void writeWord (FILE *out, char *word, char *oldPostings, Term *new,
+                       char **stale, int nstale, Entry *docs, int ndocs) {
+    int npost = 0, maxpost = 16;
+    Posting *post = malloc (maxpost * sizeof (Posting));
+    assert(post != NULL);
+    char *save;
+    char *file = (oldPostings != NULL) ? strtok_r (oldPostings, " ", &save) : NULL;
+    char *tf;
+    for (; file != NULL && (tf = strtok_r (NULL, " ", &save)) != NULL;
+           file = strtok_r (NULL, " ", &save)) {
+        if (isStale (file, stale, nstale)) continue;
+        if (npost == maxpost) {
+            maxpost *= 2;
+            post = realloc (post, maxpost * sizeof (Posting));
+            assert(post != NULL);
+        }
+        post[npost++] = (Posting) { file, tf, 0 };
+    }
+    for (FileList cur = (new != NULL) ? new->files : NULL; cur != NULL; cur = cur->next) {
+        if (npost == maxpost) {
+            maxpost *= 2;
+            post = realloc (post, maxpost * sizeof (Posting));
+            assert(post != NULL);
+        }
+        post[npost++] = (Posting) { cur->filename, NULL, (long) cur->tf };
+    }
+    // a changed file's postings were dropped above, so no file is here twice
+    qsort (post, npost, sizeof (Posting), cmpPosting);
+
+    if (npost > 0) {
+        fprintf(out, "%s", word);
+        for (int i = 0; i < npost; i++) {
+            if (post[i].tf != NULL) {
+                fprintf(out, " %s %s", post[i].file, post[i].tf);
+            } else {
+                Entry key = { post[i].file, 0, 0, 0, 0 };
+                Entry *doc = bsearch (&key, docs, ndocs, sizeof (Entry), cmpEntry);
+                double n_word = (doc != NULL) ? doc->nwords : 1;
+                fprintf(out, " %s %.17g", post[i].file, post[i].count / n_word);
+            }
+        }
+        fprintf(out, "\n");
+    }
+    free (post);
+}
+
+// Helper: true if file's old postings must go
+static int isStale (char *file, char **stale, int nstale) {
+    return nstale > 0 && bsearch (&file, stale, nstale, sizeof (char *), cmpName) != NULL;
+}
+
+static int cmpEntry (const void *a, const void *b) {
+    return strcmp (((const Entry *) a)->name, ((const Entry *) b)->name);
+}
+
+static int cmpName (const void *a, const void *b) {
+    return strcmp (*(char * const *) a, *(char * const *) b);
+}
+
+static int cmpPosting (const void *a, const void *b) {
+    return strcmp (((const Posting *) a)->file, ((const Posting *) b)->file);
+}
@@ -0,0 +1,30 @@
+// Manifest.h ... incremental rebuilds of an on-disk index
+//
+// Next to the index (in the format of External.h) a manifest records, for
+// each file it covers, the file's size, modification time, a hash of its
+// contents and its number of words:
+//     filename size mtime hash nwords
+// A rebuild only reads the files that are new or have changed since.
+
+#ifndef _MANIFEST_GUARD
+#define _MANIFEST_GUARD
+
+typedef struct RebuildStats {
+    int unchanged;      // same size and mtime; not read
+    int touched;        // new mtime but the same contents; read to hash only
+    int changed;        // re-tokenized
+    int added;          // not in the old manifest; tokenized
+    int removed;        // in the old manifest but no longer in the collection
+} RebuildStats;
+
+/** Bring indexFilename (and its manifest, indexFilename.manifest) up to
+    date with the files named in collectionFilename.  Postings of files
+    that have not changed are copied from the old index as they are; only
+    new and changed files are tokenized.  The result is the same as
+    generateInvertedIndexExternal would write.  If there is no index yet,
+    every file counts as added.  stats may be NULL.
+    Returns the number of documents in the index, or -1 on error.
+*/
+int rebuildInvertedIndex (char *collectionFilename, char *indexFilename, RebuildStats *stats);
+
+#endif
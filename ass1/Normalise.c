@@ -0,0 +1,236 @@
+// Normalise.c ... case folding of UTF-8 words for normaliseWord
+//
+// The text is read at r and written at w <= r, so that the few mappings
+// that shorten a letter can be done in place.  Each block of 16 bytes
+// (SSE2), or of 8 in a 64-bit word, is first tested for a byte with the
+// top bit set; a block that is all ASCII is lowered with a compare and an
+// add per block, and any other block, or a tail shorter than 8 bytes, is
+// walked one character at a time.  Two-byte characters (Latin,
+// Greek, Cyrillic, Armenian ...) are looked up directly in a table of all
+// 2048 code points below U+0800, filled in from the ranges on first use;
+// longer ones binary search the ranges.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "Normalise.h"
+
+// upper case code points lo..hi, taking every step-th one from lo, map to
+// code point + delta.  Sorted, and no mapping is longer in UTF-8.
+typedef struct Range {
+    uint32_t lo, hi;
+    int32_t delta;
+    int step;
+} Range;
+
+static const Range upper[] = {
+    { 0x00C0, 0x00D6, 32, 1 },          // Latin-1: A grave .. O diaeresis
+    { 0x00D8, 0x00DE, 32, 1 },          //          O stroke .. thorn
+    { 0x0100, 0x012F, 1, 2 },           // Latin Extended-A, in pairs
+    { 0x0130, 0x0130, 0x69 - 0x130, 1 },   // I with dot above -> i
+    { 0x0132, 0x0137, 1, 2 },
+    { 0x0139, 0x0148, 1, 2 },
+    { 0x014A, 0x0177, 1, 2 },
+    { 0x0178, 0x0178, 0xFF - 0x178, 1 },   // Y diaeresis
+    { 0x0179, 0x017E, 1, 2 },
+    { 0x01CD, 0x01DC, 1, 2 },           // Latin Extended-B, the regular pairs
+    { 0x01DE, 0x01EF, 1, 2 },
+    { 0x01F8, 0x021F, 1, 2 },
+    { 0x0222, 0x0233, 1, 2 },
+    { 0x0246, 0x024F, 1, 2 },
+    { 0x0386, 0x0386, 0x26, 1 },        // Greek with tonos
+    { 0x0388, 0x038A, 0x25, 1 },
+    { 0x038C, 0x038C, 0x40, 1 },
+    { 0x038E, 0x038F, 0x3F, 1 },
+    { 0x0391, 0x03A1, 32, 1 },          // Greek Alpha .. Rho
+    { 0x03A3, 0x03AB, 32, 1 },          //       Sigma .. Upsilon dialytika
+    { 0x03D8, 0x03EF, 1, 2 },
+    { 0x0400, 0x040F, 80, 1 },          // Cyrillic Ie grave .. Dzhe
+    { 0x0410, 0x042F, 32, 1 },          //          A .. Ya
+    { 0x0460, 0x0481, 1, 2 },
+    { 0x048A, 0x04BF, 1, 2 },
+    { 0x04C0, 0x04C0, 15, 1 },          // palochka
+    { 0x04C1, 0x04CE, 1, 2 },
+    { 0x04D0, 0x052F, 1, 2 },
+    { 0x0531, 0x0556, 48, 1 },          // Armenian
+    { 0x10A0, 0x10C5, 0x2D00 - 0x10A0, 1 },    // Georgian
+    { 0x1E00, 0x1E95, 1, 2 },           // Latin Extended Additional
+    { 0x1E9E, 0x1E9E, 0xDF - 0x1E9E, 1 },      // capital sharp s
+    { 0x1EA0, 0x1EFF, 1, 2 },
+    { 0x2126, 0x2126, 0x3C9 - 0x2126, 1 },     // Ohm sign -> omega
+    { 0x212A, 0x212A, 0x6B - 0x212A, 1 },      // Kelvin sign -> k
+    { 0x212B, 0x212B, 0xE5 - 0x212B, 1 },      // Angstrom sign -> a ring
+    { 0x2160, 0x216F, 16, 1 },          // Roman numerals
+    { 0x24B6, 0x24CF, 26, 1 },          // circled letters
+    { 0x2C00, 0x2C2F, 48, 1 },          // Glagolitic
+    { 0xFF21, 0xFF3A, 32, 1 },          // fullwidth A .. Z
+    { 0x10400, 0x10427, 40, 1 },        // Deseret
+};
+#define NRANGES (sizeof (upper) / sizeof (upper[0]))
+
+static uint16_t lower2[0x800];
+static pthread_once_t lower2Once = PTHREAD_ONCE_INIT;
+
+static void fillLower2 (void);
+#ifdef __SSE2__
+static int lower16 (char *str, size_t r, size_t w);
+#endif
+static int lower8 (char *str, size_t r, size_t w);
+static size_t foldChar (char *str, size_t r, size_t len, size_t *w);
+static uint32_t lowerCodePoint (uint32_t cp);
+static int encode (uint32_t cp, char *out);
+
+size_t foldCase (char *str, size_t len) {
+    size_t r = 0, w = 0;
+    int tableReady = 0;
+    while (r < len) {
+        size_t end = len;
+#ifdef __SSE2__
+        if (r + 16 <= len) {
+            if (lower16 (str, r, w)) {
+                r += 16;
+                w += 16;
+                continue;
+            }
+            end = r + 16;
+        } else
+#endif
+        if (r + 8 <= len) {
+            if (lower8 (str, r, w)) {
+                r += 8;
+                w += 8;
+                continue;
+            }
+            end = r + 8;
+        }
+
+        // a short tail, or a block with a multibyte character in it
+        while (r < end) {
+            unsigned char c = str[r];
+            if (c < 0x80) {
+                str[w++] = (c >= 'A' && c <= 'Z') ? c + 0x20 : c;
+                r++;
+            } else if (c >= 0xC2 && c <= 0xDF && r + 1 < len && (str[r + 1] & 0xC0) == 0x80) {
+                if (!tableReady) {
+                    pthread_once (&lower2Once, fillLower2);
+                    tableReady = 1;
+                }
+                uint32_t cp = lower2[((c & 0x1F) << 6) | (str[r + 1] & 0x3F)];
+                if (cp < 0x80) {
+                    str[w++] = cp;
+                } else {
+                    str[w++] = 0xC0 | (cp >> 6);
+                    str[w++] = 0x80 | (cp & 0x3F);
+                }
+                r += 2;
+            } else {
+                r = foldChar (str, r, len, &w);
+            }
+        }
+    }
+    return w;
+}
+
+static void fillLower2 (void) {
+    for (uint32_t cp = 0; cp < 0x800; cp++) lower2[cp] = lowerCodePoint (cp);
+}
+
+#ifdef __SSE2__
+// Helper: if the 16 bytes at r are all ASCII, lower them into w and return 1
+static int lower16 (char *str, size_t r, size_t w) {
+    __m128i v = _mm_loadu_si128 ((const __m128i *) (str + r));
+    if (_mm_movemask_epi8 (v) != 0) return 0;
+    __m128i isUpper = _mm_and_si128 (_mm_cmpgt_epi8 (v, _mm_set1_epi8 ('A' - 1)),
+                                     _mm_cmpgt_epi8 (_mm_set1_epi8 ('Z' + 1), v));
+    v = _mm_add_epi8 (v, _mm_and_si128 (isUpper, _mm_set1_epi8 (0x20)));
+    _mm_storeu_si128 ((__m128i *) (str + w), v);
+    return 1;
+}
+#endif
+
+// Helper: as lower16, for 8 bytes in a 64-bit word
+static int lower8 (char *str, size_t r, size_t w) {
+    // each byte is below 0x80, so adding to it never carries into the next
+    const uint64_t ones = 0x0101010101010101ULL;
+    uint64_t x;
+    memcpy (&x, str + r, 8);
+    if (x & (0x80 * ones)) return 0;
+    uint64_t atLeastA = x + (0x80 - 'A') * ones;
+    uint64_t pastZ = x + (0x80 - 'Z' - 1) * ones;
+    x |= ((atLeastA & ~pastZ) & (0x80 * ones)) >> 2;
+    memcpy (str + w, &x, 8);
+    return 1;
+}
+
+// Helper: lower the character of three or four bytes at r into *w;
+// returns where the next character starts
+static size_t foldChar (char *str, size_t r, size_t len, size_t *w) {
+    unsigned char c = str[r];
+
+    // decode one sequence; anything malformed is copied a byte at a time
+    int n = (c >= 0xC2 && c <= 0xDF) ? 2 : (c >= 0xE0 && c <= 0xEF) ? 3
+          : (c >= 0xF0 && c <= 0xF4) ? 4 : 0;
+    uint32_t cp = (n == 2) ? c & 0x1F : (n == 3) ? c & 0x0F : c & 0x07;
+    int ok = (n > 0 && r + n <= len);
+    for (int i = 1; ok && i < n; i++) {
+        unsigned char cc = str[r + i];
+        ok = ((cc & 0xC0) == 0x80);
+        cp = (cp << 6) | (cc & 0x3F);
+    }
+    static const uint32_t least[] = { 0, 0, 0x80, 0x800, 0x10000 };
+    if (!ok || cp < least[n] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+        str[(*w)++] = c;
+        return r + 1;
+    }
+
+    *w += encode (lowerCodePoint (cp), str + *w);
+    return r + n;
+}
+
+// Helper: binary search the table of upper case ranges
+static uint32_t lowerCodePoint (uint32_t cp) {
+    if (cp < upper[0].lo) return cp;
+    int lo = 0, hi = NRANGES - 1;
+    while (lo <= hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (cp < upper[mid].lo) {
+            hi = mid - 1;
+        } else if (cp > upper[mid].hi) {
+            lo = mid + 1;
+        } else {
+            if ((cp - upper[mid].lo) % upper[mid].step != 0) return cp;
+            return cp + upper[mid].delta;
+        }
+    }
+    return cp;
+}
+
+// Helper: UTF-8 encoding of cp into out; returns its length.  out may be
+// where cp was read from, as it is never longer.
+static int encode (uint32_t cp, char *out) {
+    if (cp < 0x80) {
+        out[0] = cp;
+        return 1;
+    } else if (cp < 0x800) {
+        out[0] = 0xC0 | (cp >> 6);
+        out[1] = 0x80 | (cp & 0x3F);
+        return 2;
+    } else if (cp < 0x10000) {
+        out[0] = 0xE0 | (cp >> 12);
+        out[1] = 0x80 | ((cp >> 6) & 0x3F);
+        out[2] = 0x80 | (cp & 0x3F);
+        return 3;
+    }
+    out[0] = 0xF0 | (cp >> 18);
+    out[1] = 0x80 | ((cp >> 12) & 0x3F);
+    out[2] = 0x80 | ((cp >> 6) & 0x3F);
+    out[3] = 0x80 | (cp & 0x3F);
+    return 4;
+}
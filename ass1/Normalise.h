@@ -0,0 +1,21 @@
+// Normalise.h ... case folding of UTF-8 words for normaliseWord
+//
+// Runs of ASCII are lowered 16 bytes at a time (SSE2, or 8 at a time in a
+// 64-bit word without it); only multibyte sequences take the slow path,
+// which looks each code point up in a table of upper case ranges.
+
+#ifndef _NORMALISE_GUARD
+#define _NORMALISE_GUARD
+
+#include <stddef.h>
+
+/** Lower the case of the len bytes of UTF-8 text at str, in place.  ASCII
+    is lowered as tolower does in the C locale; other letters by their
+    simple Unicode lower case mapping, when one is in the table.  Bytes that
+    are not valid UTF-8 are left as they are.  A few letters get shorter
+    (e.g. U+212A KELVIN SIGN becomes "k"), none longer, so returns the new
+    length, which is at most len.  Does not '\0'-terminate.
+*/
+size_t foldCase (char *str, size_t len);
+
+#endif
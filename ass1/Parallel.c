@@ -0,0 +1,261 @@
+// Parallel.c ... retrieve with many search words, on several threads
+//
+// Phase 1: the threads take the search words in turn and turn each one's
+// FileList into an array of (filename, tf * idf), still in filename order.
+// Phase 2: filenames sampled from those arrays split the filename range
+// into one slice per thread.  Each thread merges the slices of the arrays
+// into its results one search word at a time, as retrieveInto does, so a
+// file's scores are added in search word order and the threads between
+// them do no more merging than retrieveInto would alone.  Each thread then
+// sorts its results into result order, and the sorted slices are merged
+// into out[] at the end.
+//
+// The threads are a pool, started on first use and kept for later calls.
+// Only one call uses the pool at a time.  A call with one thread or few
+// search words, or made while another has the pool, runs retrieveInto,
+// as splitting the work up would cost more than it saves.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "Query.h"
+#include "Parallel.h"
+
+#define MINWORDS 16     // fewer search words than this are done serially
+#define MAXTHREADS 64
+
+// one search word's scored postings, in filename order
+typedef struct Scored {
+    TfIdfResult *r;
+    int n;
+} Scored;
+
+typedef struct Job {
+    int id, nthreads;
+    InvertedIndexBST tree;
+    char **words;
+    int nwords;
+    int D;
+    Scored *lists;
+    char *lo, *hi;              // this thread's filenames are in [lo, hi); NULL is open
+    TfIdfResult *out;           // in result order
+    int n;
+} Job;
+
+// the worker pool; poolLock covers the rest
+static pthread_mutex_t poolBusy = PTHREAD_MUTEX_INITIALIZER;  // held by the call using it
+static pthread_mutex_t poolLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t poolWork = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t poolDone = PTHREAD_COND_INITIALIZER;
+static int nworkers = 0;
+static void *(*poolFn) (void *);
+static Job *poolJobs;
+static int nextJob = 0, njobs = 0, unfinished = 0;
+
+static void runJobs (Job *jobs, int nthreads, void *(*work) (void *));
+static void *poolWorker (void *cl);
+static void *scoreWords (void *cl);
+static void *mergeSlice (void *cl);
+static int lowerBound (Scored *list, char *filename);
+static int byFilename (const void *a, const void *b);
+
+int parallelRetrieveInto (InvertedIndexBST tree, char *searchWords[], int D,
+                          TfIdfResult out[], int max, int nthreads) {
+    if (nthreads > MAXTHREADS) nthreads = MAXTHREADS;
+    int nwords = 0;
+    while (searchWords[nwords] != NULL) nwords++;
+    if (nthreads <= 1 || nwords < MINWORDS || pthread_mutex_trylock (&poolBusy) != 0) {
+        int n = retrieveInto (tree, searchWords, D, out, max);
+        if (n <= max) return n;
+        // retrieveInto only bounds the count once out[] is full; count exactly
+        pthread_mutex_lock (&poolBusy);
+    }
+    Scored *lists = calloc (nwords + 1, sizeof (Scored));
+    Job *jobs = calloc (nthreads, sizeof (Job));
+    assert(lists != NULL && jobs != NULL);
+    for (int t = 0; t < nthreads; t++) {
+        jobs[t] = (Job) { t, nthreads, tree, searchWords, nwords, D, lists, NULL, NULL, NULL, 0 };
+    }
+    runJobs (jobs, nthreads, scoreWords);
+
+    // pick nthreads - 1 splitting filenames from a sample of every list
+    int total = 0;
+    for (int w = 0; w < nwords; w++) total += lists[w].n;
+    int stride = total / (8 * nthreads) + 1;
+    char **sample = malloc ((total / stride + nwords + 1) * sizeof (char *));
+    assert(sample != NULL);
+    int nsample = 0;
+    for (int w = 0; w < nwords; w++) {
+        for (int i = 0; i < lists[w].n; i += stride) sample[nsample++] = lists[w].r[i].filename;
+    }
+    qsort (sample, nsample, sizeof (char *), byFilename);
+    for (int t = 1; t < nthreads; t++) {
+        char *split = (nsample > 0) ? sample[(long) t * nsample / nthreads] : NULL;
+        jobs[t - 1].hi = jobs[t].lo = split;
+    }
+    runJobs (jobs, nthreads, mergeSlice);
+    pthread_mutex_unlock (&poolBusy);
+
+    // merge the threads' results, each already in result order
+    int n = 0;
+    for (int t = 0; t < nthreads; t++) n += jobs[t].n;
+    if (n <= max) {
+        int *pos = calloc (nthreads, sizeof (int));
+        assert(pos != NULL);
+        for (int k = 0; k < n; k++) {
+            int best = -1;
+            for (int t = 0; t < nthreads; t++) {
+                if (pos[t] < jobs[t].n && (best < 0
+                        || resultCmp (&jobs[t].out[pos[t]], &jobs[best].out[pos[best]]) < 0)) {
+                    best = t;
+                }
+            }
+            out[k] = jobs[best].out[pos[best]++];
+        }
+        free (pos);
+    }
+
+    for (int t = 0; t < nthreads; t++) free (jobs[t].out);
+    for (int w = 0; w < nwords; w++) free (lists[w].r);
+    free (sample);
+    free (jobs);
+    free (lists);
+    return n;
+}
+
+// Helper: run work on every job, with the pool's threads and this one
+static void runJobs (Job *jobs, int nthreads, void *(*work) (void *)) {
+    pthread_mutex_lock (&poolLock);
+    while (nworkers < nthreads - 1) {
+        pthread_t tid;
+        if (pthread_create (&tid, NULL, poolWorker, NULL) != 0) break;
+        pthread_detach (tid);
+        nworkers++;
+    }
+    poolFn = work;
+    poolJobs = jobs;
+    nextJob = 0;
+    njobs = unfinished = nthreads;
+    pthread_cond_broadcast (&poolWork);
+    // this thread takes jobs too, so they all get done however many workers started
+    while (nextJob < njobs) {
+        Job *job = &jobs[nextJob++];
+        pthread_mutex_unlock (&poolLock);
+        work (job);
+        pthread_mutex_lock (&poolLock);
+        unfinished--;
+    }
+    while (unfinished > 0) pthread_cond_wait (&poolDone, &poolLock);
+    pthread_mutex_unlock (&poolLock);
+}
+
+// Helper: thread body of the pool; take jobs until none are left, then wait
+static void *poolWorker (void *cl) {
+    (void) cl;
+    pthread_mutex_lock (&poolLock);
+    while (1) {
+        while (nextJob >= njobs) pthread_cond_wait (&poolWork, &poolLock);
+        void *(*work) (void *) = poolFn;
+        Job *job = &poolJobs[nextJob++];
+        pthread_mutex_unlock (&poolLock);
+        work (job);
+        pthread_mutex_lock (&poolLock);
+        if (--unfinished == 0) pthread_cond_signal (&poolDone);
+    }
+    return NULL;
+}
+
+// Helper: thread body for phase 1; score every nthreads-th search word
+static void *scoreWords (void *cl) {
+    Job *job = cl;
+    for (int w = job->id; w < job->nwords; w += job->nthreads) {
+        char *word = job->words[w];
+        if (termFilterRejects (job->tree, word)) continue;
+        InvertedIndexBST node = findWord (job->tree, word);
+        if (node == NULL) continue;
+
+        int total_file = docFreq (node);
+        double idf = termIdf (job->D, total_file);
+        Scored *list = &job->lists[w];
+        list->r = malloc (total_file * sizeof (TfIdfResult));
+        assert(list->r != NULL);
+        for (FileList curr = node->fileList; curr != NULL; curr = curr->next) {
+            list->r[list->n++] = (TfIdfResult) { curr->filename, curr->tf * idf };
+        }
+    }
+    return NULL;
+}
+
+// Helper: thread body for phase 2; add up and sort the filenames in [lo, hi)
+static void *mergeSlice (void *cl) {
+    Job *job = cl;
+    int *pos = malloc ((job->nwords + 1) * sizeof (int));
+    int *end = malloc ((job->nwords + 1) * sizeof (int));
+    assert(pos != NULL && end != NULL);
+    int size = 0;
+    for (int w = 0; w < job->nwords; w++) {
+        Scored *list = &job->lists[w];
+        pos[w] = (job->lo == NULL) ? 0 : lowerBound (list, job->lo);
+        end[w] = (job->hi == NULL) ? list->n : lowerBound (list, job->hi);
+        size += end[w] - pos[w];
+    }
+
+    // merge each word's slice into acc[], in filename order, through next[]
+    TfIdfResult *acc = malloc ((size + 1) * sizeof (TfIdfResult));
+    TfIdfResult *next = malloc ((size + 1) * sizeof (TfIdfResult));
+    assert(acc != NULL && next != NULL);
+    int n = 0;
+    for (int w = 0; w < job->nwords; w++) {
+        TfIdfResult *r = job->lists[w].r;
+        int i = 0, p = pos[w], k = 0;
+        while (i < n || p < end[w]) {
+            int diff = (p == end[w]) ? -1 : (i == n) ? 1
+                : (acc[i].filename == r[p].filename) ? 0 : strcmp(acc[i].filename, r[p].filename);
+            if (diff < 0) {
+                next[k++] = acc[i++];
+            } else if (diff > 0) {
+                next[k++] = r[p++];
+            } else {
+                next[k] = acc[i++];
+                next[k++].tfidf_sum += r[p++].tfidf_sum;
+            }
+        }
+        TfIdfResult *tmp = acc;
+        acc = next;
+        next = tmp;
+        n = k;
+    }
+    qsort (acc, n, sizeof (TfIdfResult), resultCmp);
+    job->out = acc;
+    job->n = n;
+
+    free (next);
+    free (end);
+    free (pos);
+    return NULL;
+}
+
+// Helper: index of the first entry of list not before filename
+static int lowerBound (Scored *list, char *filename) {
+    int lo = 0, hi = list->n;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (strcmp(list->r[mid].filename, filename) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+static int byFilename (const void *a, const void *b) {
+    return strcmp(*(char **) a, *(char **) b);
+}
@@ -0,0 +1,21 @@
+// Parallel.h ... retrieve with many search words, on several threads
+//
+// Each word's postings are scored on their own, in parallel, and the
+// scored lists are combined by a parallel k-way merge.  The results are
+// the same as retrieve's, to the last bit.  The threads are kept between
+// calls; short queries are run serially.
+
+#ifndef _PARALLEL_GUARD
+#define _PARALLEL_GUARD
+
+#include "invertedIndex.h"
+#include "Query.h"
+
+/** As retrieveInto, using nthreads threads.  Filenames point into the
+    index.  Returns the number of matching files; if that is more than max,
+    out[] is left unspecified.
+*/
+int parallelRetrieveInto (InvertedIndexBST tree, char *searchWords[], int D,
+                          TfIdfResult out[], int max, int nthreads);
+
+#endif
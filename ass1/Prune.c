@@ -0,0 +1,226 @@
+// Prune.c ... static pruning of an inverted index
+//
+// The words are collected by an in-order walk; dropped words are freed
+// and the rest are relinked as a balanced tree.  Truncating a FileList
+// lowers the word's document frequency, and with it calculating_TfIdf's
+// idf, so the kept tf values are scaled by idf(before) / idf(after) to
+// leave their scores unchanged.  Files that only lost low-impact postings
+// then rank as they did before, rather than moving because the idf grew.
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "BTree.h"
+#include "Query.h"
+#include "Prune.h"
+
+typedef struct Size {
+    long words;
+    long postings;
+    long bytes;
+} Size;
+
+static int dropWord (InvertedIndexBST t, int D, PruneOptions *opt, BTree stop);
+static void truncatePostings (InvertedIndexBST t, int D, int max);
+static int byImpact (const void *a, const void *b);
+static void indexSize (InvertedIndexBST t, Size *size);
+static int topK (InvertedIndexBST tree, char **words, int D, TfIdfResult **out, int *max);
+
+InvertedIndexBST pruneInvertedIndex (InvertedIndexBST tree, int D, PruneOptions *opt) {
+    // the kept nodes are rebuilt into a new tree
+    forgetIndex (tree);
+    BTree stop = newBTree ();
+    for (int i = 0; opt->stopwords != NULL && opt->stopwords[i] != NULL; i++) {
+        BTreeInsert (stop, opt->stopwords[i], "");
+    }
+
+    int n = 0, size = 1024;
+    InvertedIndexBST *kept = malloc (size * sizeof (InvertedIndexBST));
+    int top = 0, maxstack = 64;
+    InvertedIndexBST *stack = malloc (maxstack * sizeof (InvertedIndexBST));
+    assert(kept != NULL && stack != NULL);
+    InvertedIndexBST curr = tree;
+    while (curr != NULL || top > 0) {
+        while (curr != NULL) {
+            if (top == maxstack) {
+                maxstack *= 2;
+                stack = realloc (stack, maxstack * sizeof (InvertedIndexBST));
+                assert(stack != NULL);
+            }
+            stack[top++] = curr;
+            curr = curr->left;
+        }
+        curr = stack[--top];
+        InvertedIndexBST next = curr->right;
+        if (dropWord (curr, D, opt, stop)) {
+            curr->left = curr->right = NULL;
+            freeInvertedIndex (curr);
+        } else {
+            if (opt->maxPostings > 0) truncatePostings (curr, D, opt->maxPostings);
+            if (n == size) {
+                size *= 2;
+                kept = realloc (kept, size * sizeof (InvertedIndexBST));
+                assert(kept != NULL);
+            }
+            kept[n++] = curr;
+        }
+        curr = next;
+    }
+
+    InvertedIndexBST root = buildBalanced (kept, 0, n - 1);
+    free (stack);
+    free (kept);
+    dropBTree (stop);
+    return root;
+}
+
+char **readStopwords (char *filename) {
+    FILE *fp = fopen (filename, "r");
+    if (fp == NULL) return NULL;
+    int n = 0, size = 64;
+    char **words = malloc (size * sizeof (char *));
+    assert(words != NULL);
+    char word[100];
+    while (fscanf(fp, "%99s", word) != EOF) {
+        normaliseWord (word);
+        if (n + 1 == size) {
+            size *= 2;
+            words = realloc (words, size * sizeof (char *));
+            assert(words != NULL);
+        }
+        words[n] = malloc (strlen (word) + 1);
+        assert(words[n] != NULL);
+        strcpy (words[n++], word);
+    }
+    fclose (fp);
+    words[n] = NULL;
+    return words;
+}
+
+void freeStopwords (char **stopwords) {
+    if (stopwords == NULL) return;
+    for (int i = 0; stopwords[i] != NULL; i++) free (stopwords[i]);
+    free (stopwords);
+}
+
+void reportPruning (InvertedIndexBST full, InvertedIndexBST pruned, int D,
+                    char **queries[], int k, FILE *fp) {
+    Size before = {0, 0, 0}, after = {0, 0, 0};
+    indexSize (full, &before);
+    indexSize (pruned, &after);
+    fprintf(fp, "%-9s %10s %10s %12s\n", "", "words", "postings", "bytes");
+    fprintf(fp, "%-9s %10ld %10ld %12ld\n", "full", before.words, before.postings, before.bytes);
+    fprintf(fp, "%-9s %10ld %10ld %12ld\n", "pruned", after.words, after.postings, after.bytes);
+    fprintf(fp, "%-9s %9.1f%% %9.1f%% %11.1f%%\n", "saved",
+        100.0 * (before.words - after.words) / (before.words > 0 ? before.words : 1),
+        100.0 * (before.postings - after.postings) / (before.postings > 0 ? before.postings : 1),
+        100.0 * (before.bytes - after.bytes) / (before.bytes > 0 ? before.bytes : 1));
+
+    if (queries == NULL || k <= 0) return;
+    int maxA = 64, maxB = 64;
+    TfIdfResult *a = malloc (maxA * sizeof (TfIdfResult));
+    TfIdfResult *b = malloc (maxB * sizeof (TfIdfResult));
+    assert(a != NULL && b != NULL);
+    int nq = 0, same = 0, sameOrder = 0;
+    double sumOverlap = 0, minOverlap = 1;
+    for (; queries[nq] != NULL; nq++) {
+        int na = topK (full, queries[nq], D, &a, &maxA);
+        int nb = topK (pruned, queries[nq], D, &b, &maxB);
+        if (na > k) na = k;
+        if (nb > k) nb = k;
+        int common = 0, inOrder = (na == nb);
+        for (int i = 0; i < na; i++) {
+            for (int j = 0; j < nb; j++) {
+                if (strcmp(a[i].filename, b[j].filename) == 0) {
+                    common++;
+                    break;
+                }
+            }
+            if (i < nb && strcmp(a[i].filename, b[i].filename) != 0) inOrder = 0;
+        }
+        double overlap = (na > 0) ? (double) common / na : (nb == 0);
+        sumOverlap += overlap;
+        if (overlap < minOverlap) minOverlap = overlap;
+        if (common == na && na == nb) same++;
+        if (inOrder) sameOrder++;
+    }
+    free (a);
+    free (b);
+    if (nq == 0) return;
+    fprintf(fp, "top-%d over %d queries: mean overlap %.3f, min %.3f, "
+        "same files %d, same order %d\n",
+        k, nq, sumOverlap / nq, minOverlap, same, sameOrder);
+}
+
+// Helper: true if t's word is pruned altogether
+static int dropWord (InvertedIndexBST t, int D, PruneOptions *opt, BTree stop) {
+    if (BTreeFind (stop, t->word) != NULL) return 1;
+    if (opt->maxDf > 0 && opt->maxDf < 1) {
+        if (docFreq (t) > opt->maxDf * D) return 1;
+    }
+    return 0;
+}
+
+// Helper: keep the max postings of t with the highest tf, in filename order
+static void truncatePostings (InvertedIndexBST t, int D, int max) {
+    int df = docFreq (t);
+    if (df <= max) return;
+
+    FileList *byTf = malloc (df * sizeof (FileList));
+    assert(byTf != NULL);
+    int i = 0;
+    for (FileList curr = t->fileList; curr != NULL; curr = curr->next) byTf[i++] = curr;
+    qsort (byTf, df, sizeof (FileList), byImpact);
+    // mark the dropped postings, then unlink them
+    for (i = max; i < df; i++) byTf[i]->tf = -1;
+    free (byTf);
+
+    double scale = termIdf (D, df) / termIdf (D, max);
+    FileList *link = &t->fileList;
+    while (*link != NULL) {
+        FileList curr = *link;
+        if (curr->tf < 0) {
+            *link = curr->next;
+            free (curr->filename);
+            free (curr);
+        } else {
+            curr->tf *= scale;
+            link = &curr->next;
+        }
+    }
+}
+
+// Helper: descending tf, then ascending filename
+static int byImpact (const void *a, const void *b) {
+    FileList x = *(FileList *) a, y = *(FileList *) b;
+    if (x->tf != y->tf) return x->tf > y->tf ? -1 : 1;
+    return strcmp(x->filename, y->filename);
+}
+
+// Helper: add up words, postings and malloc'd bytes (words and filenames are 100 bytes)
+static void indexSize (InvertedIndexBST t, Size *size) {
+    if (t == NULL) return;
+    size->words++;
+    size->bytes += sizeof (struct InvertedIndexNode) + 100;
+    for (FileList curr = t->fileList; curr != NULL; curr = curr->next) {
+        size->postings++;
+        size->bytes += sizeof (struct FileListNode) + 100;
+    }
+    indexSize (t->left, size);
+    indexSize (t->right, size);
+}
+
+// Helper: retrieveInto, growing *out until every result fits
+static int topK (InvertedIndexBST tree, char **words, int D, TfIdfResult **out, int *max) {
+    int n;
+    while ((n = retrieveInto (tree, words, D, *out, *max)) > *max) {
+        *max = n;
+        *out = realloc (*out, *max * sizeof (TfIdfResult));
+        assert(*out != NULL);
+    }
+    return n;
+}
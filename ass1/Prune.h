@@ -0,0 +1,43 @@
+// Prune.h ... static pruning of an inverted index
+//
+// Words can be dropped by a stopword list or by their document frequency,
+// and long FileLists can be cut down to their highest-impact postings.
+
+#ifndef _PRUNE_GUARD
+#define _PRUNE_GUARD
+
+#include <stdio.h>
+
+#include "invertedIndex.h"
+
+typedef struct PruneOptions {
+    char **stopwords;   // NULL-terminated list of words to drop, or NULL
+    double maxDf;       // drop words in more than this fraction of files (0 or >= 1 keeps all)
+    int maxPostings;    // keep this many highest-tf postings per word (0 keeps all)
+} PruneOptions;
+
+/** Prune tree (over D documents) in place and return the new root.  When
+    a FileList is truncated the remaining tf values are scaled so that each
+    kept posting's tf-idf is the same as before.
+*/
+InvertedIndexBST pruneInvertedIndex (InvertedIndexBST tree, int D, PruneOptions *opt);
+
+/** Prune every index made by generateInvertedIndex from now on with opt,
+    which must stay valid until the next call; NULL turns pruning off.
+*/
+void usePruning (PruneOptions *opt);
+
+/** Read a file of whitespace-separated stopwords, normalised as words are.
+    Returns a NULL-terminated list, or NULL if the file cannot be read.
+*/
+char **readStopwords (char *filename);
+void freeStopwords (char **stopwords);
+
+/** Compare a pruned index with the full one: words, postings and bytes,
+    and for each query in queries[] (a NULL-terminated list of search word
+    lists), how many of the top k files of retrieve are the same.
+*/
+void reportPruning (InvertedIndexBST full, InvertedIndexBST pruned, int D,
+                    char **queries[], int k, FILE *fp);
+
+#endif
@@ -0,0 +1,125 @@
+// Query.c ... allocation-free versions of calculateTfIdf and retrieve
+//
+// retrieveInto keeps out[] sorted by filename while it adds up the scores
+// of each search word, merging each word's FileList (already in filename
+// order) into it.  The merge runs forwards after sliding the current
+// results to the end of out[], so no second array is needed.  Scores are
+// added in the same order as retrieve does, so the sums are identical.
+
+#include <stdio.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "Query.h"
+
+static void siftDown (TfIdfResult out[], int i, int n, int worstFirst);
+static void sortResults (TfIdfResult out[], int n);
+
+int calculateTfIdfInto (InvertedIndexBST tree, char *searchWord, int D, TfIdfResult out[], int max) {
+    if (searchWord == NULL || termFilterRejects (tree, searchWord)) return 0;
+    InvertedIndexBST node = findWord (tree, searchWord);
+    if (node == NULL) return 0;
+
+    double idf = termIdf (D, docFreq (node));
+    int n = 0;
+    for (FileList curr = node->fileList; curr != NULL; curr = curr->next, n++) {
+        TfIdfResult r = { curr->filename, curr->tf * idf };
+        if (n < max) {
+            out[n] = r;
+            // once full, out[] becomes a heap with the worst result on top
+            if (n == max - 1) {
+                for (int i = max / 2 - 1; i >= 0; i--) siftDown (out, i, max, 1);
+            }
+        } else if (max > 0 && resultCmp (&r, &out[0]) < 0) {
+            out[0] = r;
+            siftDown (out, 0, max, 1);
+        }
+    }
+    sortResults (out, n < max ? n : max);
+    return n;
+}
+
+int retrieveInto (InvertedIndexBST tree, char *searchWords[], int D, TfIdfResult out[], int max) {
+    int n = 0;
+    int overflow = 0;
+    for (int w = 0; searchWords[w] != NULL; w++) {
+        if (termFilterRejects (tree, searchWords[w])) continue;
+        InvertedIndexBST node = findWord (tree, searchWords[w]);
+        if (node == NULL) continue;
+
+        if (overflow) {
+            // can no longer merge; just make sure the next array is big enough
+            for (FileList curr = node->fileList; curr != NULL; curr = curr->next) n++;
+            continue;
+        }
+
+        // count the filenames not already in out[0..n)
+        int nnew = 0;
+        int i = 0;
+        for (FileList curr = node->fileList; curr != NULL; curr = curr->next) {
+            while (i < n && strcmp(out[i].filename, curr->filename) < 0) i++;
+            if (i == n || strcmp(out[i].filename, curr->filename) != 0) nnew++;
+        }
+        if (n + nnew > max) {
+            overflow = 1;
+            n += nnew;
+            continue;
+        }
+
+        // slide the current results to the end, then merge forwards
+        int r = max - n;
+        memmove (&out[r], &out[0], n * sizeof (TfIdfResult));
+        double idf = termIdf (D, docFreq (node));
+        int k = 0;
+        FileList curr = node->fileList;
+        while (r < max || curr != NULL) {
+            int diff = (r == max) ? 1 : (curr == NULL) ? -1
+                : strcmp(out[r].filename, curr->filename);
+            if (diff < 0) {
+                out[k++] = out[r++];
+            } else if (diff > 0) {
+                out[k++] = (TfIdfResult) { curr->filename, curr->tf * idf };
+                curr = curr->next;
+            } else {
+                out[k] = out[r++];
+                out[k++].tfidf_sum += curr->tf * idf;
+                curr = curr->next;
+            }
+        }
+        n = k;
+    }
+    if (overflow) return n;
+    sortResults (out, n);
+    return n;
+}
+
+int resultCmp (const void *a, const void *b) {
+    const TfIdfResult *x = a, *y = b;
+    if (x->tfidf_sum != y->tfidf_sum) return x->tfidf_sum > y->tfidf_sum ? -1 : 1;
+    return strcmp(x->filename, y->filename);
+}
+
+// Helper: restore the heap below i; worstFirst puts the last result on top
+static void siftDown (TfIdfResult out[], int i, int n, int worstFirst) {
+    while (2 * i + 1 < n) {
+        int c = 2 * i + 1;
+        if (c + 1 < n && ((resultCmp (&out[c], &out[c + 1]) < 0) == worstFirst)) c++;
+        if ((resultCmp (&out[i], &out[c]) < 0) != worstFirst) break;
+        TfIdfResult tmp = out[i];
+        out[i] = out[c];
+        out[c] = tmp;
+        i = c;
+    }
+}
+
+// Helper: in-place heapsort into result order
+static void sortResults (TfIdfResult out[], int n) {
+    for (int i = n / 2 - 1; i >= 0; i--) siftDown (out, i, n, 1);
+    for (int end = n - 1; end > 0; end--) {
+        TfIdfResult tmp = out[0];
+        out[0] = out[end];
+        out[end] = tmp;
+        siftDown (out, 0, end, 1);
+    }
+}
@@ -0,0 +1,35 @@
+// Query.h ... allocation-free versions of calculateTfIdf and retrieve
+//
+// Results are written to an array supplied by the caller.  Each filename
+// points at the filename stored in the index, so it stays valid for as
+// long as the index does and must not be freed.
+
+#ifndef _QUERY_GUARD
+#define _QUERY_GUARD
+
+#include "invertedIndex.h"
+
+typedef struct TfIdfResult {
+    char *filename;     // owned by the index
+    double tfidf_sum;
+} TfIdfResult;
+
+/** Same results, in the same order, as calculateTfIdf.  Returns the number
+    of matching files.  If that is more than max, only the first max
+    results (in order) are stored.
+*/
+int calculateTfIdfInto (InvertedIndexBST tree, char *searchWord, int D, TfIdfResult out[], int max);
+
+/** Same results, in the same order, as retrieve.  Returns the number of
+    matching files.  out[] is also used as working space, so if max is too
+    small the contents of out[] are unspecified and the value returned is
+    an array size (at least the number of matches) to repeat the call with.
+*/
+int retrieveInto (InvertedIndexBST tree, char *searchWords[], int D, TfIdfResult out[], int max);
+
+/** qsort comparator for result order: descending tfidf_sum, then
+    ascending filename.
+*/
+int resultCmp (const void *a, const void *b);
+
+#endif
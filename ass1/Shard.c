@@ -0,0 +1,355 @@
+// Shard.c ... an inverted index split into term-partitioned shards
+//
+// Splitting moves the nodes rather than copying them: an in-order walk
+// hands each node to its shard, so each shard's nodes arrive in word order
+// and the shard is relinked as a balanced tree.  A query runs retrieveInto
+// on each shard that owns one of its words, and merges the partial results
+// by filename, adding them in shard order so the sums do not depend on
+// which thread finishes first.
+//
+// Each shard has a thread, started with the index and kept until it is
+// dropped, and its own word and result buffers, which only grow, so a
+// query neither starts threads nor (once warmed up) allocates.  Queries
+// on one index take turns.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "Query.h"
+#include "Shard.h"
+
+// the part of a query sent to one shard
+typedef struct ShardQuery {
+    InvertedIndexBST tree;
+    char **words;               // NULL-terminated
+    int nwords, maxwords;
+    int D;
+    TfIdfResult *out;           // partial results, in filename order
+    int n, max;
+    int pending;                // waiting for this shard's thread
+    struct ShardedIndexRep *si;
+} ShardQuery;
+
+typedef struct ShardedIndexRep {
+    int nshards;
+    InvertedIndexBST *shard;
+    ShardQuery *q;              // one per shard, reused by every query
+    pthread_t *tid;
+    int nthreads;               // shards 0 .. nthreads - 1 have a thread
+    pthread_mutex_t query;      // held for the whole of a query
+    pthread_mutex_t lock;       // covers pending, unfinished and stopping
+    pthread_cond_t work, done;
+    int unfinished, stopping;
+    TfIdfResult *merged;        // gather buffers
+    int *pos;
+    int maxmerged;
+} ShardedIndexRep;
+
+static unsigned shardOf (char *word, int nshards);
+static void *shardThread (void *cl);
+static void searchShard (ShardQuery *q);
+static int byFilename (const void *a, const void *b);
+static void countTree (InvertedIndexBST t, long *words, long *postings);
+
+ShardedIndex newShardedIndex (InvertedIndexBST tree, int nshards) {
+    assert(nshards > 0);
+    // the nodes are rearranged into shards, so tree's root goes away
+    forgetIndex (tree);
+    ShardedIndex new = malloc (sizeof (*new));
+    assert(new != NULL);
+    new->nshards = nshards;
+    new->shard = calloc (nshards, sizeof (InvertedIndexBST));
+    assert(new->shard != NULL);
+
+    InvertedIndexBST **nodes = calloc (nshards, sizeof (InvertedIndexBST *));
+    int *n = calloc (nshards, sizeof (int));
+    int *size = calloc (nshards, sizeof (int));
+    assert(nodes != NULL && n != NULL && size != NULL);
+
+    // iterative in-order walk, since tree may be far from balanced
+    int top = 0, maxstack = 64;
+    InvertedIndexBST *stack = malloc (maxstack * sizeof (InvertedIndexBST));
+    assert(stack != NULL);
+    InvertedIndexBST curr = tree;
+    while (curr != NULL || top > 0) {
+        while (curr != NULL) {
+            if (top == maxstack) {
+                maxstack *= 2;
+                stack = realloc (stack, maxstack * sizeof (InvertedIndexBST));
+                assert(stack != NULL);
+            }
+            stack[top++] = curr;
+            curr = curr->left;
+        }
+        curr = stack[--top];
+        InvertedIndexBST next = curr->right;
+        unsigned s = shardOf (curr->word, nshards);
+        if (n[s] == size[s]) {
+            size[s] = size[s] > 0 ? 2 * size[s] : 256;
+            nodes[s] = realloc (nodes[s], size[s] * sizeof (InvertedIndexBST));
+            assert(nodes[s] != NULL);
+        }
+        nodes[s][n[s]++] = curr;
+        curr = next;
+    }
+    free (stack);
+
+    for (int s = 0; s < nshards; s++) {
+        new->shard[s] = buildBalanced (nodes[s], 0, n[s] - 1);
+        free (nodes[s]);
+    }
+    free (nodes);
+    free (n);
+    free (size);
+
+    new->q = calloc (nshards, sizeof (ShardQuery));
+    new->tid = malloc (nshards * sizeof (pthread_t));
+    new->pos = malloc (nshards * sizeof (int));
+    new->maxmerged = 64;
+    new->merged = malloc (new->maxmerged * sizeof (TfIdfResult));
+    assert(new->q != NULL && new->tid != NULL && new->pos != NULL && new->merged != NULL);
+    pthread_mutex_init (&new->query, NULL);
+    pthread_mutex_init (&new->lock, NULL);
+    pthread_cond_init (&new->work, NULL);
+    pthread_cond_init (&new->done, NULL);
+    new->unfinished = new->stopping = 0;
+    for (int s = 0; s < nshards; s++) {
+        ShardQuery *q = &new->q[s];
+        q->tree = new->shard[s];
+        q->si = new;
+        q->maxwords = 8;
+        q->words = malloc (q->maxwords * sizeof (char *));
+        q->max = 64;
+        q->out = malloc (q->max * sizeof (TfIdfResult));
+        assert(q->words != NULL && q->out != NULL);
+    }
+    // a shard without a thread is searched by the querying thread instead
+    new->nthreads = 0;
+    while (new->nthreads < nshards
+            && pthread_create (&new->tid[new->nthreads], NULL, shardThread, &new->q[new->nthreads]) == 0) {
+        new->nthreads++;
+    }
+    return new;
+}
+
+ShardedIndex generateShardedIndex (char *collectionFilename, int nshards) {
+    return newShardedIndex (generateInvertedIndex (collectionFilename), nshards);
+}
+
+void dropShardedIndex (ShardedIndex si) {
+    if (si == NULL) return;
+    pthread_mutex_lock (&si->lock);
+    si->stopping = 1;
+    pthread_cond_broadcast (&si->work);
+    pthread_mutex_unlock (&si->lock);
+    for (int s = 0; s < si->nthreads; s++) pthread_join (si->tid[s], NULL);
+    pthread_mutex_destroy (&si->query);
+    pthread_mutex_destroy (&si->lock);
+    pthread_cond_destroy (&si->work);
+    pthread_cond_destroy (&si->done);
+
+    for (int s = 0; s < si->nshards; s++) {
+        freeInvertedIndex (si->shard[s]);
+        free (si->q[s].words);
+        free (si->q[s].out);
+    }
+    free (si->merged);
+    free (si->pos);
+    free (si->tid);
+    free (si->q);
+    free (si->shard);
+    free (si);
+}
+
+int shardCount (ShardedIndex si) {
+    return si->nshards;
+}
+
+InvertedIndexBST shardFor (ShardedIndex si, char *word) {
+    return si->shard[shardOf (word, si->nshards)];
+}
+
+int shardedRetrieveInto (ShardedIndex si, char *searchWords[], int D, TfIdfResult out[], int max) {
+    int nwords = 0;
+    while (searchWords[nwords] != NULL) nwords++;
+    pthread_mutex_lock (&si->query);
+
+    // scatter: give each shard the words it owns, in query order
+    int S = si->nshards;
+    ShardQuery *q = si->q;
+    for (int s = 0; s < S; s++) {
+        if (q[s].maxwords < nwords + 1) {
+            q[s].maxwords = nwords + 1;
+            q[s].words = realloc (q[s].words, q[s].maxwords * sizeof (char *));
+            assert(q[s].words != NULL);
+        }
+        q[s].nwords = 0;
+        q[s].n = 0;
+        q[s].D = D;
+    }
+    for (int w = 0; w < nwords; w++) {
+        ShardQuery *sq = &q[shardOf (searchWords[w], S)];
+        sq->words[sq->nwords++] = searchWords[w];
+    }
+
+    // wake the shards' threads; the last shard, and any without a
+    // thread, are searched on this one
+    int last = -1;
+    for (int s = 0; s < S; s++) {
+        q[s].words[q[s].nwords] = NULL;
+        if (q[s].nwords > 0) last = s;
+    }
+    pthread_mutex_lock (&si->lock);
+    for (int s = 0; s < last && s < si->nthreads; s++) {
+        if (q[s].nwords == 0) continue;
+        q[s].pending = 1;
+        si->unfinished++;
+    }
+    if (si->unfinished > 0) pthread_cond_broadcast (&si->work);
+    pthread_mutex_unlock (&si->lock);
+    for (int s = si->nthreads; s < last; s++) {
+        if (q[s].nwords > 0) searchShard (&q[s]);
+    }
+    if (last >= 0) searchShard (&q[last]);
+    pthread_mutex_lock (&si->lock);
+    while (si->unfinished > 0) pthread_cond_wait (&si->done, &si->lock);
+    pthread_mutex_unlock (&si->lock);
+
+    // gather: merge the partial results by filename, adding in shard order
+    int total = 0;
+    for (int s = 0; s < S; s++) total += q[s].n;
+    if (total > si->maxmerged) {
+        si->maxmerged = total;
+        si->merged = realloc (si->merged, si->maxmerged * sizeof (TfIdfResult));
+        assert(si->merged != NULL);
+    }
+    TfIdfResult *merged = si->merged;
+    int *pos = si->pos;
+    memset (pos, 0, S * sizeof (int));
+    int k = 0;
+    while (1) {
+        char *least = NULL;
+        for (int s = 0; s < S; s++) {
+            if (pos[s] < q[s].n
+                && (least == NULL || strcmp(q[s].out[pos[s]].filename, least) < 0)) {
+                least = q[s].out[pos[s]].filename;
+            }
+        }
+        if (least == NULL) break;
+        merged[k] = (TfIdfResult) { least, 0 };
+        for (int s = 0; s < S; s++) {
+            if (pos[s] < q[s].n && strcmp(q[s].out[pos[s]].filename, least) == 0) {
+                merged[k].tfidf_sum += q[s].out[pos[s]++].tfidf_sum;
+            }
+        }
+        k++;
+    }
+    if (k <= max) {
+        qsort (merged, k, sizeof (TfIdfResult), resultCmp);
+        memcpy (out, merged, k * sizeof (TfIdfResult));
+    }
+
+    pthread_mutex_unlock (&si->query);
+    return k;
+}
+
+TfIdfList shardedRetrieve (ShardedIndex si, char *searchWords[], int D) {
+    int max = 64;
+    TfIdfResult *out = malloc (max * sizeof (TfIdfResult));
+    assert(out != NULL);
+    int n;
+    while ((n = shardedRetrieveInto (si, searchWords, D, out, max)) > max) {
+        max = n;
+        out = realloc (out, max * sizeof (TfIdfResult));
+        assert(out != NULL);
+    }
+
+    TfIdfList head = NULL;
+    TfIdfList *link = &head;
+    for (int i = 0; i < n; i++) {
+        *link = newTfIdfList (out[i].filename, out[i].tfidf_sum);
+        link = &(*link)->next;
+    }
+    free (out);
+    return head;
+}
+
+void shardReport (ShardedIndex si, FILE *fp) {
+    long totalWords = 0, totalPostings = 0;
+    long maxWords = 0, maxPostings = 0;
+    fprintf(fp, "shard %10s %10s %6s\n", "words", "postings", "depth");
+    for (int s = 0; s < si->nshards; s++) {
+        long words = 0, postings = 0;
+        countTree (si->shard[s], &words, &postings);
+        fprintf(fp, "%5d %10ld %10ld %6d\n", s, words, postings, depth (si->shard[s]));
+        totalWords += words;
+        totalPostings += postings;
+        if (words > maxWords) maxWords = words;
+        if (postings > maxPostings) maxPostings = postings;
+    }
+    double meanWords = (double) totalWords / si->nshards;
+    double meanPostings = (double) totalPostings / si->nshards;
+    fprintf(fp, "total %10ld %10ld\n", totalWords, totalPostings);
+    fprintf(fp, "max/mean words %.3f, postings %.3f\n",
+        meanWords > 0 ? maxWords / meanWords : 0,
+        meanPostings > 0 ? maxPostings / meanPostings : 0);
+}
+
+// Helper: FNV-1a hash of word, reduced to a shard number
+static unsigned shardOf (char *word, int nshards) {
+    uint32_t h = 2166136261u;
+    for (unsigned char *c = (unsigned char *) word; *c != '\0'; c++) {
+        h = (h ^ *c) * 16777619u;
+    }
+    h ^= h >> 16;
+    return h % (unsigned) nshards;
+}
+
+// Helper: thread body for one shard; search its part of each query
+static void *shardThread (void *cl) {
+    ShardQuery *q = cl;
+    ShardedIndex si = q->si;
+    pthread_mutex_lock (&si->lock);
+    while (1) {
+        while (!q->pending && !si->stopping) pthread_cond_wait (&si->work, &si->lock);
+        if (si->stopping) break;
+        pthread_mutex_unlock (&si->lock);
+        searchShard (q);
+        pthread_mutex_lock (&si->lock);
+        q->pending = 0;
+        if (--si->unfinished == 0) pthread_cond_signal (&si->done);
+    }
+    pthread_mutex_unlock (&si->lock);
+    return NULL;
+}
+
+// Helper: run one shard's part of the query, growing its result buffer
+static void searchShard (ShardQuery *q) {
+    while ((q->n = retrieveInto (q->tree, q->words, q->D, q->out, q->max)) > q->max) {
+        q->max = q->n;
+        q->out = realloc (q->out, q->max * sizeof (TfIdfResult));
+        assert(q->out != NULL);
+    }
+    qsort (q->out, q->n, sizeof (TfIdfResult), byFilename);
+}
+
+static int byFilename (const void *a, const void *b) {
+    return strcmp(((TfIdfResult *) a)->filename, ((TfIdfResult *) b)->filename);
+}
+
+// Helper: add up the words and postings in the tree
+static void countTree (InvertedIndexBST t, long *words, long *postings) {
+    if (t == NULL) return;
+    (*words)++;
+    for (FileList curr = t->fileList; curr != NULL; curr = curr->next) (*postings)++;
+    countTree (t->left, words, postings);
+    countTree (t->right, words, postings);
+}
@@ -0,0 +1,46 @@
+// Shard.h ... an inverted index split into term-partitioned shards
+//
+// Each word lives in exactly one shard, chosen by a hash of the word, and
+// each shard is an ordinary (balanced) InvertedIndexBST.  A query sends
+// each shard the search words it owns, the shards are searched in
+// parallel, and their per-file partial sums are merged.
+
+#ifndef _SHARD_GUARD
+#define _SHARD_GUARD
+
+#include <stdio.h>
+
+#include "invertedIndex.h"
+#include "Query.h"
+
+typedef struct ShardedIndexRep *ShardedIndex;
+
+/** Split tree into nshards shards.  The nodes of tree are moved into the
+    shards, so tree must not be used (or freed) afterwards.
+*/
+ShardedIndex newShardedIndex (InvertedIndexBST tree, int nshards);
+
+// generateInvertedIndex, then split the result into nshards shards
+ShardedIndex generateShardedIndex (char *collectionFilename, int nshards);
+
+// free the shards with all their words and FileLists
+void dropShardedIndex (ShardedIndex si);
+
+// the number of shards and the shard (tree) that owns word
+int shardCount (ShardedIndex si);
+InvertedIndexBST shardFor (ShardedIndex si, char *word);
+
+/** As retrieveInto, with the shards searched in parallel.  The sums are
+    added shard by shard, so they can differ from retrieve in the last bit
+    when a file matches words from more than one shard.  Calls on the
+    same index take turns.
+*/
+int shardedRetrieveInto (ShardedIndex si, char *searchWords[], int D, TfIdfResult out[], int max);
+
+// as retrieve, with the shards searched in parallel
+TfIdfList shardedRetrieve (ShardedIndex si, char *searchWords[], int D);
+
+// print the words, postings and depth of each shard, and how even they are
+void shardReport (ShardedIndex si, FILE *fp);
+
+#endif
@@ -0,0 +1,503 @@
+// Snapshot.c ... consistent read snapshots of an index that is being updated
+//
+// Versions form a list from oldest to current.  Adding a file copies every
+// tree node on the path to each of its words, and the FileList nodes in
+// front of the new posting, into the next version; the nodes that were
+// copied are that version's garbage, since the next version no longer
+// links to them.  Older versions may still share them, so a version's
+// garbage is only freed once it and every older version have no readers
+// (an RCU-style grace period).  The store's lock only covers pinning,
+// unpinning and publishing, never the copying, so readers are not held up
+// while an update is being built.
+//
+// Re-adding a file replaces its postings.  The store keeps the set of
+// files it has indexed, so a re-add leaves D alone; the file's old words
+// are found by walking the current tree, and those it no longer has lose
+// their posting the same way, by copying the path to them.  A word left
+// with no postings is unlinked, its successor copied into its place.
+//
+// A file's new words are inserted median-first, so a run of them that
+// lands in one gap makes a balanced subtree rather than a chain.  Over many
+// updates the tree is kept balanced as a scapegoat tree is: a word added
+// deeper than log3/2 of the number of words has an ancestor more than 2/3
+// of whose subtree is on one side, and that subtree is rebuilt balanced.
+// Its nodes are copied as the path is, so older versions keep their shape.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "BTree.h"
+#include "Snapshot.h"
+
+typedef struct Version {
+    InvertedIndexBST tree;
+    int D;
+    long nwords;                // words in tree
+    int refs;                   // readers holding this version
+    int dropAll;                // the next version shares nothing with this one
+    InvertedIndexBST *oldNodes; // nodes the next version copied
+    int nnodes, maxnodes;
+    FileList *oldFiles;         // FileListNodes the next version copied
+    int nfiles, maxfiles;
+    struct Version *newer;
+} Version;
+
+typedef struct SnapshotStoreRep {
+    pthread_mutex_t lock;       // version list and refs
+    pthread_mutex_t writer;     // one update at a time
+    Version *oldest;
+    Version *current;
+    BTree files;                // every file indexed so far (writer only)
+} SnapshotStoreRep;
+
+// pointers to nodes made during the current update, which can be changed in place
+typedef struct PtrSet {
+    void **slots;
+    int n, size;
+} PtrSet;
+
+// a word of the file being added, and its tf
+typedef struct Added {
+    char *word;
+    double tf;
+} Added;
+
+typedef struct Update {
+    Version *old;               // collects what the update copies
+    InvertedIndexBST root;
+    long nwords;                // words in root
+    char *filename;
+    double n_word;
+    PtrSet fresh;
+    Added *added;               // the file's words, in order
+    int nadded;
+    InvertedIndexBST **path;    // links from the root to the word being added
+    int maxpath;
+} Update;
+
+static Version *newVersion (InvertedIndexBST tree, int D, long nwords);
+static void freeVersion (Version *v);
+static void publish (SnapshotStore s, Version *v);
+static void reclaim (SnapshotStore s);
+static void findStale (InvertedIndexBST t, char *filename, BTree words, BTree stale);
+static void addWord (char *word, FileList files, void *cl);
+static void insertMedianFirst (Update *u, int lo, int hi);
+static void dropWord (char *word, FileList files, void *cl);
+static InvertedIndexBST ownNode (Update *u, InvertedIndexBST t);
+static InvertedIndexBST cowInsert (Update *u, char *word, double tf);
+static void setPath (Update *u, int d, InvertedIndexBST *link);
+static void rebuildScapegoat (Update *u, int d);
+static int collectNodes (InvertedIndexBST t, InvertedIndexBST *nodes, int n);
+static long countNodes (InvertedIndexBST t);
+static InvertedIndexBST cowRemove (Update *u, char *word);
+static FileList cowPosting (Update *u, FileList head, int add, double tf);
+static void retireNode (Version *v, InvertedIndexBST t);
+static void retireFile (Version *v, FileList f);
+static void setAdd (PtrSet *set, void *p);
+static int setHas (PtrSet *set, void *p);
+
+SnapshotStore newSnapshotStore (InvertedIndexBST tree, int D) {
+    SnapshotStore new = malloc (sizeof (*new));
+    assert(new != NULL);
+    pthread_mutex_init (&new->lock, NULL);
+    pthread_mutex_init (&new->writer, NULL);
+    new->oldest = new->current = newVersion (tree, D, countNodes (tree));
+    new->files = newBTree ();
+    collectNames (new->files, tree);
+    return new;
+}
+
+void dropSnapshotStore (SnapshotStore s) {
+    if (s == NULL) return;
+    Version *v = s->oldest;
+    while (v != s->current) {
+        Version *next = v->newer;
+        freeVersion (v);
+        v = next;
+    }
+    freeInvertedIndex (s->current->tree);
+    freeVersion (s->current);
+    dropBTree (s->files);
+    pthread_mutex_destroy (&s->lock);
+    pthread_mutex_destroy (&s->writer);
+    free (s);
+}
+
+Snapshot snapshotAcquire (SnapshotStore s) {
+    pthread_mutex_lock (&s->lock);
+    Version *v = s->current;
+    v->refs++;
+    pthread_mutex_unlock (&s->lock);
+    return v;
+}
+
+void snapshotRelease (SnapshotStore s, Snapshot snap) {
+    pthread_mutex_lock (&s->lock);
+    snap->refs--;
+    pthread_mutex_unlock (&s->lock);
+    reclaim (s);
+}
+
+InvertedIndexBST snapshotTree (Snapshot snap) {
+    return snap->tree;
+}
+
+int snapshotDocs (Snapshot snap) {
+    return snap->D;
+}
+
+int snapshotAddFile (SnapshotStore s, char *filename) {
+    FILE *txt = fopen (filename, "r");
+    if (txt == NULL) return 0;
+
+    // count each distinct word of the file first
+    BTree words = newBTree ();
+    char word[100];
+    long nwords = 0;
+    while (fscanf(txt, "%99s", word) != EOF) {
+        nwords++;
+        if (normaliseWord (word)[0] == '\0') continue;
+        BTreeInsert (words, word, filename);
+    }
+    fclose (txt);
+
+    pthread_mutex_lock (&s->writer);
+    // only writers change current, so it cannot go away while we hold writer
+    Version *old = s->current;
+    int readd = BTreeFind (s->files, filename) != NULL;
+    Update u = { .old = old, .root = old->tree, .nwords = old->nwords,
+                 .filename = filename, .n_word = nwords };
+    u.fresh.size = 1024;
+    u.fresh.n = 0;
+    u.fresh.slots = calloc (u.fresh.size, sizeof (void *));
+    u.added = malloc ((BTreeNumTerms (words) + 1) * sizeof (Added));
+    u.maxpath = 64;
+    u.path = malloc (u.maxpath * sizeof (InvertedIndexBST *));
+    assert(u.fresh.slots != NULL && u.added != NULL && u.path != NULL);
+    if (readd) {
+        // words of the old version of the file that the new one lacks
+        BTree stale = newBTree ();
+        findStale (old->tree, filename, words, stale);
+        BTreeWalk (stale, dropWord, &u);
+        dropBTree (stale);
+    } else {
+        BTreeInsert (s->files, filename, filename);
+    }
+    BTreeWalk (words, addWord, &u);
+    insertMedianFirst (&u, 0, u.nadded - 1);
+    free (u.path);
+    free (u.added);
+    free (u.fresh.slots);
+    dropBTree (words);
+
+    publish (s, newVersion (u.root, readd ? old->D : old->D + 1, u.nwords));
+    pthread_mutex_unlock (&s->writer);
+    return 1;
+}
+
+void snapshotReplace (SnapshotStore s, InvertedIndexBST tree, int D) {
+    pthread_mutex_lock (&s->writer);
+    s->current->dropAll = 1;
+    dropBTree (s->files);
+    s->files = newBTree ();
+    collectNames (s->files, tree);
+    publish (s, newVersion (tree, D, countNodes (tree)));
+    pthread_mutex_unlock (&s->writer);
+}
+
+static Version *newVersion (InvertedIndexBST tree, int D, long nwords) {
+    Version *new = calloc (1, sizeof (*new));
+    assert(new != NULL);
+    new->tree = tree;
+    new->D = D;
+    new->nwords = nwords;
+    return new;
+}
+
+// Helper: free what v no longer shares with the next version, and v itself
+static void freeVersion (Version *v) {
+    for (int i = 0; i < v->nnodes; i++) {
+        // any of them may have been the root a filter was built for
+        forgetIndex (v->oldNodes[i]);
+        free (v->oldNodes[i]->word);
+        free (v->oldNodes[i]);
+    }
+    for (int i = 0; i < v->nfiles; i++) {
+        free (v->oldFiles[i]->filename);
+        free (v->oldFiles[i]);
+    }
+    if (v->dropAll && v->newer != NULL) freeInvertedIndex (v->tree);
+    free (v->oldNodes);
+    free (v->oldFiles);
+    free (v);
+}
+
+// Helper: make v the current version
+static void publish (SnapshotStore s, Version *v) {
+    pthread_mutex_lock (&s->lock);
+    s->current->newer = v;
+    s->current = v;
+    pthread_mutex_unlock (&s->lock);
+    // an unread old version can be reclaimed straight away
+    reclaim (s);
+}
+
+// Helper: free the oldest versions once none of them has readers
+static void reclaim (SnapshotStore s) {
+    // detach them under the lock, free them outside it
+    pthread_mutex_lock (&s->lock);
+    Version *first = s->oldest;
+    while (s->oldest != s->current && s->oldest->refs == 0) {
+        s->oldest = s->oldest->newer;
+    }
+    Version *stop = s->oldest;
+    pthread_mutex_unlock (&s->lock);
+
+    while (first != stop) {
+        Version *next = first->newer;
+        freeVersion (first);
+        first = next;
+    }
+}
+
+// Helper: add to stale the words of t with a posting for filename that
+// are not in words
+static void findStale (InvertedIndexBST t, char *filename, BTree words, BTree stale) {
+    if (t == NULL) return;
+    findStale (t->left, filename, words, stale);
+    FileList curr = t->fileList;
+    while (curr != NULL && strcmp(curr->filename, filename) < 0) curr = curr->next;
+    if (curr != NULL && strcmp(curr->filename, filename) == 0
+            && BTreeFind (words, t->word) == NULL) {
+        BTreeInsert (stale, t->word, filename);
+    }
+    findStale (t->right, filename, words, stale);
+}
+
+// Helper: BTreeWalk visitor; files->tf holds the word's count in the file
+static void addWord (char *word, FileList files, void *cl) {
+    Update *u = cl;
+    u->added[u->nadded++] = (Added) { word, files->tf / u->n_word };
+}
+
+// Helper: insert u->added[lo..hi], each middle word before those either side of it
+static void insertMedianFirst (Update *u, int lo, int hi) {
+    if (lo > hi) return;
+    int mid = lo + (hi - lo) / 2;
+    u->root = cowInsert (u, u->added[mid].word, u->added[mid].tf);
+    insertMedianFirst (u, lo, mid - 1);
+    insertMedianFirst (u, mid + 1, hi);
+}
+
+// Helper: BTreeWalk visitor; the file no longer has word
+static void dropWord (char *word, FileList files, void *cl) {
+    Update *u = cl;
+    u->root = cowRemove (u, word);
+}
+
+// Helper: t, if this update made it, or else a copy of t the update can change
+static InvertedIndexBST ownNode (Update *u, InvertedIndexBST t) {
+    if (setHas (&u->fresh, t)) return t;
+    InvertedIndexBST copy = malloc (sizeof (*copy));
+    assert(copy != NULL);
+    *copy = *t;
+    copy->word = malloc (100 * sizeof (char));
+    assert(copy->word != NULL);
+    strcpy (copy->word, t->word);
+    setAdd (&u->fresh, copy);
+    retireNode (u->old, t);
+    return copy;
+}
+
+// Helper: add a posting for u->filename, copying the path to word
+static InvertedIndexBST cowInsert (Update *u, char *word, double tf) {
+    InvertedIndexBST root = u->root;
+    InvertedIndexBST *link = &root;
+    InvertedIndexBST t = root;
+    int d = 0;
+    while (t != NULL) {
+        t = *link = ownNode (u, t);
+        int diff = strcmp(word, t->word);
+        if (diff == 0) {
+            t->fileList = cowPosting (u, t->fileList, 1, tf);
+            return root;
+        }
+        setPath (u, d++, link);
+        link = (diff < 0) ? &t->left : &t->right;
+        t = *link;
+    }
+    InvertedIndexBST new = newBST (word, u->filename);
+    new->fileList->tf = tf;
+    setAdd (&u->fresh, new);
+    *link = new;
+    setPath (u, d, link);
+    u->nwords++;
+    if (d > log (u->nwords) / log (1.5)) rebuildScapegoat (u, d);
+    return root;
+}
+
+// Helper: record link as the d-th link of the path from the root
+static void setPath (Update *u, int d, InvertedIndexBST *link) {
+    if (d == u->maxpath) {
+        u->maxpath *= 2;
+        u->path = realloc (u->path, u->maxpath * sizeof (InvertedIndexBST *));
+        assert(u->path != NULL);
+    }
+    u->path[d] = link;
+}
+
+// Helper: the word just added at depth d is too deep; rebuild, balanced,
+// the subtree of the lowest ancestor that has more than 2/3 of its nodes
+// on the side of the path.  Every node of the path is already this
+// update's; the rest of the subtree is copied.
+static void rebuildScapegoat (Update *u, int d) {
+    long size = 1;
+    for (int i = d - 1; i >= 0; i--) {
+        InvertedIndexBST t = *u->path[i];
+        InvertedIndexBST child = *u->path[i + 1];
+        long total = size + 1 + countNodes (child == t->left ? t->right : t->left);
+        if (3 * size > 2 * total) {
+            InvertedIndexBST *nodes = malloc (total * sizeof (InvertedIndexBST));
+            assert(nodes != NULL);
+            collectNodes (t, nodes, 0);
+            for (int j = 0; j < total; j++) nodes[j] = ownNode (u, nodes[j]);
+            *u->path[i] = buildBalanced (nodes, 0, total - 1);
+            free (nodes);
+            return;
+        }
+        size = total;
+    }
+}
+
+// Helper: store the nodes of t in order from nodes[n]; returns the new n
+static int collectNodes (InvertedIndexBST t, InvertedIndexBST *nodes, int n) {
+    if (t == NULL) return n;
+    n = collectNodes (t->left, nodes, n);
+    nodes[n++] = t;
+    return collectNodes (t->right, nodes, n);
+}
+
+static long countNodes (InvertedIndexBST t) {
+    if (t == NULL) return 0;
+    return 1 + countNodes (t->left) + countNodes (t->right);
+}
+
+// Helper: remove u->filename's posting for word, copying the path to it;
+// the word goes as well if that was its last posting
+static InvertedIndexBST cowRemove (Update *u, char *word) {
+    InvertedIndexBST root = u->root;
+    InvertedIndexBST *link = &root;
+    InvertedIndexBST t = root;
+    while (t != NULL) {
+        t = *link = ownNode (u, t);
+        int diff = strcmp(word, t->word);
+        if (diff == 0) break;
+        link = (diff < 0) ? &t->left : &t->right;
+        t = *link;
+    }
+    if (t == NULL) return root;
+    t->fileList = cowPosting (u, t->fileList, 0, 0);
+    if (t->fileList != NULL) return root;
+    u->nwords--;
+
+    if (t->left == NULL || t->right == NULL) {
+        *link = (t->left != NULL) ? t->left : t->right;
+    } else {
+        // the successor takes t's place; copy the path down to it
+        InvertedIndexBST *slink = &t->right;
+        InvertedIndexBST succ = *slink = ownNode (u, *slink);
+        while (succ->left != NULL) {
+            slink = &succ->left;
+            succ = *slink = ownNode (u, *slink);
+        }
+        *slink = succ->right;
+        succ->left = t->left;
+        succ->right = t->right;
+        *link = succ;
+    }
+    // t is this update's copy, but is freed with the old version's garbage
+    // so that its address is not reused while it is in u->fresh
+    retireNode (u->old, t);
+    return root;
+}
+
+// Helper: insert, replace or (add = 0) remove the posting for u->filename,
+// copying the list in front of it
+static FileList cowPosting (Update *u, FileList head, int add, double tf) {
+    FileList newHead = NULL;
+    FileList *link = &newHead;
+    FileList curr = head;
+    while (curr != NULL && strcmp(curr->filename, u->filename) < 0) {
+        FileList copy = newFileList (curr->filename);
+        copy->tf = curr->tf;
+        retireFile (u->old, curr);
+        *link = copy;
+        link = &copy->next;
+        curr = curr->next;
+    }
+    if (curr != NULL && strcmp(curr->filename, u->filename) == 0) {
+        retireFile (u->old, curr);
+        curr = curr->next;
+    }
+    if (add) {
+        FileList new = newFileList (u->filename);
+        new->tf = tf;
+        new->next = curr;
+        curr = new;
+    }
+    *link = curr;
+    return newHead;
+}
+
+static void retireNode (Version *v, InvertedIndexBST t) {
+    if (v->nnodes == v->maxnodes) {
+        v->maxnodes = v->maxnodes > 0 ? 2 * v->maxnodes : 64;
+        v->oldNodes = realloc (v->oldNodes, v->maxnodes * sizeof (InvertedIndexBST));
+        assert(v->oldNodes != NULL);
+    }
+    v->oldNodes[v->nnodes++] = t;
+}
+
+static void retireFile (Version *v, FileList f) {
+    if (v->nfiles == v->maxfiles) {
+        v->maxfiles = v->maxfiles > 0 ? 2 * v->maxfiles : 64;
+        v->oldFiles = realloc (v->oldFiles, v->maxfiles * sizeof (FileList));
+        assert(v->oldFiles != NULL);
+    }
+    v->oldFiles[v->nfiles++] = f;
+}
+
+// Helper: open-addressing pointer set, kept at most half full
+static void setAdd (PtrSet *set, void *p) {
+    if (2 * (set->n + 1) > set->size) {
+        PtrSet bigger = { calloc (2 * set->size, sizeof (void *)), 0, 2 * set->size };
+        assert(bigger.slots != NULL);
+        for (int i = 0; i < set->size; i++) {
+            if (set->slots[i] != NULL) setAdd (&bigger, set->slots[i]);
+        }
+        free (set->slots);
+        *set = bigger;
+    }
+    size_t i = ((uintptr_t) p >> 4) * 0x9E3779B97F4A7C15ULL % set->size;
+    while (set->slots[i] != NULL) i = (i + 1) % set->size;
+    set->slots[i] = p;
+    set->n++;
+}
+
+static int setHas (PtrSet *set, void *p) {
+    size_t i = ((uintptr_t) p >> 4) * 0x9E3779B97F4A7C15ULL % set->size;
+    while (set->slots[i] != NULL) {
+        if (set->slots[i] == p) return 1;
+        i = (i + 1) % set->size;
+    }
+    return 0;
+}
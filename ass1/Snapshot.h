@@ -0,0 +1,43 @@
+// Snapshot.h ... consistent read snapshots of an index that is being updated
+//
+// Readers pin the current version of the index and query it as normal;
+// it does not change under them.  A writer adds files by path copying, so
+// it never modifies a node a reader can see, and publishes the result as
+// the next version.  Nodes a version no longer shares are freed once no
+// reader holds that version or any older one.
+
+#ifndef _SNAPSHOT_GUARD
+#define _SNAPSHOT_GUARD
+
+#include "invertedIndex.h"
+
+typedef struct SnapshotStoreRep *SnapshotStore;
+typedef struct Version *Snapshot;
+
+// start versioning tree (over D documents); the store takes ownership of it
+SnapshotStore newSnapshotStore (InvertedIndexBST tree, int D);
+
+// free the store and every version; no snapshots may be held
+void dropSnapshotStore (SnapshotStore s);
+
+// pin the current version for reading
+Snapshot snapshotAcquire (SnapshotStore s);
+
+// unpin a version; it may be reclaimed after this
+void snapshotRelease (SnapshotStore s, Snapshot snap);
+
+// the index and document count of a pinned version
+InvertedIndexBST snapshotTree (Snapshot snap);
+int snapshotDocs (Snapshot snap);
+
+/** Add the words of filename to a new version and publish it, counting
+    one more document.  Re-adding a file replaces its postings, dropping
+    those for words it no longer has, and leaves the document count as it
+    was.  Returns 0 if the file cannot be read.
+*/
+int snapshotAddFile (SnapshotStore s, char *filename);
+
+// publish a separately built index (over D documents) as the next version
+void snapshotReplace (SnapshotStore s, InvertedIndexBST tree, int D);
+
+#endif
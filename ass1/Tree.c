@@ -6,6 +6,9 @@
 
 #include "invertedIndex.h"
 #include "Tree.h"
+#include "BTree.h"
+
+static void freeNodes (InvertedIndexBST tree);
 
 InvertedIndexBST newBST (char *word, char *filename) {
     InvertedIndexBST new = malloc (sizeof (*new));
@@ -61,13 +64,15 @@ FileList insertFilename (FileList head, char *filename) {
     } else {
         FileList curr = head;
         FileList prev = NULL;
-        FileList new = newFileList(filename);
         while (curr != NULL) {
-            if (strcmp(filename, curr->filename) == 0) { 
+            int diff = strcmp(filename, curr->filename);
+            if (diff == 0) { 
                 curr->tf++;
                 return head;
             }
-            if (strcmp(filename, curr->filename) < 0) {
+            if (diff < 0) {
+                // only allocate once we know the filename is new
+                FileList new = newFileList(filename);
                 if (prev == NULL) {
                     new->next = curr;
                     head = new;
@@ -81,7 +86,7 @@ FileList insertFilename (FileList head, char *filename) {
             curr = curr->next;
         }
         if (prev != NULL && strcmp(filename, prev->filename) > 0) {
-            prev->next = new;
+            prev->next = newFileList(filename);
         }
         return head;
     }
@@ -114,10 +119,11 @@ void help_count_tf (InvertedIndexBST tree) {
 TfIdfList help_calculateTfIdf (InvertedIndexBST tree, TfIdfList head, char *searchWord, int D) {
     if (tree == NULL) return head;
     // find out where is searchWord in the tree
-    if (strcmp(searchWord, tree->word) == 0) {
+    int diff = strcmp(searchWord, tree->word);
+    if (diff == 0) {
         return calculating_TfIdf (tree, head, D);
     } 
-    if (help_calculateTfIdf(tree->left, head, searchWord, D) != NULL) {
+    if (diff < 0) {
         return help_calculateTfIdf(tree->left, head, searchWord, D);
     }
     return help_calculateTfIdf(tree->right, head, searchWord, D);
@@ -137,7 +143,7 @@ TfIdfList calculating_TfIdf (InvertedIndexBST tree, TfIdfList head, int D) {
     curr = tree->fileList;
     
     // calculate the idf
-    idf = log10(D / total_file);
+    idf = termIdf (D, total_file);
     
     while (curr != NULL) {
         // calculate tfidf
@@ -199,6 +205,7 @@ TfIdfList insertTfIdfList (TfIdfList new, TfIdfList head) {
 }
 
 TfIdfList order_list (TfIdfList head) {
+    if (head == NULL) return NULL;
     TfIdfList curr = head;
     TfIdfList new = newTfIdfList (curr->filename, curr->tfidf_sum);
     curr = curr->next;
@@ -207,9 +214,81 @@ TfIdfList order_list (TfIdfList head) {
         new = insertTfIdfList (clone, new);
         curr = curr->next;
     }
+    // the unordered list is no longer needed
+    freeTfIdfList (head);
     return new;
 }
 
+void freeTfIdfList (TfIdfList head) {
+    while (head != NULL) {
+        TfIdfList next = head->next;
+        free (head->filename);
+        free (head);
+        head = next;
+    }
+}
+
+void freeInvertedIndex (InvertedIndexBST tree) {
+    // a later tree may be allocated at the same address
+    forgetIndex (tree);
+    freeNodes (tree);
+}
+
+// Helper: free the nodes of a tree, and their FileLists
+static void freeNodes (InvertedIndexBST tree) {
+    if (tree == NULL) return;
+    freeNodes (tree->left);
+    freeNodes (tree->right);
+    FileList curr = tree->fileList;
+    while (curr != NULL) {
+        FileList next = curr->next;
+        free (curr->filename);
+        free (curr);
+        curr = next;
+    }
+    free (tree->word);
+    free (tree);
+}
+
+int docFreq (InvertedIndexBST node) {
+    int df = 0;
+    for (FileList curr = node->fileList; curr != NULL; curr = curr->next) df++;
+    return df;
+}
+
+double termIdf (int D, int df) {
+    return log10((double) D / df);
+}
+
+InvertedIndexBST buildBalanced (InvertedIndexBST *nodes, int lo, int hi) {
+    if (lo > hi) return NULL;
+    int mid = lo + (hi - lo) / 2;
+    InvertedIndexBST root = nodes[mid];
+    root->left = buildBalanced (nodes, lo, mid - 1);
+    root->right = buildBalanced (nodes, mid + 1, hi);
+    return root;
+}
+
+void collectNames (BTree names, InvertedIndexBST tree) {
+    if (tree == NULL) return;
+    collectNames (names, tree->left);
+    for (FileList curr = tree->fileList; curr != NULL; curr = curr->next) {
+        if (BTreeFind (names, curr->filename) == NULL) {
+            BTreeInsert (names, curr->filename, curr->filename);
+        }
+    }
+    collectNames (names, tree->right);
+}
+
+InvertedIndexBST findWord (InvertedIndexBST tree, char *word) {
+    while (tree != NULL) {
+        int diff = strcmp(word, tree->word);
+        if (diff == 0) return tree;
+        tree = (diff < 0) ? tree->left : tree->right;
+    }
+    return NULL;
+}
+
 // Helper: rotate tree left around root (from lab04/Tree.c)
 InvertedIndexBST rotateL (InvertedIndexBST n2) {
 	if (n2 == NULL) return NULL;
@@ -1,3 +1,16 @@
+#include <stdio.h>
+
+#include "BTree.h"
+
+// build a Bloom filter of the words alongside generateInvertedIndex (0 = off)
+void useTermFilter (double fpRate);
+
+// build a forward index alongside generateInvertedIndex (0 = off)
+void useForwardIndex (int on);
+
+// print the memory cost of the current term filter
+void reportTermFilter (FILE *fp);
+
 // insert a new value into a Tree
 InvertedIndexBST newBST (char *word, char *filename);
 
@@ -31,6 +44,35 @@ TfIdfList insertTfIdfList (TfIdfList new, TfIdfList old);
 // help ordering the list
 TfIdfList order_list (TfIdfList head);
 
+// free a TfIdfList returned by calculateTfIdf or retrieve
+void freeTfIdfList (TfIdfList head);
+
+// free an inverted index with all its words and FileLists
+void freeInvertedIndex (InvertedIndexBST tree);
+
+// number of files in a word's FileList
+int docFreq (InvertedIndexBST node);
+
+// idf of a word found in df of D files; every tf-idf uses this
+double termIdf (int D, int df);
+
+// link nodes[lo..hi], already in word order, into a balanced tree
+InvertedIndexBST buildBalanced (InvertedIndexBST *nodes, int lo, int hi);
+
+// add every filename in the tree to names, once each; BTreeWalk then
+// visits them in order
+void collectNames (BTree names, InvertedIndexBST tree);
+
+// return the node holding word, or NULL
+InvertedIndexBST findWord (InvertedIndexBST tree, char *word);
+
+// true if the term filter shows word is not in tree (see useTermFilter)
+int termFilterRejects (InvertedIndexBST tree, char *word);
+
+// drop the term filter and forward index built alongside tree, if any;
+// whatever frees or rearranges a root other than freeInvertedIndex calls it
+void forgetIndex (InvertedIndexBST tree);
+
 // Helper: rotate tree left around root (from lab04/Tree.c)
 InvertedIndexBST rotateL (InvertedIndexBST n2);
 
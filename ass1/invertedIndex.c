@@ -2,10 +2,30 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 
 #include "invertedIndex.h"
 #include "Tree.h"
+#include "Bloom.h"
+#include "Forward.h"
+#include "Prune.h"
+#include "Normalise.h"
+
+// optional Bloom filter over the words of the last generated index,
+// used to reject absent search words without descending the tree
+static double termFilterRate = 0;
+static Bloom termFilter = NULL;
+static InvertedIndexBST termFilterTree = NULL;
+
+// optional forward index (file -> tf-idf vector) of the last generated index
+static int forwardIndexOn = 0;
+static ForwardIndex forwardIndex = NULL;
+static InvertedIndexBST forwardIndexTree = NULL;
+
+// optional static pruning applied to each generated index
+static PruneOptions *pruneOptions = NULL;
+
+static int countWords (InvertedIndexBST tree);
+static void addWords (Bloom filter, InvertedIndexBST tree);
 
 // Functions for Part-1
 
@@ -32,13 +52,13 @@ char * normaliseWord (char *str) {
         }
     }
 
-    for (char *cur = str; *cur != '\0'; cur++) {
-        *cur = tolower(*cur);
-        if (*(cur + 1) == '\0' && (*cur == '.' || *cur == ',' 
-                || *cur == ';' || *cur == '?')) {
-            *cur = '\0';
-        }
+    // lower case (UTF-8 aware, see Normalise.h), then drop one trailing .,;?
+    size_t len = foldCase (str, strlen (str));
+    if (len > 0 && (str[len - 1] == '.' || str[len - 1] == ','
+            || str[len - 1] == ';' || str[len - 1] == '?')) {
+        len--;
     }
+    str[len] = '\0';
     return str;
 }
 
@@ -52,18 +72,34 @@ InvertedIndexBST generateInvertedIndex (char *collectionFilename) {
     char *word = malloc (100 * sizeof(char));
     FILE *fp;
     FILE *txt;
+    int D = 0;
     fp = fopen(collectionFilename, "r");
     while (fscanf(fp, "%s", file_name) != EOF) {
         txt = fopen (file_name, "r");
         if (txt == NULL) continue;
+        D++;
         while (fscanf(txt, "%s", word) != EOF) {
             word = normaliseWord (word);
+            if (word[0] == '\0') continue;     // e.g. "." on its own
             new = insertIntoBST (new, word, file_name);
         }
         fclose (txt);
     }
     fclose (fp);
     count_tf (new);
+    if (pruneOptions != NULL) new = pruneInvertedIndex (new, D, pruneOptions);
+
+    if (termFilterRate > 0) {
+        dropBloom (termFilter);
+        termFilter = newBloom (countWords (new), termFilterRate);
+        addWords (termFilter, new);
+        termFilterTree = new;
+    }
+    if (forwardIndexOn) {
+        dropForwardIndex (forwardIndex);
+        forwardIndex = newForwardIndex (new, D);
+        forwardIndexTree = new;
+    }
     return new;
 }
 
@@ -107,6 +143,7 @@ void printInvertedIndex (InvertedIndexBST tree) {
 TfIdfList calculateTfIdf (InvertedIndexBST tree, char *searchWord, int D) {
     TfIdfList new = NULL;
     if (searchWord == NULL) return new;
+    if (termFilterRejects (tree, searchWord)) return new;
     new = help_calculateTfIdf (tree, new, searchWord, D);
     return new;
 }
@@ -143,9 +180,12 @@ TfIdfList retrieve (InvertedIndexBST tree, char* searchWords[] , int D) {
                 // new_curr = NULL means there is no same filename, then insert clone into the list
                 if (new_curr == NULL) {
                     head = insertTfIdfList (clone, head);
+                } else {
+                    freeTfIdfList (clone);
                 }
                 curr = curr->next;
             }     
+            freeTfIdfList (add);
         }
     }
     // make the list into right order
@@ -154,3 +194,77 @@ TfIdfList retrieve (InvertedIndexBST tree, char* searchWords[] , int D) {
 }
 
 
+
+/** Build a Bloom filter with the given false-positive rate alongside every
+    index made by generateInvertedIndex from now on; 0 turns it off.
+*/
+void useTermFilter (double fpRate) {
+    termFilterRate = fpRate;
+    if (fpRate <= 0) {
+        dropBloom (termFilter);
+        termFilter = NULL;
+        termFilterTree = NULL;
+    }
+}
+
+int termFilterRejects (InvertedIndexBST tree, char *word) {
+    return termFilter != NULL && tree == termFilterTree 
+        && !BloomMayContain (termFilter, word);
+}
+
+void forgetIndex (InvertedIndexBST tree) {
+    if (tree == NULL) return;
+    if (tree == termFilterTree) {
+        dropBloom (termFilter);
+        termFilter = NULL;
+        termFilterTree = NULL;
+    }
+    if (tree == forwardIndexTree) {
+        dropForwardIndex (forwardIndex);
+        forwardIndex = NULL;
+        forwardIndexTree = NULL;
+    }
+}
+
+// print the memory cost and false-positive rate of the current filter
+void reportTermFilter (FILE *fp) {
+    if (termFilter == NULL) {
+        fprintf(fp, "bloom: no term filter\n");
+        return;
+    }
+    BloomReport (termFilter, fp);
+}
+
+/** Build a forward index alongside every index made by generateInvertedIndex
+    from now on (see forwardIndexOf); 0 turns it off.
+*/
+void useForwardIndex (int on) {
+    forwardIndexOn = on;
+    if (!on) {
+        dropForwardIndex (forwardIndex);
+        forwardIndex = NULL;
+        forwardIndexTree = NULL;
+    }
+}
+
+ForwardIndex forwardIndexOf (InvertedIndexBST tree) {
+    return (tree == forwardIndexTree) ? forwardIndex : NULL;
+}
+
+void usePruning (PruneOptions *opt) {
+    pruneOptions = opt;
+}
+
+// Helper: count the words in the tree
+static int countWords (InvertedIndexBST tree) {
+    if (tree == NULL) return 0;
+    return 1 + countWords (tree->left) + countWords (tree->right);
+}
+
+// Helper: add every word in the tree to the filter
+static void addWords (Bloom filter, InvertedIndexBST tree) {
+    if (tree == NULL) return;
+    addWords (filter, tree->left);
+    BloomAdd (filter, tree->word);
+    addWords (filter, tree->right);
+}
@@ -0,0 +1,499 @@
+// queryd.c ... long-lived inverted index query server
+//
+// Builds (or loads) the index once, then answers queries over a Unix
+// domain socket with a line protocol:
+//     tfidf WORD              -> calculateTfIdf for WORD
+//     retrieve WORD WORD ...  -> retrieve for the WORDs
+//     stats                   -> latency histogram so far
+//     quit                    -> close the connection
+// A reply is "OK n" followed by n lines "tfidf filename", or "ERR message".
+// A line longer than MAXLINE, more than MAXWORDS words, or a word of
+// MAXWORD or more characters gets a single ERR reply.
+//
+// One thread runs an epoll loop that accepts connections and reads lines;
+// complete lines are queued for a pool of worker threads, which run the
+// query and write the reply.  Each connection has at most one request in
+// flight, so replies come back in request order.  When a worker finishes
+// it hands the connection back to the loop through a pipe, saying whether
+// to close it; only the loop thread changes a Conn.  A connection whose
+// buffer fills while its request is out stops being watched for input
+// until a line has been taken from the buffer.  The rest of an over-long
+// line is read and thrown away up to its newline.
+//
+// Usage: queryd SOCKET (-c collection.txt | -i index.txt) [-D ndocs] [-w workers]
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "BTree.h"
+#include "External.h"
+#include "Query.h"
+
+#define MAXLINE 4096
+#define MAXWORDS 256
+#define MAXWORD 100     // as in the index's own word buffers
+#define MAXEVENTS 64
+#define NBUCKETS 32     // latency buckets: [2^(i-1), 2^i) microseconds
+
+typedef struct Conn {
+    int fd;
+    struct Conn *nextDead;  // connections to free at the end of a batch
+    char in[MAXLINE];
+    int inlen;
+    int busy;       // a request from this connection is with a worker
+    int closing;    // peer has gone; free once no longer busy
+    int paused;     // in[] is full, so fd is not being watched
+    int discarding; // dropping the rest of an over-long line
+} Conn;
+
+// what a worker sends back to the event loop
+typedef struct Done {
+    Conn *conn;
+    int close;      // quit, or the reply couldn't be sent
+} Done;
+
+typedef struct Job {
+    Conn *conn;
+    char line[MAXLINE];
+    int tooLong;    // line was over-long; reply with an error
+    struct timespec start;
+    struct Job *next;
+} Job;
+
+// shared, read-only once the workers start
+static InvertedIndexBST index_tree;
+static int ndocs;
+
+// work queue
+static pthread_mutex_t qlock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t qready = PTHREAD_COND_INITIALIZER;
+static Job *qhead = NULL, *qtail = NULL;
+
+// latency histogram
+static pthread_mutex_t hlock = PTHREAD_MUTEX_INITIALIZER;
+static long hist[NBUCKETS];
+static long nrequests;
+static double maxLatency;
+
+static int donePipe[2];     // workers -> event loop: Done
+static volatile sig_atomic_t stopping = 0;
+
+static void usage (void) __attribute__((noreturn));
+static int countDocs (InvertedIndexBST tree);
+static int listenOn (char *path);
+static void dispatch (int ep, Conn *c);
+static void consume (int ep, Conn *c, int used);
+static void closeConn (int ep, Conn *c, Conn **dead);
+static void *worker (void *arg);
+static int answer (char *line, TfIdfResult **res, int *maxres, char **out, size_t *outcap);
+static void appendf (char **out, size_t *len, size_t *cap, const char *fmt, ...)
+    __attribute__((format (printf, 4, 5)));
+static void recordLatency (double usec);
+static void writeStats (char **out, size_t *len, size_t *cap);
+static int sendAll (int fd, char *buf, size_t len);
+static double elapsedUsec (struct timespec *start);
+static void onSignal (int sig);
+
+int main (int argc, char *argv[]) {
+    if (argc < 4) usage ();
+    char *sockPath = argv[1];
+    char *collection = NULL, *indexFile = NULL;
+    int nworkers = 4;
+    ndocs = 0;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (strcmp (argv[i], "-c") == 0) collection = argv[i + 1];
+        else if (strcmp (argv[i], "-i") == 0) indexFile = argv[i + 1];
+        else if (strcmp (argv[i], "-D") == 0) ndocs = atoi (argv[i + 1]);
+        else if (strcmp (argv[i], "-w") == 0) nworkers = atoi (argv[i + 1]);
+        else usage ();
+    }
+    if ((collection == NULL) == (indexFile == NULL) || nworkers < 1) usage ();
+
+    index_tree = (collection != NULL)
+        ? generateInvertedIndex (collection)
+        : loadInvertedIndex (indexFile);
+    if (index_tree == NULL) errx (EX_DATAERR, "empty or unreadable index");
+    if (ndocs <= 0) ndocs = countDocs (index_tree);
+    fprintf (stderr, "queryd: index ready, D = %d, %d workers\n", ndocs, nworkers);
+
+    int lfd = listenOn (sockPath);
+    if (pipe2 (donePipe, O_CLOEXEC) < 0) err (EX_OSERR, "pipe");
+    fcntl (donePipe[0], F_SETFL, O_NONBLOCK);
+    signal (SIGPIPE, SIG_IGN);
+    struct sigaction sa = { .sa_handler = onSignal };
+    sigaction (SIGINT, &sa, NULL);
+    sigaction (SIGTERM, &sa, NULL);
+
+    pthread_t *threads = malloc (nworkers * sizeof (pthread_t));
+    if (threads == NULL) err (EX_OSERR, "couldn't allocate workers");
+    for (int i = 0; i < nworkers; i++) {
+        if (pthread_create (&threads[i], NULL, worker, NULL) != 0)
+            errx (EX_OSERR, "couldn't start worker");
+    }
+
+    int ep = epoll_create1 (EPOLL_CLOEXEC);
+    if (ep < 0) err (EX_OSERR, "epoll_create1");
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    epoll_ctl (ep, EPOLL_CTL_ADD, lfd, &ev);
+    ev.data.ptr = donePipe;
+    epoll_ctl (ep, EPOLL_CTL_ADD, donePipe[0], &ev);
+
+    struct epoll_event events[MAXEVENTS];
+    while (!stopping) {
+        int n = epoll_wait (ep, events, MAXEVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            err (EX_OSERR, "epoll_wait");
+        }
+        // closed connections may still have events later in this batch
+        Conn *dead = NULL;
+        for (int i = 0; i < n; i++) {
+            void *tag = events[i].data.ptr;
+            if (tag == NULL) {
+                // new connection
+                int fd = accept4 (lfd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+                if (fd < 0) continue;
+                Conn *c = calloc (1, sizeof *c);
+                if (c == NULL) { close (fd); continue; }
+                c->fd = fd;
+                struct epoll_event cev = { .events = EPOLLIN, .data.ptr = c };
+                epoll_ctl (ep, EPOLL_CTL_ADD, fd, &cev);
+            } else if (tag == donePipe) {
+                // workers handing connections back
+                Done d;
+                while (read (donePipe[0], &d, sizeof d) == sizeof d) {
+                    Conn *c = d.conn;
+                    c->busy = 0;
+                    if (d.close || c->closing) closeConn (ep, c, &dead);
+                    else dispatch (ep, c);
+                }
+            } else {
+                Conn *c = tag;
+                if (c->closing) continue;
+                ssize_t got = read (c->fd, c->in + c->inlen, MAXLINE - c->inlen);
+                if (got > 0) {
+                    c->inlen += got;
+                    dispatch (ep, c);
+                    if (c->inlen == MAXLINE) {
+                        // busy with no room left; read(..., 0) would look like EOF,
+                        // so stop watching until dispatch takes a line
+                        epoll_ctl (ep, EPOLL_CTL_DEL, c->fd, NULL);
+                        c->paused = 1;
+                    }
+                } else if (got == 0 || (errno != EAGAIN && errno != EINTR)) {
+                    // a busy connection is closed when its worker hands it back
+                    epoll_ctl (ep, EPOLL_CTL_DEL, c->fd, NULL);
+                    c->closing = 1;
+                    if (!c->busy) closeConn (ep, c, &dead);
+                }
+            }
+        }
+        while (dead != NULL) {
+            Conn *next = dead->nextDead;
+            free (dead);
+            dead = next;
+        }
+    }
+
+    char *report = NULL;
+    size_t len = 0, cap = 0;
+    writeStats (&report, &len, &cap);
+    // skip the "OK n" reply header
+    fprintf (stderr, "%s", strchr (report, '\n') + 1);
+    free (report);
+    unlink (sockPath);
+    return EXIT_SUCCESS;
+}
+
+// stop watching c and queue it to be freed after this batch of events
+static void closeConn (int ep, Conn *c, Conn **dead) {
+    epoll_ctl (ep, EPOLL_CTL_DEL, c->fd, NULL);
+    close (c->fd);
+    c->closing = 1;
+    c->nextDead = *dead;
+    *dead = c;
+}
+
+// hand the next complete line of c to the workers, if c is idle
+static void dispatch (int ep, Conn *c) {
+    if (c->discarding) {
+        // its error is already queued; drop input up to the newline
+        char *nl = memchr (c->in, '\n', c->inlen);
+        consume (ep, c, (nl != NULL) ? nl - c->in + 1 : c->inlen);
+        if (nl == NULL) return;
+        c->discarding = 0;
+    }
+    if (c->busy) return;
+    char *nl = memchr (c->in, '\n', c->inlen);
+    if (nl == NULL && c->inlen < MAXLINE) return;
+
+    Job *job = malloc (sizeof *job);
+    if (job == NULL) err (EX_OSERR, "couldn't allocate job");
+    if (nl != NULL) {
+        int linelen = nl - c->in;
+        memcpy (job->line, c->in, linelen);
+        job->line[linelen] = '\0';
+        job->tooLong = 0;
+        consume (ep, c, linelen + 1);
+    } else {
+        // a full buffer and no newline: one error for the whole line
+        job->line[0] = '\0';
+        job->tooLong = 1;
+        c->discarding = 1;
+        consume (ep, c, c->inlen);
+    }
+    job->conn = c;
+    job->next = NULL;
+    clock_gettime (CLOCK_MONOTONIC, &job->start);
+    c->busy = 1;
+
+    pthread_mutex_lock (&qlock);
+    if (qtail == NULL) qhead = job;
+    else qtail->next = job;
+    qtail = job;
+    pthread_cond_signal (&qready);
+    pthread_mutex_unlock (&qlock);
+}
+
+// drop the first used bytes of c's buffer, watching c again if it was full
+static void consume (int ep, Conn *c, int used) {
+    memmove (c->in, c->in + used, c->inlen - used);
+    c->inlen -= used;
+    if (c->paused && c->inlen < MAXLINE) {
+        struct epoll_event cev = { .events = EPOLLIN, .data.ptr = c };
+        epoll_ctl (ep, EPOLL_CTL_ADD, c->fd, &cev);
+        c->paused = 0;
+    }
+}
+
+static void *worker (void *arg) {
+    (void) arg;
+    // per-worker buffers, grown as needed and reused between requests
+    int maxres = ndocs > 0 ? ndocs : 1;
+    TfIdfResult *res = malloc (maxres * sizeof (TfIdfResult));
+    size_t outcap = MAXLINE;
+    char *out = malloc (outcap);
+    if (res == NULL || out == NULL) err (EX_OSERR, "couldn't allocate buffers");
+
+    while (1) {
+        pthread_mutex_lock (&qlock);
+        while (qhead == NULL) pthread_cond_wait (&qready, &qlock);
+        Job *job = qhead;
+        qhead = job->next;
+        if (qhead == NULL) qtail = NULL;
+        pthread_mutex_unlock (&qlock);
+
+        Done d = { .conn = job->conn, .close = 0 };
+        int len = answer (job->tooLong ? NULL : job->line, &res, &maxres, &out, &outcap);
+        if (len < 0) {
+            // quit: have the event loop close the connection
+            d.close = 1;
+            shutdown (d.conn->fd, SHUT_RDWR);
+        } else if (sendAll (d.conn->fd, out, len) < 0) {
+            d.close = 1;
+        }
+        recordLatency (elapsedUsec (&job->start));
+        free (job);
+        if (write (donePipe[1], &d, sizeof d) != sizeof d)
+            err (EX_OSERR, "couldn't hand back connection");
+    }
+    return NULL;
+}
+
+// run one request (NULL: an over-long line); the reply goes in *out,
+// returns its length (-1 = quit)
+static int answer (char *line, TfIdfResult **res, int *maxres, char **out, size_t *outcap) {
+    size_t len = 0;
+    if (line == NULL) {
+        appendf (out, &len, outcap, "ERR line too long\n");
+        return len;
+    }
+    char *words[MAXWORDS + 1];
+    int nwords = 0;
+    char *save;
+    char *cmd = strtok_r (line, " \t\r", &save);
+    char *w;
+    while ((w = strtok_r (NULL, " \t\r", &save)) != NULL) {
+        if (nwords == MAXWORDS) {
+            appendf (out, &len, outcap, "ERR too many words\n");
+            return len;
+        } else if (strlen (w) >= MAXWORD) {
+            appendf (out, &len, outcap, "ERR word too long\n");
+            return len;
+        }
+        words[nwords++] = normaliseWord (w);
+    }
+    words[nwords] = NULL;
+
+    int n;
+    if (cmd == NULL) {
+        appendf (out, &len, outcap, "ERR empty request\n");
+        return len;
+    } else if (strcmp (cmd, "quit") == 0) {
+        return -1;
+    } else if (strcmp (cmd, "stats") == 0) {
+        writeStats (out, &len, outcap);
+        return len;
+    } else if (strcmp (cmd, "tfidf") == 0 && nwords == 1) {
+        while ((n = calculateTfIdfInto (index_tree, words[0], ndocs, *res, *maxres)) > *maxres) {
+            *maxres = n;
+            *res = realloc (*res, n * sizeof (TfIdfResult));
+            if (*res == NULL) err (EX_OSERR, "couldn't grow results");
+        }
+    } else if (strcmp (cmd, "retrieve") == 0 && nwords > 0) {
+        while ((n = retrieveInto (index_tree, words, ndocs, *res, *maxres)) > *maxres) {
+            *maxres = n;
+            *res = realloc (*res, n * sizeof (TfIdfResult));
+            if (*res == NULL) err (EX_OSERR, "couldn't grow results");
+        }
+    } else {
+        appendf (out, &len, outcap, "ERR usage: tfidf WORD | retrieve WORD... | stats | quit\n");
+        return len;
+    }
+
+    appendf (out, &len, outcap, "OK %d\n", n);
+    for (int i = 0; i < n; i++)
+        appendf (out, &len, outcap, "%.6f %s\n", (*res)[i].tfidf_sum, (*res)[i].filename);
+    return len;
+}
+
+// printf onto the end of a growable buffer
+static void appendf (char **out, size_t *len, size_t *cap, const char *fmt, ...) {
+    va_list ap;
+    while (1) {
+        va_start (ap, fmt);
+        int n = vsnprintf (*out + *len, *cap - *len, fmt, ap);
+        va_end (ap);
+        if (n < 0) return;
+        if (*len + n < *cap) {
+            *len += n;
+            return;
+        }
+        *cap *= 2;
+        *out = realloc (*out, *cap);
+        if (*out == NULL) err (EX_OSERR, "couldn't grow reply");
+    }
+}
+
+static void recordLatency (double usec) {
+    int b = 0;
+    while (b < NBUCKETS - 1 && (double) (1L << b) <= usec) b++;
+    pthread_mutex_lock (&hlock);
+    hist[b]++;
+    nrequests++;
+    if (usec > maxLatency) maxLatency = usec;
+    pthread_mutex_unlock (&hlock);
+}
+
+// histogram plus approximate percentiles (upper bound of the bucket)
+static void writeStats (char **out, size_t *len, size_t *cap) {
+    if (*out == NULL) {
+        *cap = MAXLINE;
+        *out = malloc (*cap);
+        if (*out == NULL) err (EX_OSERR, "couldn't allocate stats");
+    }
+    pthread_mutex_lock (&hlock);
+    long counts[NBUCKETS];
+    memcpy (counts, hist, sizeof counts);
+    long total = nrequests;
+    double max = maxLatency;
+    pthread_mutex_unlock (&hlock);
+
+    int nlines = 1;
+    for (int b = 0; b < NBUCKETS; b++) nlines += (counts[b] > 0);
+    appendf (out, len, cap, "OK %d\n", nlines);
+    double pct[] = { 0.50, 0.90, 0.99 };
+    long pv[3] = { 0, 0, 0 };
+    for (int p = 0; p < 3; p++) {
+        long seen = 0;
+        for (int b = 0; b < NBUCKETS; b++) {
+            seen += counts[b];
+            if (total > 0 && seen >= pct[p] * total) { pv[p] = 1L << b; break; }
+        }
+    }
+    appendf (out, len, cap,
+        "requests %ld  p50 <%ldus  p90 <%ldus  p99 <%ldus  max %.0fus\n",
+        total, pv[0], pv[1], pv[2], max);
+    for (int b = 0; b < NBUCKETS; b++) {
+        if (counts[b] > 0)
+            appendf (out, len, cap, "  <%10ldus %ld\n", 1L << b, counts[b]);
+    }
+}
+
+// write all of buf to a non-blocking socket
+static int sendAll (int fd, char *buf, size_t len) {
+    while (len > 0) {
+        ssize_t n = send (fd, buf, len, MSG_NOSIGNAL);
+        if (n > 0) {
+            buf += n;
+            len -= n;
+        } else if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+            struct pollfd p = { .fd = fd, .events = POLLOUT };
+            poll (&p, 1, 1000);
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int countDocs (InvertedIndexBST tree) {
+    // every file holding at least one word appears in some FileList
+    BTree files = newBTree ();
+    collectNames (files, tree);
+    int n = BTreeNumTerms (files);
+    dropBTree (files);
+    return n;
+}
+
+static int listenOn (char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    if (strlen (path) >= sizeof addr.sun_path) errx (EX_USAGE, "socket path too long");
+    strcpy (addr.sun_path, path);
+    unlink (path);
+    int fd = socket (AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) err (EX_OSERR, "socket");
+    if (bind (fd, (struct sockaddr *) &addr, sizeof addr) < 0) err (EX_OSERR, "bind %s", path);
+    if (listen (fd, 128) < 0) err (EX_OSERR, "listen");
+    return fd;
+}
+
+static double elapsedUsec (struct timespec *start) {
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1e6 + (now.tv_nsec - start->tv_nsec) / 1e3;
+}
+
+static void onSignal (int sig) {
+    (void) sig;
+    stopping = 1;
+}
+
+static void usage (void) {
+    fprintf (
+        stderr,
+        "Usage: queryd SOCKET (-c collection.txt | -i index.txt) [-D ndocs] [-w workers]\n"
+        "-c builds the index from a collection, -i loads one written by\n"
+        "generateInvertedIndexExternal; D defaults to the number of files in the index\n"
+    );
+    exit (EX_USAGE);
+}
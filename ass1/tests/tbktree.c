@@ -0,0 +1,170 @@
+// tbktree.c ... the BK-tree against comparing with every word
+//
+// Checks editDistance on a few known pairs, then searches a BK-tree of
+// a made-up collection's words for misspellings of its words (up to two
+// edits) at k = 0, 1 and 2; each search must find exactly the words that
+// comparing with every word finds.  retrieveFuzzy must then give what
+// retrieve gives for all the words found.
+//
+// Usage: tbktree Nqueries Seed
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "External.h"
+#include "BKTree.h"
+#include "tcollection.h"
+
+#define NDOCS 500
+#define NWORDS 200
+#define VOCAB 20000
+#define MAXMATCH (2 * VOCAB)
+#define INDEX "data/index.txt"
+
+static void usage (char *prog) __attribute__((noreturn));
+static int testDistance (void);
+static void misspell (char *word, int edits, uint64_t *s);
+static int bruteSearch (InvertedIndexBST tree, char *word, int k, char *matches[], int n);
+static int sameWords (char *a[], char *b[], int n);
+static int cmpWord (const void *a, const void *b);
+
+int main (int argc, char *argv[]) {
+    if (argc != 3) usage (argv[0]);
+    int nq = atoi (argv[1]);
+    uint64_t seed = strtoull (argv[2], NULL, 10);
+    if (nq < 1 || nq > 1000000 || seed == 0) usage (argv[0]);
+
+    int ok = testDistance ();
+    char *collection = makeCollection (NDOCS, NWORDS, VOCAB, seed);
+    generateInvertedIndexExternal (collection, INDEX, (size_t) 1 << 30);
+    InvertedIndexBST tree = loadInvertedIndex (INDEX);
+    BKTree bk = newBKTree (tree);
+
+    char **got = malloc (MAXMATCH * sizeof (char *));
+    char **want = malloc (MAXMATCH * sizeof (char *));
+    assert(got != NULL && want != NULL);
+    double bkTime[3] = { 0 }, bruteTime[3] = { 0 };
+    long found[3] = { 0 };
+    struct timespec t;
+    char word[32], other[32];
+    for (int q = 0; q < nq && ok; q++) {
+        vocabWord (nextRandom (&seed) % VOCAB, word);
+        misspell (word, nextRandom (&seed) % 3, &seed);
+        for (int k = 0; k <= 2 && ok; k++) {
+            since (&t);
+            int n = BKTreeSearch (bk, word, k, got, MAXMATCH);
+            bkTime[k] += since (&t);
+            int m = bruteSearch (tree, word, k, want, 0);
+            bruteTime[k] += since (&t);
+            ok = n == m && sameWords (got, want, n);
+            found[k] += n;
+        }
+
+        // two search words, whose matches may overlap
+        strcpy (other, word);
+        misspell (other, 1, &seed);
+        char *search[] = { word, other, NULL };
+        int n = BKTreeSearch (bk, word, 1, got, MAXMATCH);
+        n += BKTreeSearch (bk, other, 1, got + n, MAXMATCH - n);
+        qsort (got, n, sizeof (char *), cmpWord);
+        int m = 0;
+        for (int i = 0; i < n; i++) {
+            if (m == 0 || strcmp(got[i], got[m - 1]) != 0) got[m++] = got[i];
+        }
+        got[m] = NULL;
+        TfIdfList a = retrieveFuzzy (tree, bk, search, 1, NDOCS);
+        TfIdfList b = retrieve (tree, got, NDOCS);
+        ok = ok && sameLists (a, b, 1e-12);
+        freeTfIdfList (a);
+        freeTfIdfList (b);
+    }
+
+    printf("%-3s %12s %12s %14s\n", "k", "matches/q", "bktree (us)", "every word (us)");
+    for (int k = 0; k <= 2; k++) {
+        printf("%-3d %12.1f %12.1f %14.1f\n", k, (double) found[k] / nq,
+            bkTime[k] / nq * 1e6, bruteTime[k] / nq * 1e6);
+    }
+    printf("tbktree: %s\n", ok ? "ok" : "not ok");
+    free (want);
+    free (got);
+    dropBKTree (bk);
+    freeInvertedIndex (tree);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Helper: editDistance on pairs whose distance is known
+static int testDistance (void) {
+    struct { char *s, *t; int d; } pairs[] = {
+        { "kitten", "sitting", 3 }, { "flaw", "lawn", 2 }, { "", "abc", 3 },
+        { "abc", "", 3 }, { "same", "same", 0 }, { "ab", "ba", 2 },
+        { "intention", "execution", 5 }, { "a", "b", 1 },
+    };
+    int ok = 1;
+    for (int i = 0; i < (int) (sizeof pairs / sizeof pairs[0]); i++) {
+        if (editDistance (pairs[i].s, pairs[i].t) != pairs[i].d) {
+            printf("editDistance (\"%s\", \"%s\") != %d\n", pairs[i].s, pairs[i].t, pairs[i].d);
+            ok = 0;
+        }
+    }
+    return ok;
+}
+
+// Helper: make up to edits random substitutions, insertions or deletions
+static void misspell (char *word, int edits, uint64_t *s) {
+    for (int e = 0; e < edits; e++) {
+        int len = strlen (word);
+        int at = nextRandom (s) % (len + 1);
+        char c = 'a' + nextRandom (s) % 26;
+        switch (nextRandom (s) % 3) {
+        case 0:
+            if (at < len) word[at] = c;
+            break;
+        case 1:
+            memmove (&word[at + 1], &word[at], len - at + 1);
+            word[at] = c;
+            break;
+        default:
+            if (at < len && len > 1) memmove (&word[at], &word[at + 1], len - at);
+            break;
+        }
+    }
+}
+
+// Helper: every word in tree within k of word, from matches[n]; returns the new n
+static int bruteSearch (InvertedIndexBST tree, char *word, int k, char *matches[], int n) {
+    if (tree == NULL) return n;
+    n = bruteSearch (tree->left, word, k, matches, n);
+    if (editDistance (word, tree->word) <= k) matches[n++] = tree->word;
+    return bruteSearch (tree->right, word, k, matches, n);
+}
+
+// Helper: same words, in any order; b[] is already in order
+static int sameWords (char *a[], char *b[], int n) {
+    qsort (a, n, sizeof (char *), cmpWord);
+    for (int i = 0; i < n; i++) {
+        if (strcmp(a[i], b[i]) != 0) return 0;
+    }
+    return 1;
+}
+
+static int cmpWord (const void *a, const void *b) {
+    return strcmp(*(char * const *) a, *(char * const *) b);
+}
+
+static void usage (char *prog) {
+    fprintf (
+        stderr,
+        "Usage: %s Nqueries Seed\n"
+        "1 <= Nqueries <= 1000000, Seed = a random number other than 0\n"
+        "Checks BKTreeSearch and retrieveFuzzy against comparing with every\n"
+        "word, on a collection made from Seed\n",
+        prog
+    );
+    exit (EXIT_FAILURE);
+}
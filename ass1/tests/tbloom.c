@@ -0,0 +1,131 @@
+// tbloom.c ... the Bloom filter, alone and as the index's term filter
+//
+// Adds N words to filters at 1% and 0.1%, checks that every one of them
+// is still "maybe present" and measures the false-positive rate on N
+// words never added.  Then builds an index of a made-up collection with
+// and without the term filter, checks that calculateTfIdf and retrieve
+// give the same lists either way, and times lookups of absent words.
+//
+// Usage: tbloom N Seed
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "Bloom.h"
+#include "tcollection.h"
+
+#define NDOCS 100
+#define NWORDS 100
+#define VOCAB 2000
+
+static void usage (char *prog) __attribute__((noreturn));
+static int testFilter (int N, double fpRate);
+static int testTermFilter (int N, uint64_t seed);
+
+int main (int argc, char *argv[]) {
+    if (argc != 3) usage (argv[0]);
+    int N = atoi (argv[1]);
+    uint64_t seed = strtoull (argv[2], NULL, 10);
+    if (N < 1 || N > 10000000 || seed == 0) usage (argv[0]);
+
+    int ok = testFilter (N, 0.01);
+    ok &= testFilter (N, 0.001);
+    ok &= testTermFilter (N, seed);
+    printf("tbloom: %s\n", ok ? "ok" : "not ok");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Helper: no false negatives, and about fpRate false positives
+static int testFilter (int N, double fpRate) {
+    Bloom b = newBloom (N, fpRate);
+    char word[16];
+    for (int i = 0; i < N; i++) BloomAdd (b, vocabWord (i, word));
+    int misses = 0, fps = 0;
+    for (int i = 0; i < N; i++) misses += !BloomMayContain (b, vocabWord (i, word));
+    for (int i = N; i < 2 * N; i++) fps += BloomMayContain (b, vocabWord (i, word));
+
+    // allow for chance on small N as well as the blocking's small excess
+    double measured = (double) fps / N;
+    int ok = misses == 0 && measured <= 2 * fpRate + 10.0 / N;
+    printf("%d words at %g: %.2f bits/word, %d false negatives, "
+        "false positives %.4f; %s\n", N, fpRate, 8.0 * BloomBytes (b) / N,
+        misses, measured, ok ? "ok" : "not ok");
+    dropBloom (b);
+    return ok;
+}
+
+// Helper: queries give the same answers with the term filter as without
+static int testTermFilter (int N, uint64_t seed) {
+    char *collection = makeCollection (NDOCS, NWORDS, VOCAB, seed);
+    useTermFilter (0);
+    InvertedIndexBST plain = generateInvertedIndex (collection);
+    useTermFilter (0.01);
+    InvertedIndexBST filtered = generateInvertedIndex (collection);
+
+    // half the queries are for words in the collection, half for words not
+    char word[16], other[16];
+    int ok = 1;
+    for (int i = 0; i < 2 * VOCAB && ok; i++) {
+        vocabWord (i, word);
+        TfIdfList a = calculateTfIdf (plain, word, NDOCS);
+        TfIdfList b = calculateTfIdf (filtered, word, NDOCS);
+        ok = sameLists (a, b, 0);
+        freeTfIdfList (a);
+        freeTfIdfList (b);
+
+        char *words[] = { word, vocabWord (2 * VOCAB - 1 - i, other), NULL };
+        a = retrieve (plain, words, NDOCS);
+        b = retrieve (filtered, words, NDOCS);
+        ok = ok && sameLists (a, b, 0);
+        freeTfIdfList (a);
+        freeTfIdfList (b);
+    }
+
+    struct timespec t;
+    since (&t);
+    for (int i = 0; i < N; i++) {
+        freeTfIdfList (calculateTfIdf (plain, vocabWord (VOCAB + i, word), NDOCS));
+    }
+    double plainTime = since (&t);
+    for (int i = 0; i < N; i++) {
+        freeTfIdfList (calculateTfIdf (filtered, vocabWord (VOCAB + i, word), NDOCS));
+    }
+    double filteredTime = since (&t);
+
+    reportTermFilter (stdout);
+    printf("absent words: %.0f ns/op without the filter, %.0f with it\n",
+        plainTime / N * 1e9, filteredTime / N * 1e9);
+
+    // once its tree is freed the filter must not answer for a new tree,
+    // even one that malloc puts where the old one was
+    freeInvertedIndex (filtered);
+    InvertedIndexBST again = NULL;
+    for (int i = VOCAB; i < 2 * VOCAB; i++) {
+        again = insertIntoBST (again, vocabWord (i, word), "data/t0000.txt");
+    }
+    int stale = 0;
+    for (int i = VOCAB; i < 2 * VOCAB; i++) stale += termFilterRejects (again, vocabWord (i, word));
+    ok = ok && stale == 0;
+    useTermFilter (0);
+
+    printf("term filter: %s\n", ok ? "ok" : "not ok");
+    freeInvertedIndex (again);
+    freeInvertedIndex (plain);
+    return ok;
+}
+
+static void usage (char *prog) {
+    fprintf (
+        stderr,
+        "Usage: %s N Seed\n"
+        "1 <= N <= 10000000, Seed = a random number other than 0\n"
+        "Checks Bloom filters of N words, and the term filter on a\n"
+        "collection made from Seed\n",
+        prog
+    );
+    exit (EXIT_FAILURE);
+}
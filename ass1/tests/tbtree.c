@@ -0,0 +1,156 @@
+// tbtree.c ... the B-tree dictionary against a binary search tree
+//
+// Inserts N distinct words, in a random order, into a BTree and into an
+// InvertedIndexBST without insertIntoBST's rebalancing (which walks the
+// whole subtree on every insert), then adds a second file to every tenth
+// word.  Checks that both hold the same words and FileLists, in the same
+// order, and times insert and lookup in each.
+//
+// Usage: tbtree N Seed
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "BTree.h"
+#include "tcollection.h"
+
+typedef struct Walk {
+    InvertedIndexBST *nodes;    // the binary tree's nodes, in order
+    int n;
+    int max;
+    int ok;
+} Walk;
+
+static void usage (char *prog) __attribute__((noreturn));
+static InvertedIndexBST plainInsert (InvertedIndexBST tree, char *word, char *filename);
+static int inOrder (InvertedIndexBST tree, InvertedIndexBST *nodes, int n);
+static void checkTerm (char *word, FileList files, void *cl);
+
+int main (int argc, char *argv[]) {
+    if (argc != 3) usage (argv[0]);
+    int N = atoi (argv[1]);
+    uint64_t seed = strtoull (argv[2], NULL, 10);
+    if (N < 1 || N > 10000000 || seed == 0) usage (argv[0]);
+
+    char (*words)[16] = malloc (N * sizeof *words);
+    assert(words != NULL);
+    for (int i = 0; i < N; i++) vocabWord (i, words[i]);
+    for (int i = N - 1; i > 0; i--) {
+        int j = nextRandom (&seed) % (i + 1);
+        char tmp[16];
+        strcpy (tmp, words[i]);
+        strcpy (words[i], words[j]);
+        strcpy (words[j], tmp);
+    }
+
+    struct timespec t;
+    since (&t);
+    InvertedIndexBST bst = NULL;
+    for (int i = 0; i < N; i++) bst = plainInsert (bst, words[i], "f.txt");
+    for (int i = 0; i < N; i += 10) bst = plainInsert (bst, words[i], "e.txt");
+    double bstIns = since (&t);
+    BTree bt = newBTree ();
+    for (int i = 0; i < N; i++) BTreeInsert (bt, words[i], "f.txt");
+    for (int i = 0; i < N; i += 10) BTreeInsert (bt, words[i], "e.txt");
+    double btIns = since (&t);
+
+    // look up in a different order from the inserts
+    for (int i = N - 1; i > 0; i--) {
+        int j = nextRandom (&seed) % (i + 1);
+        char tmp[16];
+        strcpy (tmp, words[i]);
+        strcpy (words[i], words[j]);
+        strcpy (words[j], tmp);
+    }
+    long hits = 0;
+    since (&t);
+    for (int i = 0; i < N; i++) hits += findWord (bst, words[i]) != NULL;
+    double bstFind = since (&t);
+    for (int i = 0; i < N; i++) hits += BTreeFind (bt, words[i]) != NULL;
+    double btFind = since (&t);
+
+    int ok = (hits == 2L * N) && BTreeNumTerms (bt) == N;
+    for (int i = 0; i < N && ok; i++) {
+        ok = sameFiles (BTreeFind (bt, words[i]), findWord (bst, words[i])->fileList, 0);
+    }
+    // words are all lower case letters, so none of these is in the tree
+    char miss[32];
+    for (int i = 0; i < N && ok; i += 7) {
+        snprintf (miss, sizeof miss, "%s{", words[i]);
+        ok = BTreeFind (bt, miss) == NULL;
+        miss[0] += 'A' - 'a';
+        miss[strlen (miss) - 1] = '\0';
+        ok = ok && BTreeFind (bt, miss) == NULL;
+    }
+    ok = ok && BTreeFind (bt, "") == NULL;
+
+    Walk w = { malloc (N * sizeof (InvertedIndexBST)), 0, 0, 1 };
+    assert(w.nodes != NULL);
+    w.max = inOrder (bst, w.nodes, 0);
+    BTreeWalk (bt, checkTerm, &w);
+    ok = ok && w.max == N && w.n == N && w.ok;
+
+    printf("N=%d: btree depth %d, %zu bytes; bst depth %d\n",
+        N, BTreeDepth (bt), BTreeBytes (bt), depth (bst));
+    printf("%-6s %12s %14s\n", "", "insert (s)", "lookup (ns/op)");
+    printf("%-6s %12.2f %14.0f\n", "bst", bstIns, bstFind / N * 1e9);
+    printf("%-6s %12.2f %14.0f\n", "btree", btIns, btFind / N * 1e9);
+    printf("tbtree: %s\n", ok ? "ok" : "not ok");
+
+    free (w.nodes);
+    dropBTree (bt);
+    freeInvertedIndex (bst);
+    free (words);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Helper: insertIntoBST without the rebalancing, iteratively
+static InvertedIndexBST plainInsert (InvertedIndexBST tree, char *word, char *filename) {
+    InvertedIndexBST *p = &tree;
+    while (*p != NULL) {
+        int diff = strcmp(word, (*p)->word);
+        if (diff == 0) {
+            (*p)->fileList = insertFilename ((*p)->fileList, filename);
+            return tree;
+        }
+        p = (diff < 0) ? &(*p)->left : &(*p)->right;
+    }
+    *p = newBST (word, filename);
+    return tree;
+}
+
+// Helper: store the nodes of tree in order from nodes[n]; returns the new n
+static int inOrder (InvertedIndexBST tree, InvertedIndexBST *nodes, int n) {
+    if (tree == NULL) return n;
+    n = inOrder (tree->left, nodes, n);
+    nodes[n++] = tree;
+    return inOrder (tree->right, nodes, n);
+}
+
+// Helper: the walk's next word must be the binary tree's next word
+static void checkTerm (char *word, FileList files, void *cl) {
+    Walk *w = cl;
+    if (w->n == w->max) {
+        w->ok = 0;
+        return;
+    }
+    InvertedIndexBST node = w->nodes[w->n++];
+    if (strcmp(word, node->word) != 0 || !sameFiles (files, node->fileList, 0)) w->ok = 0;
+}
+
+static void usage (char *prog) {
+    fprintf (
+        stderr,
+        "Usage: %s N Seed\n"
+        "1 <= N <= 10000000, Seed = a random number other than 0\n"
+        "Checks and times a BTree of N words against a binary search tree\n",
+        prog
+    );
+    exit (EXIT_FAILURE);
+}
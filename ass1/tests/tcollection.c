@@ -0,0 +1,173 @@
+// tcollection.c ... synthetic collections, and timing, for the drivers
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "invertedIndex.h"
+
+#include "tcollection.h"
+
+#define DATADIR "data"
+#define COLLECTION DATADIR "/collection.txt"
+
+static int countNodes (InvertedIndexBST tree);
+static int inOrder (InvertedIndexBST tree, InvertedIndexBST *nodes, int n);
+
+char *makeCollection (int ndocs, int nwords, int vocab, uint64_t seed) {
+    assert(ndocs > 0 && nwords > 0 && vocab > 0 && seed != 0);
+    uint64_t s = seed;
+    for (int d = 0; d < ndocs; d++) makeDocument (d, nwords, vocab, &s);
+    return makeList (COLLECTION, 0, ndocs);
+}
+
+void makeDocument (int d, int nwords, int vocab, uint64_t *s) {
+    char name[32], word[16];
+    mkdir (DATADIR, 0777);
+    FILE *fp = fopen (docName (d, name), "w");
+    assert(fp != NULL);
+    int n = nwords / 2 + nextRandom (s) % (nwords + 1);
+    for (int i = 0; i < n; i++) {
+        uint64_t r = nextRandom (s) % 100;
+        if (r == 0) {
+            fprintf(fp, ".");
+        } else {
+            vocabWord (pickWord (s, vocab), word);
+            if (r < 10) word[0] += 'A' - 'a';
+            fprintf(fp, "%s%.*s", word, r >= 95, &".,;?"[r % 4]);
+        }
+        fprintf(fp, "%c", (i % 10 == 9) ? '\n' : ' ');
+    }
+    fprintf(fp, "\n");
+    fclose (fp);
+}
+
+char *makeList (char *listname, int from, int to) {
+    char name[32];
+    mkdir (DATADIR, 0777);
+    FILE *fp = fopen (listname, "w");
+    assert(fp != NULL);
+    for (int d = from; d < to; d++) {
+        fprintf(fp, "%s%c", docName (d, name), (d % 8 == 7) ? '\n' : ' ');
+    }
+    fprintf(fp, "\n");
+    fclose (fp);
+    return listname;
+}
+
+char *docName (int d, char buf[32]) {
+    snprintf (buf, 32, DATADIR "/t%04d.txt", d);
+    return buf;
+}
+
+int docNumber (char *filename) {
+    return atoi (strrchr (filename, '/') + 2);
+}
+
+char *vocabWord (int i, char buf[16]) {
+    assert(i >= 0);
+    // 0 to 5 scrambled letters, then i in 5 base-26 digits (least
+    // significant first), so the words are distinct and not in i order
+    uint64_t h = (uint64_t) i * 0x9E3779B97F4A7C15ULL + 1;
+    int len = (h >> 32) % 6;
+    int n = 0;
+    for (int j = 0; j < len; j++) {
+        buf[n++] = 'a' + (nextRandom (&h) >> 40) % 26;
+    }
+    for (int j = 0; j < 5; j++, i /= 26) buf[n++] = 'a' + i % 26;
+    buf[n] = '\0';
+    return buf;
+}
+
+int pickWord (uint64_t *s, int vocab) {
+    double u = (nextRandom (s) >> 11) * 0x1.0p-53;
+    int r = (int) pow (vocab + 1, u) - 1;
+    return r < vocab ? r : vocab - 1;
+}
+
+char **makeQuery (char buf[4][16], char *words[5], int vocab, int absent, uint64_t *s) {
+    int nw = 1 + nextRandom (s) % 4;
+    for (int i = 0; i < nw; i++) {
+        int w = (nextRandom (s) % 8 == 0) ? absent : pickWord (s, vocab);
+        words[i] = vocabWord (w, buf[i]);
+    }
+    words[nw] = NULL;
+    return words;
+}
+
+int sameResults (TfIdfList list, TfIdfResult out[], int n, double eps) {
+    int i = 0;
+    for (; list != NULL && i < n; list = list->next, i++) {
+        if (strcmp(list->filename, out[i].filename) != 0
+                || fabs (list->tfidf_sum - out[i].tfidf_sum) > eps) return 0;
+    }
+    return list == NULL && i == n;
+}
+
+int sameLists (TfIdfList a, TfIdfList b, double eps) {
+    for (; a != NULL && b != NULL; a = a->next, b = b->next) {
+        if (strcmp(a->filename, b->filename) != 0 || fabs (a->tfidf_sum - b->tfidf_sum) > eps) return 0;
+    }
+    return a == NULL && b == NULL;
+}
+
+int sameFiles (FileList a, FileList b, double eps) {
+    for (; a != NULL && b != NULL; a = a->next, b = b->next) {
+        if (strcmp(a->filename, b->filename) != 0 || fabs (a->tf - b->tf) > eps) return 0;
+    }
+    return a == NULL && b == NULL;
+}
+
+int sameIndex (InvertedIndexBST a, InvertedIndexBST b, double eps) {
+    int n = countNodes (a);
+    if (countNodes (b) != n) return 0;
+    InvertedIndexBST *x = malloc ((n + 1) * sizeof (InvertedIndexBST));
+    InvertedIndexBST *y = malloc ((n + 1) * sizeof (InvertedIndexBST));
+    assert(x != NULL && y != NULL);
+    inOrder (a, x, 0);
+    inOrder (b, y, 0);
+
+    int same = 1;
+    for (int i = 0; i < n && same; i++) {
+        same = strcmp(x[i]->word, y[i]->word) == 0
+            && sameFiles (x[i]->fileList, y[i]->fileList, eps);
+    }
+    free (x);
+    free (y);
+    return same;
+}
+
+uint64_t nextRandom (uint64_t *s) {
+    *s ^= *s >> 12;
+    *s ^= *s << 25;
+    *s ^= *s >> 27;
+    return *s * 0x2545F4914F6CDD1DULL;
+}
+
+double since (struct timespec *t) {
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    double secs = (now.tv_sec - t->tv_sec) + (now.tv_nsec - t->tv_nsec) / 1e9;
+    *t = now;
+    return secs;
+}
+
+// Helper: number of nodes in tree
+static int countNodes (InvertedIndexBST tree) {
+    if (tree == NULL) return 0;
+    return countNodes (tree->left) + 1 + countNodes (tree->right);
+}
+
+// Helper: store the nodes of tree in order from nodes[n]; returns the new n
+static int inOrder (InvertedIndexBST tree, InvertedIndexBST *nodes, int n) {
+    if (tree == NULL) return n;
+    n = inOrder (tree->left, nodes, n);
+    nodes[n++] = tree;
+    return inOrder (tree->right, nodes, n);
+}
@@ -0,0 +1,68 @@
+// tcollection.h ... synthetic collections, and timing, for the drivers
+//
+// The drivers check each module against the functions of invertedIndex.h
+// on a collection made up here, so they need no data files.  Words are
+// drawn from a vocabulary with a Zipf-like skew, so a few are in almost
+// every file and most are in only a few; some are capitalised or end in
+// punctuation, and some are a lone ".", which normalises to "".
+
+#ifndef _TCOLLECTION_GUARD
+#define _TCOLLECTION_GUARD
+
+#include <stdint.h>
+#include <time.h>
+
+#include "invertedIndex.h"
+#include "Query.h"
+
+/** Write ndocs files of about nwords words each, drawn from the first
+    vocab words of the vocabulary, as data/t0000.txt, data/t0001.txt, ...
+    and a collection file naming them; returns the collection's name.
+*/
+char *makeCollection (int ndocs, int nwords, int vocab, uint64_t seed);
+
+// (re)write file number d of a collection, as makeCollection does
+void makeDocument (int d, int nwords, int vocab, uint64_t *s);
+
+// write a collection file, listname, naming files from to to - 1; returns listname
+char *makeList (char *listname, int from, int to);
+
+// the name of file number d, e.g. "data/t0042.txt", and back again
+char *docName (int d, char buf[32]);
+int docNumber (char *filename);
+
+// word number i of the vocabulary (5 to 10 lower case letters) into buf
+char *vocabWord (int i, char buf[16]);
+
+// a word number below vocab, rank r about as likely as 1/r, as in the files
+int pickWord (uint64_t *s, int vocab);
+
+/** Set words[] to a query of one to four words, picked as pickWord does
+    but with one in eight of them word number absent (at least vocab, so
+    not in the collection); buf holds the words.  Returns words.
+*/
+char **makeQuery (char buf[4][16], char *words[5], int vocab, int absent, uint64_t *s);
+
+// true if list has the n results of out[], in order, with tfidf_sums no
+// more than eps apart
+int sameResults (TfIdfList list, TfIdfResult out[], int n, double eps);
+
+// true if both lists have the same filenames, in order, with tfidf_sums
+// no more than eps apart
+int sameLists (TfIdfList a, TfIdfList b, double eps);
+
+// true if both FileLists have the same filenames, in order, with tfs no
+// more than eps apart
+int sameFiles (FileList a, FileList b, double eps);
+
+// true if both trees have the same words, in order, with the same
+// filenames and tfs no more than eps apart
+int sameIndex (InvertedIndexBST a, InvertedIndexBST b, double eps);
+
+// the next number from a xorshift64* generator; *s must not be 0
+uint64_t nextRandom (uint64_t *s);
+
+// seconds since *t, which is then reset to now
+double since (struct timespec *t);
+
+#endif
@@ -0,0 +1,144 @@
+// tcompact.c ... the frozen index against the tree it was made from
+//
+// Freezes the index of a made-up collection, frees the tree, and checks
+// every word of a second copy against the frozen one: its number is its
+// place in word order, and its postings are the same files and tfs in
+// the same order.  Words not in the index must not be found, and an
+// empty index must freeze to one with no words.  Then times lookups,
+// and reading every posting of a word, in each.
+//
+// Usage: tcompact Ndocs Nlookups Seed
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "External.h"
+#include "Compact.h"
+#include "tcollection.h"
+
+#define NWORDS 200
+#define VOCAB 20000
+#define INDEX "data/index.txt"
+
+static void usage (char *prog) __attribute__((noreturn));
+static int checkWords (CompactIndex ci, InvertedIndexBST tree, int *w);
+static int notFound (CompactIndex ci, char *word);
+
+int main (int argc, char *argv[]) {
+    if (argc != 4) usage (argv[0]);
+    int ndocs = atoi (argv[1]);
+    int nlookups = atoi (argv[2]);
+    uint64_t seed = strtoull (argv[3], NULL, 10);
+    if (ndocs < 1 || ndocs > 10000 || nlookups < 1 || seed == 0) usage (argv[0]);
+
+    char *collection = makeCollection (ndocs, NWORDS, VOCAB, seed);
+    generateInvertedIndexExternal (collection, INDEX, (size_t) 1 << 30);
+    InvertedIndexBST first = loadInvertedIndex (INDEX);
+    struct timespec t;
+    since (&t);
+    CompactIndex ci = freezeInvertedIndex (first);
+    double freeze = since (&t);
+    // the copy must not share anything with the tree
+    freeInvertedIndex (first);
+
+    InvertedIndexBST tree = loadInvertedIndex (INDEX);
+    int nwords = 0;
+    int ok = checkWords (ci, tree, &nwords) && compactNumWords (ci) == nwords;
+    char word[16];
+    for (int i = 0; i < VOCAB && ok; i += 3) ok = notFound (ci, vocabWord (i, word));
+    ok = ok && compactFind (ci, "") == -1;
+    CompactIndex empty = freezeInvertedIndex (NULL);
+    ok = ok && compactNumWords (empty) == 0 && compactFind (empty, word) == -1;
+    dropCompactIndex (empty);
+    compactReport (ci, tree, stdout);
+
+    // look up common and rare words alike
+    uint64_t s = seed;
+    long hits = 0;
+    since (&t);
+    for (int i = 0; i < nlookups; i++) {
+        hits += findWord (tree, vocabWord (nextRandom (&s) % VOCAB, word)) != NULL;
+    }
+    double treeFind = since (&t);
+    s = seed;
+    for (int i = 0; i < nlookups; i++) {
+        hits -= compactFind (ci, vocabWord (nextRandom (&s) % VOCAB, word)) >= 0;
+    }
+    double compactFindTime = since (&t);
+    ok = ok && hits == 0;
+
+    // read every posting of common words
+    double sum = 0;
+    s = seed;
+    since (&t);
+    for (int i = 0; i < nlookups; i++) {
+        InvertedIndexBST node = findWord (tree, vocabWord (pickWord (&s, 100), word));
+        for (FileList f = node ? node->fileList : NULL; f != NULL; f = f->next) sum += f->tf;
+    }
+    double treeScan = since (&t);
+    s = seed;
+    for (int i = 0; i < nlookups; i++) {
+        int w = compactFind (ci, vocabWord (pickWord (&s, 100), word));
+        unsigned *files;
+        double *tf;
+        int n = (w >= 0) ? compactPostings (ci, w, &files, &tf) : 0;
+        for (int j = 0; j < n; j++) sum -= tf[j];
+    }
+    double compactScan = since (&t);
+    ok = ok && sum < 1e-6 && sum > -1e-6;
+
+    printf("%d words: freeze %.3fs; lookup %.0f ns tree, %.0f ns frozen; "
+        "common word's postings %.0f ns tree, %.0f ns frozen\n",
+        nwords, freeze, treeFind / nlookups * 1e9, compactFindTime / nlookups * 1e9,
+        treeScan / nlookups * 1e9, compactScan / nlookups * 1e9);
+    printf("tcompact: %s\n", ok ? "ok" : "not ok");
+    dropCompactIndex (ci);
+    freeInvertedIndex (tree);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Helper: every word of tree, in order from number *w, is in ci with the
+// same postings
+static int checkWords (CompactIndex ci, InvertedIndexBST tree, int *w) {
+    if (tree == NULL) return 1;
+    if (!checkWords (ci, tree->left, w)) return 0;
+    int found = compactFind (ci, tree->word);
+    if (found != *w || strcmp(compactWord (ci, found), tree->word) != 0) return 0;
+    unsigned *files;
+    double *tf;
+    int n = compactPostings (ci, found, &files, &tf);
+    int i = 0;
+    for (FileList f = tree->fileList; f != NULL; f = f->next, i++) {
+        if (i >= n || strcmp(compactFilename (ci, files[i]), f->filename) != 0 || tf[i] != f->tf) return 0;
+    }
+    if (i != n) return 0;
+    (*w)++;
+    return checkWords (ci, tree->right, w);
+}
+
+// Helper: word with a character added, or capitalised, is never found
+static int notFound (CompactIndex ci, char *word) {
+    char miss[32];
+    snprintf (miss, sizeof miss, "%s{", word);
+    if (compactFind (ci, miss) != -1) return 0;
+    snprintf (miss, sizeof miss, "%c%s", word[0] + 'A' - 'a', word + 1);
+    return compactFind (ci, miss) == -1;
+}
+
+static void usage (char *prog) {
+    fprintf (
+        stderr,
+        "Usage: %s Ndocs Nlookups Seed\n"
+        "1 <= Ndocs <= 10000, 1 <= Nlookups, Seed = a random number other than 0\n"
+        "Checks the frozen index against the tree, on a collection of Ndocs\n"
+        "files made from Seed\n",
+        prog
+    );
+    exit (EXIT_FAILURE);
+}
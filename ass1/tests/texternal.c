@@ -0,0 +1,94 @@
+// texternal.c ... the bounded-memory index build
+//
+// Builds the index of a made-up collection with generateInvertedIndex,
+// then with generateInvertedIndexExternal at budgets from a few kilobytes
+// (many runs to merge) to one that holds everything (a single run).  Each
+// index is loaded back and must equal the first, word for word and tf for
+// tf, and no run files may be left behind, even when the index itself
+// cannot be written.
+//
+// Usage: texternal Ndocs Seed
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "External.h"
+#include "tcollection.h"
+
+#define NWORDS 200
+#define VOCAB 5000
+#define INDEX "data/index.txt"
+
+static void usage (char *prog) __attribute__((noreturn));
+static int noRuns (void);
+
+int main (int argc, char *argv[]) {
+    if (argc != 3) usage (argv[0]);
+    int ndocs = atoi (argv[1]);
+    uint64_t seed = strtoull (argv[2], NULL, 10);
+    if (ndocs < 1 || ndocs > 10000 || seed == 0) usage (argv[0]);
+
+    char *collection = makeCollection (ndocs, NWORDS, VOCAB, seed);
+    struct timespec t;
+    since (&t);
+    InvertedIndexBST want = generateInvertedIndex (collection);
+    printf("generateInvertedIndex: %.3fs\n", since (&t));
+
+    int ok = 1;
+    size_t budgets[] = { 4096, 65536, 1 << 20, (size_t) 1 << 30 };
+    for (int i = 0; i < 4; i++) {
+        since (&t);
+        int n = generateInvertedIndexExternal (collection, INDEX, budgets[i]);
+        double build = since (&t);
+        InvertedIndexBST got = loadInvertedIndex (INDEX);
+        double load = since (&t);
+        int same = n == ndocs && sameIndex (want, got, 0) && noRuns ();
+        printf("budget %10zu: build %.3fs, load %.3fs; %s\n",
+            budgets[i], build, load, same ? "ok" : "not ok");
+        ok &= same;
+        freeInvertedIndex (got);
+    }
+
+    ok &= generateInvertedIndexExternal ("data/none.txt", INDEX, 4096) == -1;
+    // runs are written, but the index is a directory
+    mkdir ("data/dir.txt", 0777);
+    ok &= generateInvertedIndexExternal (collection, "data/dir.txt", 4096) == -1 && noRuns ();
+    rmdir ("data/dir.txt");
+    ok &= loadInvertedIndex ("data/none.txt") == NULL;
+    printf("texternal: %s\n", ok ? "ok" : "not ok");
+    freeInvertedIndex (want);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Helper: true if there are no run files in data/
+static int noRuns (void) {
+    DIR *dir = opendir ("data");
+    if (dir == NULL) return 1;
+    int none = 1;
+    struct dirent *e;
+    while ((e = readdir (dir)) != NULL) {
+        if (strstr (e->d_name, ".run") != NULL) none = 0;
+    }
+    closedir (dir);
+    return none;
+}
+
+static void usage (char *prog) {
+    fprintf (
+        stderr,
+        "Usage: %s Ndocs Seed\n"
+        "1 <= Ndocs <= 10000, Seed = a random number other than 0\n"
+        "Checks generateInvertedIndexExternal against generateInvertedIndex\n"
+        "on a collection of Ndocs files made from Seed\n",
+        prog
+    );
+    exit (EXIT_FAILURE);
+}
@@ -0,0 +1,176 @@
+// tforward.c ... "more like this" against comparing every pair of files
+//
+// Builds the forward index of a made-up collection, then for every file
+// asks moreLikeThis for its k most similar files.  The answer must match
+// the cosines of the files' full tf-idf vectors, worked out here from
+// the inverted index: the same files (other than the query, and only
+// those sharing a word of non-zero idf), best first, each cosine within
+// 1e-9.  Then checks the forward index built by generateInvertedIndex,
+// and times both ways.
+//
+// Usage: tforward Ndocs K Seed
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "External.h"
+#include "Forward.h"
+#include "tcollection.h"
+
+#define NWORDS 200
+#define VOCAB 5000
+#define INDEX "data/index.txt"
+
+typedef struct Dense {
+    int ndocs, nwords;
+    double *weight;     // ndocs rows of nwords tf-idf weights
+} Dense;
+
+static void usage (char *prog) __attribute__((noreturn));
+static int fillDense (Dense *v, InvertedIndexBST tree, int D, int w);
+static int bruteSimilar (Dense *v, int q, Similar out[], char names[][32], double cosine[]);
+static int sameSimilar (Similar got[], int n, Similar want[], int m, int k, double cosine[]);
+static int bySimilarity (const void *a, const void *b);
+
+int main (int argc, char *argv[]) {
+    if (argc != 4) usage (argv[0]);
+    int ndocs = atoi (argv[1]);
+    int k = atoi (argv[2]);
+    uint64_t seed = strtoull (argv[3], NULL, 10);
+    if (ndocs < 2 || ndocs > 10000 || k < 1 || seed == 0) usage (argv[0]);
+
+    char *collection = makeCollection (ndocs, NWORDS, VOCAB, seed);
+    generateInvertedIndexExternal (collection, INDEX, (size_t) 1 << 30);
+    InvertedIndexBST tree = loadInvertedIndex (INDEX);
+    Dense v = { ndocs, 0, NULL };
+    v.nwords = fillDense (&v, tree, ndocs, 0);
+    v.weight = calloc ((size_t) ndocs * v.nwords, sizeof (double));
+    assert(v.weight != NULL);
+    fillDense (&v, tree, ndocs, 0);
+
+    char (*names)[32] = malloc (ndocs * sizeof *names);
+    Similar *got = malloc (ndocs * sizeof (Similar));
+    Similar *want = malloc (ndocs * sizeof (Similar));
+    double *cosine = malloc (ndocs * sizeof (double));
+    assert(names != NULL && got != NULL && want != NULL && cosine != NULL);
+    for (int d = 0; d < ndocs; d++) docName (d, names[d]);
+
+    struct timespec t;
+    since (&t);
+    ForwardIndex fi = newForwardIndex (tree, ndocs);
+    double build = since (&t);
+    double mlt = 0, brute = 0;
+    int ok = 1;
+    for (int q = 0; q < ndocs && ok; q++) {
+        since (&t);
+        int n = moreLikeThis (fi, names[q], got, k);
+        mlt += since (&t);
+        int m = bruteSimilar (&v, q, want, names, cosine);
+        brute += since (&t);
+        ok = sameSimilar (got, n, want, m, k, cosine);
+    }
+    ok = ok && moreLikeThis (fi, "data/none.txt", got, k) == -1;
+    printf("%d files: build %.3fs; moreLikeThis %.3f ms/file, every pair %.3f ms/file\n",
+        ndocs, build, mlt / ndocs * 1e3, brute / ndocs * 1e3);
+    dropForwardIndex (fi);
+
+    // the one generateInvertedIndex builds must answer the same
+    useForwardIndex (1);
+    int few = ndocs < 50 ? ndocs : 50;
+    InvertedIndexBST built = generateInvertedIndex (makeList ("data/few.txt", 0, few));
+    fi = forwardIndexOf (built);
+    ForwardIndex mine = newForwardIndex (built, few);
+    ok = ok && fi != NULL;
+    for (int q = 0; q < few && ok; q++) {
+        int n = moreLikeThis (fi, names[q], got, k);
+        int m = moreLikeThis (mine, names[q], want, k);
+        ok = n == m;
+        for (int i = 0; i < n && ok; i++) {
+            ok = strcmp(got[i].filename, want[i].filename) == 0 && got[i].cosine == want[i].cosine;
+        }
+    }
+    dropForwardIndex (mine);
+    freeInvertedIndex (built);
+    useForwardIndex (0);
+
+    printf("tforward: %s\n", ok ? "ok" : "not ok");
+    free (cosine);
+    free (want);
+    free (got);
+    free (names);
+    free (v.weight);
+    freeInvertedIndex (tree);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Helper: set the weights of words w, w + 1, ... (in order) of every file,
+// if there is room for them yet; returns the number of words
+static int fillDense (Dense *v, InvertedIndexBST tree, int D, int w) {
+    if (tree == NULL) return w;
+    w = fillDense (v, tree->left, D, w);
+    if (v->weight != NULL) {
+        double idf = log10 ((double) D / docFreq (tree));
+        for (FileList f = tree->fileList; f != NULL; f = f->next) {
+            v->weight[(size_t) docNumber (f->filename) * v->nwords + w] = f->tf * idf;
+        }
+    }
+    return fillDense (v, tree->right, D, w + 1);
+}
+
+// Helper: the cosine of file q with every other file, by their full
+// vectors, into cosine[] (-1 if they share no word of non-zero idf); the
+// files that do share one go in out[], most similar first
+static int bruteSimilar (Dense *v, int q, Similar out[], char names[][32], double cosine[]) {
+    double *x = &v->weight[(size_t) q * v->nwords];
+    double xx = 0;
+    for (int w = 0; w < v->nwords; w++) xx += x[w] * x[w];
+    int m = 0;
+    for (int d = 0; d < v->ndocs; d++) {
+        double *y = &v->weight[(size_t) d * v->nwords];
+        double xy = 0, yy = 0;
+        for (int w = 0; w < v->nwords; w++) {
+            xy += x[w] * y[w];
+            yy += y[w] * y[w];
+        }
+        cosine[d] = (d == q || xy == 0) ? -1 : xy / sqrt (xx * yy);
+        if (cosine[d] >= 0) out[m++] = (Similar) { names[d], cosine[d] };
+    }
+    qsort (out, m, sizeof (Similar), bySimilarity);
+    return m;
+}
+
+// Helper: got[] holds the top k of want[]; files whose cosines are within
+// 1e-9 may come in either order
+static int sameSimilar (Similar got[], int n, Similar want[], int m, int k, double cosine[]) {
+    if (n != (m < k ? m : k)) return 0;
+    for (int i = 0; i < n; i++) {
+        double c = cosine[docNumber (got[i].filename)];
+        if (fabs (got[i].cosine - want[i].cosine) > 1e-9 || fabs (got[i].cosine - c) > 1e-9) return 0;
+    }
+    return 1;
+}
+
+static int bySimilarity (const void *a, const void *b) {
+    const Similar *x = a, *y = b;
+    if (x->cosine != y->cosine) return x->cosine > y->cosine ? -1 : 1;
+    return strcmp(x->filename, y->filename);
+}
+
+static void usage (char *prog) {
+    fprintf (
+        stderr,
+        "Usage: %s Ndocs K Seed\n"
+        "2 <= Ndocs <= 10000, 1 <= K, Seed = a random number other than 0\n"
+        "Checks moreLikeThis against the cosines of full tf-idf vectors, on\n"
+        "a collection of Ndocs files made from Seed\n",
+        prog
+    );
+    exit (EXIT_FAILURE);
+}
@@ -0,0 +1,189 @@
+// timpact.c ... impact-ordered retrieval against scoring every posting
+//
+// Quantises the index of a made-up collection at 4, 8 and 16 bits.  With
+// no budget, impactRetrieve's top k for random queries must be exactly
+// the top k of summing every posting's impact, worked out here (sums
+// within 1e-9); with a budget it may stop early, so only the order of
+// its results is checked, and how many postings it read and how many of
+// retrieve's top k it found are reported.  k = 0 must read nothing.
+//
+// Usage: timpact Nqueries K Seed
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "External.h"
+#include "Query.h"
+#include "Impact.h"
+#include "tcollection.h"
+
+#define NDOCS 1000
+#define NWORDS 200
+#define VOCAB 10000
+#define INDEX "data/index.txt"
+
+typedef struct Quantiser {
+    double step;
+    int levels;
+    long sum[NDOCS];    // of impacts, by file number
+} Quantiser;
+
+static void usage (char *prog) __attribute__((noreturn));
+static double maxTfIdf (InvertedIndexBST tree);
+static int bruteTop (InvertedIndexBST tree, Quantiser *qz, char *words[], TfIdfResult out[]);
+static int inOrder (TfIdfResult out[], int n);
+static int overlap (TfIdfResult a[], int na, TfIdfResult b[], int nb);
+
+int main (int argc, char *argv[]) {
+    if (argc != 4) usage (argv[0]);
+    int nq = atoi (argv[1]);
+    int k = atoi (argv[2]);
+    uint64_t seed = strtoull (argv[3], NULL, 10);
+    if (nq < 1 || nq > 1000000 || k < 1 || k > NDOCS || seed == 0) usage (argv[0]);
+
+    char *collection = makeCollection (NDOCS, NWORDS, VOCAB, seed);
+    generateInvertedIndexExternal (collection, INDEX, (size_t) 1 << 30);
+    InvertedIndexBST tree = loadInvertedIndex (INDEX);
+    double max = maxTfIdf (tree);
+    TfIdfResult *out = malloc (NDOCS * sizeof (TfIdfResult));
+    TfIdfResult *want = malloc (NDOCS * sizeof (TfIdfResult));
+    TfIdfResult *full = malloc (NDOCS * sizeof (TfIdfResult));
+    Quantiser *qz = malloc (sizeof (Quantiser));
+    assert(out != NULL && want != NULL && full != NULL && qz != NULL);
+
+    int ok = 1;
+    long budgets[] = { 0, 1000, 200 };
+    printf("%-5s %7s %8s %8s %12s %18s\n", "bits", "budget", "read/q", "overlap",
+        "impact (us)", "retrieveInto (us)");
+    for (int bits = 4; bits <= 16; bits *= 2) {
+        ImpactIndex ix = newImpactIndex (tree, NDOCS, bits);
+        qz->levels = (1 << bits) - 1;
+        qz->step = max / qz->levels;
+        char first[16];
+        char *one[] = { vocabWord (0, first), NULL };
+        long processed = -1;
+        ok &= impactRetrieve (ix, one, 0, 0, out, &processed) == 0 && processed == 0;
+
+        for (int b = 0; b < 3; b++) {
+            uint64_t s = seed;
+            char buf[4][16];
+            char *words[5];
+            long read = 0;
+            double shared = 0, impactTime = 0, fullTime = 0;
+            struct timespec t;
+            for (int q = 0; q < nq; q++) {
+                makeQuery (buf, words, VOCAB, VOCAB + q, &s);
+                int m = bruteTop (tree, qz, words, want);
+                since (&t);
+                int n = impactRetrieve (ix, words, k, budgets[b], out, &processed);
+                impactTime += since (&t);
+                int nf = retrieveInto (tree, words, NDOCS, full, NDOCS);
+                fullTime += since (&t);
+                read += processed;
+
+                if (budgets[b] == 0) {
+                    ok &= n == (m < k ? m : k);
+                    for (int i = 0; i < n && ok; i++) {
+                        ok = strcmp(out[i].filename, want[i].filename) == 0
+                            && fabs (out[i].tfidf_sum - want[i].tfidf_sum) <= 1e-9;
+                    }
+                } else {
+                    ok &= n <= k && inOrder (out, n);
+                }
+                nf = nf < k ? nf : k;
+                shared += (nf > 0) ? (double) overlap (out, n, full, nf) / nf : 1;
+            }
+            printf("%-5d %7ld %8.0f %8.3f %12.1f %18.1f\n", bits, budgets[b],
+                (double) read / nq, shared / nq, impactTime / nq * 1e6, fullTime / nq * 1e6);
+        }
+        dropImpactIndex (ix);
+    }
+    printf("timpact: %s\n", ok ? "ok" : "not ok");
+    free (qz);
+    free (full);
+    free (want);
+    free (out);
+    freeInvertedIndex (tree);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Helper: the largest tf-idf of any posting
+static double maxTfIdf (InvertedIndexBST tree) {
+    if (tree == NULL) return 0;
+    double idf = log10 ((double) NDOCS / docFreq (tree));
+    double max = 0;
+    for (FileList f = tree->fileList; f != NULL; f = f->next) {
+        if (f->tf * idf > max) max = f->tf * idf;
+    }
+    double left = maxTfIdf (tree->left), right = maxTfIdf (tree->right);
+    if (left > max) max = left;
+    return right > max ? right : max;
+}
+
+// Helper: every file's sum of the impacts of its postings for words (a
+// word given twice counts twice), highest first, ties in filename order
+static int bruteTop (InvertedIndexBST tree, Quantiser *qz, char *words[], TfIdfResult out[]) {
+    memset (qz->sum, 0, sizeof qz->sum);
+    char *names[NDOCS] = { NULL };
+    for (int w = 0; words[w] != NULL; w++) {
+        InvertedIndexBST node = findWord (tree, words[w]);
+        if (node == NULL) continue;
+        double idf = log10 ((double) NDOCS / docFreq (node));
+        for (FileList f = node->fileList; f != NULL; f = f->next) {
+            if (f->tf * idf <= 0) continue;
+            long impact = lround (f->tf * idf / qz->step);
+            if (impact < 1) impact = 1;
+            if (impact > qz->levels) impact = qz->levels;
+            int d = docNumber (f->filename);
+            qz->sum[d] += impact;
+            names[d] = f->filename;
+        }
+    }
+    int n = 0;
+    for (int d = 0; d < NDOCS; d++) {
+        if (qz->sum[d] > 0) out[n++] = (TfIdfResult) { names[d], qz->sum[d] * qz->step };
+    }
+    qsort (out, n, sizeof (TfIdfResult), resultCmp);
+    return n;
+}
+
+// Helper: out[] is in result order
+static int inOrder (TfIdfResult out[], int n) {
+    for (int i = 1; i < n; i++) {
+        if (resultCmp (&out[i - 1], &out[i]) > 0) return 0;
+    }
+    return 1;
+}
+
+// Helper: how many files of a[] are also in b[]
+static int overlap (TfIdfResult a[], int na, TfIdfResult b[], int nb) {
+    int common = 0;
+    for (int i = 0; i < na; i++) {
+        for (int j = 0; j < nb; j++) {
+            if (strcmp(a[i].filename, b[j].filename) == 0) {
+                common++;
+                break;
+            }
+        }
+    }
+    return common;
+}
+
+static void usage (char *prog) {
+    fprintf (
+        stderr,
+        "Usage: %s Nqueries K Seed\n"
+        "1 <= Nqueries <= 1000000, 1 <= K <= %d, Seed = a random number other than 0\n"
+        "Checks impactRetrieve against scoring every posting, on a collection\n"
+        "made from Seed\n",
+        prog, NDOCS
+    );
+    exit (EXIT_FAILURE);
+}
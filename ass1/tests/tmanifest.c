@@ -0,0 +1,165 @@
+// tmanifest.c ... incremental rebuilds against building from scratch
+//
+// Indexes a made-up collection with rebuildInvertedIndex, then for a few
+// rounds changes some files, touches others (a new mtime, the same
+// contents), adds new ones and drops some from the collection, and
+// rebuilds.  Each time the index must be byte for byte what
+// generateInvertedIndexExternal writes for the collection as it is, and
+// the stats must count each kind of file.  Times both.
+//
+// Usage: tmanifest Ndocs Nrounds Seed
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "invertedIndex.h"
+#include "External.h"
+#include "Manifest.h"
+#include "tcollection.h"
+
+#define NWORDS 200
+#define VOCAB 5000
+#define LIST "data/list.txt"
+#define INDEX "data/index.txt"
+#define FULL "data/full.txt"
+
+static void usage (char *prog) __attribute__((noreturn));
+static void writeList (int *in, int ndocs);
+static void setMtime (int d, time_t when);
+static int sameBytes (char *a, char *b);
+static int check (RebuildStats *want, double *rebuild, double *full);
+
+int main (int argc, char *argv[]) {
+    if (argc != 4) usage (argv[0]);
+    int ndocs = atoi (argv[1]);
+    int nrounds = atoi (argv[2]);
+    uint64_t seed = strtoull (argv[3], NULL, 10);
+    if (ndocs < 10 || ndocs > 5000 || nrounds < 1 || seed == 0) usage (argv[0]);
+
+    // in[d] is 1 if file d is in the collection; files are added at the end
+    int maxdocs = ndocs + nrounds * (ndocs / 10 + 1);
+    int *in = calloc (maxdocs, sizeof (int));
+    assert(in != NULL);
+    uint64_t s = seed;
+    for (int d = 0; d < ndocs; d++) {
+        makeDocument (d, NWORDS, VOCAB, &s);
+        in[d] = 1;
+    }
+    writeList (in, ndocs);
+    remove (INDEX);
+    remove (INDEX ".manifest");
+
+    double rebuild, full;
+    RebuildStats want = { .added = ndocs };
+    int ok = check (&want, &rebuild, &full);
+    printf("%-7s %9s %7s %7s %5s %7s %11s %9s\n", "round", "unchanged", "touched",
+        "changed", "added", "removed", "rebuild (s)", "full (s)");
+    printf("%-7s %9d %7d %7d %5d %7d %11.3f %9.3f; %s\n", "first", want.unchanged,
+        want.touched, want.changed, want.added, want.removed, rebuild, full, ok ? "ok" : "not ok");
+    want = (RebuildStats) { .unchanged = ndocs };
+    ok &= check (&want, &rebuild, &full);
+
+    // new mtimes, safely after any the files were written with
+    time_t when = time (NULL) + 1000;
+    int total = ndocs;
+    for (int r = 1; r <= nrounds; r++) {
+        want = (RebuildStats) { 0 };
+        for (int d = 0; d < total; d++) {
+            if (!in[d]) continue;
+            switch (nextRandom (&s) % 20) {
+            case 0:
+                makeDocument (d, NWORDS, VOCAB, &s);
+                setMtime (d, when++);
+                want.changed++;
+                break;
+            case 1:
+                setMtime (d, when++);
+                want.touched++;
+                break;
+            case 2:
+                in[d] = 0;
+                want.removed++;
+                break;
+            default:
+                want.unchanged++;
+            }
+        }
+        for (int i = 0; i < ndocs / 10 + 1; i++) {
+            makeDocument (total, NWORDS, VOCAB, &s);
+            in[total++] = 1;
+            want.added++;
+        }
+        writeList (in, total);
+        int same = check (&want, &rebuild, &full);
+        printf("%-7d %9d %7d %7d %5d %7d %11.3f %9.3f; %s\n", r, want.unchanged, want.touched,
+            want.changed, want.added, want.removed, rebuild, full, same ? "ok" : "not ok");
+        ok &= same;
+    }
+    ok &= rebuildInvertedIndex ("data/none.txt", INDEX, NULL) == -1;
+    printf("tmanifest: %s\n", ok ? "ok" : "not ok");
+    free (in);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Helper: the collection file, naming every file d with in[d] set
+static void writeList (int *in, int ndocs) {
+    FILE *fp = fopen (LIST, "w");
+    assert(fp != NULL);
+    char name[32];
+    for (int d = 0; d < ndocs; d++) {
+        if (in[d]) fprintf(fp, "%s\n", docName (d, name));
+    }
+    fclose (fp);
+}
+
+// Helper: give file d a modification time of when
+static void setMtime (int d, time_t when) {
+    char name[32];
+    struct timespec times[2] = { { when, 0 }, { when, 0 } };
+    utimensat (AT_FDCWD, docName (d, name), times, 0);
+}
+
+// Helper: rebuild, and compare the index and stats with what they should be
+static int check (RebuildStats *want, double *rebuild, double *full) {
+    struct timespec t;
+    RebuildStats got;
+    since (&t);
+    int n = rebuildInvertedIndex (LIST, INDEX, &got);
+    *rebuild = since (&t);
+    int m = generateInvertedIndexExternal (LIST, FULL, (size_t) 64 << 20);
+    *full = since (&t);
+    return n == m && sameBytes (INDEX, FULL) && memcmp (&got, want, sizeof got) == 0;
+}
+
+// Helper: the two files have the same contents
+static int sameBytes (char *a, char *b) {
+    FILE *fa = fopen (a, "r"), *fb = fopen (b, "r");
+    int same = fa != NULL && fb != NULL;
+    while (same) {
+        int ca = getc (fa), cb = getc (fb);
+        same = ca == cb;
+        if (ca == EOF) break;
+    }
+    if (fa != NULL) fclose (fa);
+    if (fb != NULL) fclose (fb);
+    return same;
+}
+
+static void usage (char *prog) {
+    fprintf (
+        stderr,
+        "Usage: %s Ndocs Nrounds Seed\n"
+        "10 <= Ndocs <= 5000, 1 <= Nrounds, Seed = a random number other than 0\n"
+        "Checks rebuildInvertedIndex against generateInvertedIndexExternal on\n"
+        "a collection of Ndocs files made from Seed, changed each round\n",
+        prog
+    );
+    exit (EXIT_FAILURE);
+}
@@ -0,0 +1,252 @@
+// tnormalise.c ... UTF-8 case folding, checked and timed
+//
+// Checks foldCase on a table of words (ASCII, Latin-1, Greek, Cyrillic,
+// letters that get shorter, and bytes that are not UTF-8), each alone
+// and inside a run of ASCII long enough to take the block path; random
+// ASCII against tolower, at every alignment; and random text folded
+// whole against the same text folded in short pieces, which only take
+// the byte at a time path.  Then times foldCase, and tolower byte by
+// byte, on a few kinds of word.
+//
+// Usage: tnormalise N Seed
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Normalise.h"
+#include "tcollection.h"
+
+#define NBENCH 10000
+#define MAXLEN 256
+
+typedef struct Case {
+    char *in;
+    char *out;
+} Case;
+
+static const Case cases[] = {
+    { "", "" },
+    { "Hello", "hello" },
+    { "ABCXYZ@[`{", "abcxyz@[`{" },
+    { "\xC3\x89" "COLE", "\xC3\xA9" "cole" },                     // ÉCOLE
+    { "Stra\xC3\x9F" "E", "stra\xC3\x9F" "e" },                   // ß stays
+    { "\xC3\x80\xC3\x96\xC3\x97\xC3\x98\xC3\x9E",                 // À Ö × Ø Þ
+      "\xC3\xA0\xC3\xB6\xC3\x97\xC3\xB8\xC3\xBE" },
+    { "\xC5\xB8", "\xC3\xBF" },                                   // Ÿ
+    { "\xC4\xB0", "i" },                                          // İ -> i
+    { "\xCE\x91\xCE\x98\xCE\xA3\xCE\xA9",                         // ΑΘΣΩ
+      "\xCE\xB1\xCE\xB8\xCF\x83\xCF\x89" },
+    { "\xCE\x86\xCE\x8F", "\xCE\xAC\xCF\x8E" },                   // Ά Ώ
+    { "\xD0\x9C\xD0\xBE\xD1\x81\xD0\xBA\xD0\xB2\xD0\xB0",         // Москва
+      "\xD0\xBC\xD0\xBE\xD1\x81\xD0\xBA\xD0\xB2\xD0\xB0" },
+    { "\xD0\x81\xD0\x8F\xD0\xAF", "\xD1\x91\xD1\x9F\xD1\x8F" },   // Ё Џ Я
+    { "\xE2\x84\xAA" "elvin", "kelvin" },                         // K sign -> k
+    { "\xE2\x84\xA6", "\xCF\x89" },                               // Ohm -> ω
+    { "\xE2\x84\xAB", "\xC3\xA5" },                               // Å sign -> å
+    { "\xE1\xBA\x9E", "\xC3\x9F" },                               // ẞ -> ß
+    { "\xEF\xBC\xA1\xEF\xBC\xBA", "\xEF\xBD\x81\xEF\xBD\x9A" },   // fullwidth A Z
+    { "\xF0\x90\x90\x80", "\xF0\x90\x90\xA8" },                   // Deseret
+    { "\xE4\xB8\xAD\xE6\x96\x87", "\xE4\xB8\xAD\xE6\x96\x87" },   // no case
+    // not UTF-8: each byte is left as it is, and the ASCII after it lowered
+    { "\x80" "A\xBF", "\x80" "a\xBF" },
+    { "\xC3" "A", "\xC3" "a" },
+    { "\xC0\x80\xC1\xBF", "\xC0\x80\xC1\xBF" },                   // overlong
+    { "\xE0\x80\x80", "\xE0\x80\x80" },
+    { "\xED\xA0\x80", "\xED\xA0\x80" },                           // surrogate
+    { "\xF4\x90\x80\x80", "\xF4\x90\x80\x80" },                   // past U+10FFFF
+    { "\xF5\xFE\xFF", "\xF5\xFE\xFF" },
+    { "\xE2\x84" "K", "\xE2\x84" "k" },                           // cut short
+};
+#define NCASES (sizeof (cases) / sizeof (cases[0]))
+
+// pieces of random text: upper and lower case, several lengths, and junk
+static char *pieces[] = {
+    "A", "z", "Q", " ", ".", "7", "\xC3\x89", "\xC3\xA9", "\xC3\x9F", "\xC4\xB0",
+    "\xCE\xA3", "\xCF\x83", "\xD0\xAF", "\xD1\x8F", "\xD4\xB1", "\xE2\x84\xAA",
+    "\xE1\xB8\x80", "\xEF\xBC\xA1", "\xE4\xB8\xAD", "\xF0\x90\x90\x80", "\x80",
+    "\xC3", "\xE2\x84", "\xFF", "\xED\xA0\x80",
+};
+#define NPIECES (sizeof (pieces) / sizeof (pieces[0]))
+
+typedef struct Words {
+    char *text;                 // the words, one after another
+    int off[NBENCH + 1];        // word i is text[off[i]] .. text[off[i + 1] - 1]
+} Words;
+
+static void usage (char *prog) __attribute__((noreturn));
+static int checkCase (const Case *c, int pad);
+static int checkAscii (uint64_t *s);
+static int checkPieces (uint64_t *s);
+static int checkNormalise (void);
+static void makeWords (Words *w, char *kind, uint64_t *s);
+static double bench (Words *w, int useFold);
+
+int main (int argc, char *argv[]) {
+    if (argc != 3) usage (argv[0]);
+    int N = atoi (argv[1]);
+    uint64_t seed = strtoull (argv[2], NULL, 10);
+    if (N < 1 || seed == 0) usage (argv[0]);
+
+    int ok = 1;
+    for (size_t i = 0; i < NCASES; i++) {
+        for (int pad = 0; pad <= 40; pad += 20) {
+            if (!checkCase (&cases[i], pad)) {
+                printf("case %zu, padded by %d: not ok\n", i, pad);
+                ok = 0;
+            }
+        }
+    }
+    uint64_t s = seed;
+    for (int i = 0; i < N && ok; i++) ok = checkAscii (&s) && checkPieces (&s);
+    ok = ok && checkNormalise ();
+
+    char *kinds[] = { "ascii", "ascii60", "latin-1", "cyrillic", "mixed", NULL };
+    printf("%-9s %12s %12s %14s\n", "words", "bytes/word", "fold (MB/s)", "tolower (MB/s)");
+    for (int k = 0; kinds[k] != NULL; k++) {
+        Words w;
+        makeWords (&w, kinds[k], &s);
+        printf("%-9s %12.1f %12.0f %14.0f\n", kinds[k], (double) w.off[NBENCH] / NBENCH,
+            bench (&w, 1), bench (&w, 0));
+        free (w.text);
+    }
+    printf("tnormalise: %s\n", ok ? "ok" : "not ok");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Helper: fold c->in, between pad 'X's and pad 'Y's, and compare with c->out
+static int checkCase (const Case *c, int pad) {
+    char buf[MAXLEN], want[MAXLEN];
+    size_t in = strlen (c->in), out = strlen (c->out);
+    memset (buf, 'X', pad);
+    memcpy (buf + pad, c->in, in);
+    memset (buf + pad + in, 'Y', pad);
+    memset (want, 'x', pad);
+    memcpy (want + pad, c->out, out);
+    memset (want + pad + out, 'y', pad);
+    size_t len = foldCase (buf, in + 2 * pad);
+    return len == out + 2 * pad && memcmp (buf, want, len) == 0;
+}
+
+// Helper: random ASCII, at a random alignment, must fold as tolower does
+static int checkAscii (uint64_t *s) {
+    char buf[MAXLEN], want[MAXLEN];
+    int start = nextRandom (s) % 16;
+    int len = nextRandom (s) % (MAXLEN - 16);
+    for (int i = 0; i < len; i++) {
+        buf[start + i] = nextRandom (s) % 0x80;
+        want[i] = tolower ((unsigned char) buf[start + i]);
+    }
+    return foldCase (buf + start, len) == (size_t) len && memcmp (buf + start, want, len) == 0;
+}
+
+// Helper: random text folded whole must be the same as folded in pieces,
+// cut before each ASCII byte (which never ends a character), so that no
+// piece has a block of 8 ASCII bytes in it
+static int checkPieces (uint64_t *s) {
+    char whole[MAXLEN], cut[MAXLEN];
+    int len = 0;
+    while (1) {
+        char *p = pieces[nextRandom (s) % NPIECES];
+        if (len + strlen (p) > MAXLEN - 16) break;
+        memcpy (whole + len, p, strlen (p));
+        len += strlen (p);
+    }
+    memcpy (cut, whole, len);
+    size_t wlen = foldCase (whole, len);
+    size_t clen = 0;
+    int from = 0;
+    for (int i = 1; i <= len; i++) {
+        if (i == len || (unsigned char) cut[i] < 0x80) {
+            // fold cut[from .. i - 1] and move it down to clen
+            size_t n = foldCase (cut + from, i - from);
+            memmove (cut + clen, cut + from, n);
+            clen += n;
+            from = i;
+        }
+    }
+    // folding again changes nothing
+    char again[MAXLEN];
+    memcpy (again, whole, wlen);
+    return wlen <= (size_t) len && clen == wlen && memcmp (whole, cut, wlen) == 0
+        && foldCase (again, wlen) == wlen && memcmp (again, whole, wlen) == 0;
+}
+
+// Helper: normaliseWord folds case as well as trimming spaces and punctuation
+static int checkNormalise (void) {
+    char a[] = "  Hello. ", b[] = "\xC3\x89" "COLE,", c[] = "\xE2\x84\xAA" "?", d[] = ".";
+    return normaliseWord (a) == a && strcmp (a, "hello") == 0
+        && strcmp (normaliseWord (b), "\xC3\xA9" "cole") == 0
+        && strcmp (normaliseWord (c), "k") == 0
+        && strcmp (normaliseWord (d), "") == 0;
+}
+
+// Helper: NBENCH random words of a kind
+static void makeWords (Words *w, char *kind, uint64_t *s) {
+    w->text = malloc (NBENCH * 128);
+    assert(w->text != NULL);
+    static char *latin[] = { "\xC3\x89", "\xC3\xA9", "\xC3\x80", "\xC3\xBC", "\xC3\x87" };
+    static char *cyrillic[] = { "\xD0\x90", "\xD0\xB0", "\xD0\xAF", "\xD1\x8F", "\xD0\x96" };
+    int len = 0;
+    for (int i = 0; i < NBENCH; i++) {
+        w->off[i] = len;
+        int nchars = strcmp (kind, "ascii60") == 0 ? 60 : 4 + nextRandom (s) % 8;
+        // a mixed word is ASCII, Latin-1 or Cyrillic, 70:20:10
+        int r = nextRandom (s) % 10;
+        char **other = (strcmp (kind, "latin-1") == 0 || (strcmp (kind, "mixed") == 0 && r >= 7 && r < 9))
+            ? latin : (strcmp (kind, "cyrillic") == 0 || (strcmp (kind, "mixed") == 0 && r == 9))
+            ? cyrillic : NULL;
+        for (int c = 0; c < nchars; c++) {
+            if (other != NULL && nextRandom (s) % 2) {
+                char *p = other[nextRandom (s) % 5];
+                memcpy (w->text + len, p, 2);
+                len += 2;
+            } else {
+                int letter = nextRandom (s) % 26;
+                w->text[len++] = (nextRandom (s) % 4 ? 'a' : 'A') + letter;
+            }
+        }
+    }
+    w->off[NBENCH] = len;
+}
+
+// Helper: MB/s lowering copies of the words, with foldCase or byte by byte
+static double bench (Words *w, int useFold) {
+    char buf[256];
+    long bytes = 0;
+    double secs = 0;
+    struct timespec t;
+    since (&t);
+    volatile size_t sink = 0;
+    while (secs < 0.2) {
+        for (int i = 0; i < NBENCH; i++) {
+            size_t len = w->off[i + 1] - w->off[i];
+            memcpy (buf, w->text + w->off[i], len);
+            if (useFold) {
+                sink += foldCase (buf, len);
+            } else {
+                for (size_t j = 0; j < len; j++) buf[j] = tolower ((unsigned char) buf[j]);
+                sink += len;
+            }
+            bytes += len;
+        }
+        secs += since (&t);
+    }
+    return bytes / secs / 1e6;
+}
+
+static void usage (char *prog) {
+    fprintf (
+        stderr,
+        "Usage: %s N Seed\n"
+        "1 <= N, Seed = a random number other than 0\n"
+        "Checks foldCase on a table of words and N random strings, and times it\n",
+        prog
+    );
+    exit (EXIT_FAILURE);
+}
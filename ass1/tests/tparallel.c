@@ -0,0 +1,164 @@
+// tparallel.c ... parallel retrieve against retrieve, and its speedup
+//
+// For queries of 1 to 400 search words (half of them common, one given
+// twice) over a made-up collection, parallelRetrieveInto on 1, 2, 4 and
+// 8 threads must give exactly what retrieveInto and retrieve give, to
+// the last bit, and with too little room must still return the number
+// of matches.  Prints the time of each against the number of words.
+// Then several callers share the pool at once, and must still agree.
+//
+// Usage: tparallel Ndocs Nreps Seed
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <err.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "External.h"
+#include "Query.h"
+#include "Parallel.h"
+#include "tcollection.h"
+
+#define NWORDS 200
+#define VOCAB 20000
+#define INDEX "data/index.txt"
+#define MAXTERMS 400
+#define NCALLERS 4
+
+typedef struct Caller {
+    InvertedIndexBST tree;
+    char **words;
+    int ndocs;
+    TfIdfResult *want;
+    int n;
+    int ok;
+} Caller;
+
+static void usage (char *prog) __attribute__((noreturn));
+static int sameArrays (TfIdfResult a[], TfIdfResult b[], int n);
+static void *callParallel (void *cl);
+
+int main (int argc, char *argv[]) {
+    if (argc != 4) usage (argv[0]);
+    int ndocs = atoi (argv[1]);
+    int nreps = atoi (argv[2]);
+    uint64_t seed = strtoull (argv[3], NULL, 10);
+    if (ndocs < 2 || ndocs > 10000 || nreps < 1 || seed == 0) usage (argv[0]);
+
+    char *collection = makeCollection (ndocs, NWORDS, VOCAB, seed);
+    generateInvertedIndexExternal (collection, INDEX, (size_t) 1 << 30);
+    InvertedIndexBST tree = loadInvertedIndex (INDEX);
+    TfIdfResult *a = malloc (ndocs * sizeof (TfIdfResult));
+    TfIdfResult *b = malloc (ndocs * sizeof (TfIdfResult));
+    char (*buf)[16] = malloc (MAXTERMS * sizeof *buf);
+    char **words = malloc ((MAXTERMS + 1) * sizeof (char *));
+    assert(a != NULL && b != NULL && buf != NULL && words != NULL);
+
+    int lens[] = { 1, 8, 50, 100, 200, 400 };
+    int threads[] = { 1, 2, 4, 8 };
+    int ok = 1;
+    printf("%ld cpus online; us per query (speedup over retrieveInto)\n",
+        sysconf (_SC_NPROCESSORS_ONLN));
+    printf("%-6s %8s %10s", "words", "results", "serial");
+    for (int t = 0; t < 4; t++) printf(" %12d thr", threads[t]);
+    printf("\n");
+    for (int l = 0; l < 6; l++) {
+        int len = lens[l];
+        for (int i = 0; i < len; i++) {
+            int w = (nextRandom (&seed) % 2) ? pickWord (&seed, 500) : nextRandom (&seed) % VOCAB;
+            words[i] = vocabWord (w, buf[i]);
+        }
+        if (len > 4) words[3] = words[1];
+        words[len] = NULL;
+
+        struct timespec t;
+        int n = 0;
+        since (&t);
+        for (int r = 0; r < nreps; r++) n = retrieveInto (tree, words, ndocs, a, ndocs);
+        double serial = since (&t) / nreps;
+        TfIdfList list = retrieve (tree, words, ndocs);
+        ok &= sameResults (list, a, n, 0);
+        freeTfIdfList (list);
+
+        printf("%-6d %8d %10.1f", len, n, serial * 1e6);
+        for (int i = 0; i < 4; i++) {
+            int m = 0;
+            since (&t);
+            for (int r = 0; r < nreps; r++) {
+                m = parallelRetrieveInto (tree, words, ndocs, b, ndocs, threads[i]);
+            }
+            double par = since (&t) / nreps;
+            ok &= m == n && sameArrays (a, b, n);
+            printf(" %9.1f (%4.2f)", par * 1e6, serial / par);
+        }
+        printf("\n");
+        if (n > 1) ok &= parallelRetrieveInto (tree, words, ndocs, b, n - 1, 3) == n;
+    }
+
+    // words[] still holds the longest query, and a its results
+    Caller callers[NCALLERS];
+    pthread_t tid[NCALLERS];
+    int n = retrieveInto (tree, words, ndocs, a, ndocs);
+    for (int c = 0; c < NCALLERS; c++) {
+        callers[c] = (Caller) { tree, words, ndocs, a, n, 0 };
+        if (pthread_create (&tid[c], NULL, callParallel, &callers[c]) != 0) {
+            errx (EX_OSERR, "couldn't start caller");
+        }
+    }
+    int callersOk = 1;
+    for (int c = 0; c < NCALLERS; c++) {
+        pthread_join (tid[c], NULL);
+        callersOk &= callers[c].ok;
+    }
+    printf("concurrent callers: %s\n", callersOk ? "ok" : "not ok");
+    ok &= callersOk;
+    printf("tparallel: %s\n", ok ? "ok" : "not ok");
+    free (words);
+    free (buf);
+    free (b);
+    free (a);
+    freeInvertedIndex (tree);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Helper: the same results, bit for bit
+static int sameArrays (TfIdfResult a[], TfIdfResult b[], int n) {
+    for (int i = 0; i < n; i++) {
+        if (a[i].filename != b[i].filename || a[i].tfidf_sum != b[i].tfidf_sum) return 0;
+    }
+    return 1;
+}
+
+// Helper: call parallelRetrieveInto over and over, checking every answer
+static void *callParallel (void *cl) {
+    Caller *c = cl;
+    TfIdfResult *out = malloc (c->ndocs * sizeof (TfIdfResult));
+    assert(out != NULL);
+    c->ok = 1;
+    for (int r = 0; r < 20; r++) {
+        int m = parallelRetrieveInto (c->tree, c->words, c->ndocs, out, c->ndocs, 4);
+        c->ok &= m == c->n && sameArrays (c->want, out, m);
+    }
+    free (out);
+    return NULL;
+}
+
+static void usage (char *prog) {
+    fprintf (
+        stderr,
+        "Usage: %s Ndocs Nreps Seed\n"
+        "2 <= Ndocs <= 10000, 1 <= Nreps, Seed = a random number other than 0\n"
+        "Checks and times parallelRetrieveInto against retrieveInto, on a\n"
+        "collection of Ndocs files made from Seed\n",
+        prog
+    );
+    exit (EXIT_FAILURE);
+}
@@ -0,0 +1,175 @@
+// tprune.c ... static pruning against the full index
+//
+// Prunes the index of a made-up collection with several sets of options
+// and checks every word against the full index: stopwords (read from a
+// file, with capitals and punctuation) and words in more than maxDf of
+// the files are gone, other words keep all their postings or, past
+// maxPostings, the ones with the highest tf, each with the tf-idf it had.
+// Options that prune nothing must leave the index as it was, and
+// usePruning must prune what generateInvertedIndex builds the same way.
+//
+// Usage: tprune Ndocs Seed
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "External.h"
+#include "Prune.h"
+#include "tcollection.h"
+
+#define NWORDS 200
+#define VOCAB 5000
+#define INDEX "data/index.txt"
+#define STOPWORDS "data/stopwords.txt"
+#define NSTOP 20
+
+typedef struct Check {
+    InvertedIndexBST pruned;
+    int D;
+    PruneOptions *opt;
+    long kept, dropped;
+} Check;
+
+static void usage (char *prog) __attribute__((noreturn));
+static int checkWords (InvertedIndexBST full, Check *c);
+static int checkPostings (FileList full, FileList pruned, int D, int max);
+static int isStopword (char **stopwords, char *word);
+static long countWords (InvertedIndexBST tree);
+
+int main (int argc, char *argv[]) {
+    if (argc != 3) usage (argv[0]);
+    int ndocs = atoi (argv[1]);
+    uint64_t seed = strtoull (argv[2], NULL, 10);
+    if (ndocs < 1 || ndocs > 10000 || seed == 0) usage (argv[0]);
+
+    char *collection = makeCollection (ndocs, NWORDS, VOCAB, seed);
+    generateInvertedIndexExternal (collection, INDEX, (size_t) 1 << 30);
+    InvertedIndexBST full = loadInvertedIndex (INDEX);
+
+    // the commonest words, written as they might be in a stopword list
+    FILE *fp = fopen (STOPWORDS, "w");
+    char word[16];
+    for (int i = 0; i < NSTOP; i++) {
+        vocabWord (i, word);
+        if (i % 3 == 0) word[0] += 'A' - 'a';
+        fprintf(fp, "%s%s%c", word, (i % 4 == 0) ? "," : "", (i % 5 == 4) ? '\n' : ' ');
+    }
+    fclose (fp);
+    char **stop = readStopwords (STOPWORDS);
+    int ok = stop != NULL && readStopwords ("data/none.txt") == NULL;
+    for (int i = 0; i < NSTOP && ok; i++) ok = strcmp(stop[i], vocabWord (i, word)) == 0;
+    ok = ok && stop[NSTOP] == NULL;
+
+    PruneOptions opts[] = {
+        { NULL, 0, 0 }, { NULL, 1, 0 }, { NULL, 1.5, 0 },
+        { stop, 0, 0 }, { NULL, 0.5, 0 }, { NULL, 0.05, 0 }, { NULL, 0, 1 },
+        { NULL, 0, 10 }, { stop, 0.3, 5 },
+    };
+    int nopts = sizeof opts / sizeof opts[0];
+    printf("%-10s %6s %8s %10s %10s\n", "stopwords", "maxDf", "maxPost", "words kept", "dropped");
+    for (int i = 0; i < nopts; i++) {
+        Check c = { pruneInvertedIndex (loadInvertedIndex (INDEX), ndocs, &opts[i]), ndocs, &opts[i], 0, 0 };
+        int same = checkWords (full, &c) && countWords (c.pruned) == c.kept;
+        // options that prune nothing leave the index exactly as it was
+        if (opts[i].stopwords == NULL && (opts[i].maxDf == 0 || opts[i].maxDf >= 1)
+                && opts[i].maxPostings == 0) {
+            same = same && c.dropped == 0 && sameIndex (full, c.pruned, 0);
+        }
+        printf("%-10s %6g %8d %10ld %10ld; %s\n", opts[i].stopwords ? "yes" : "no",
+            opts[i].maxDf, opts[i].maxPostings, c.kept, c.dropped, same ? "ok" : "not ok");
+        ok &= same;
+        freeInvertedIndex (c.pruned);
+    }
+
+    // usePruning prunes as generateInvertedIndex builds
+    int few = ndocs < 100 ? ndocs : 100;
+    char *list = makeList ("data/few.txt", 0, few);
+    InvertedIndexBST plain = generateInvertedIndex (list);
+    usePruning (&opts[nopts - 1]);
+    InvertedIndexBST built = generateInvertedIndex (list);
+    usePruning (NULL);
+    plain = pruneInvertedIndex (plain, few, &opts[nopts - 1]);
+    ok = ok && sameIndex (plain, built, 0);
+    freeInvertedIndex (plain);
+    freeInvertedIndex (built);
+
+    printf("tprune: %s\n", ok ? "ok" : "not ok");
+    freeStopwords (stop);
+    freeInvertedIndex (full);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Helper: each word of full is in c->pruned, with the right postings,
+// unless the options drop it; and c->pruned has no other words
+static int checkWords (InvertedIndexBST full, Check *c) {
+    if (full == NULL) return 1;
+    if (!checkWords (full->left, c)) return 0;
+
+    InvertedIndexBST node = findWord (c->pruned, full->word);
+    int df = docFreq (full);
+    PruneOptions *opt = c->opt;
+    int drop = isStopword (opt->stopwords, full->word)
+        || (opt->maxDf > 0 && opt->maxDf < 1 && df > opt->maxDf * c->D);
+    if (drop) {
+        c->dropped++;
+        if (node != NULL) return 0;
+    } else {
+        c->kept++;
+        if (node == NULL || !checkPostings (full->fileList, node->fileList, c->D, opt->maxPostings)) return 0;
+    }
+    return checkWords (full->right, c);
+}
+
+// Helper: pruned holds full's postings, or the max with the highest tf,
+// in filename order, with the same tf-idf
+static int checkPostings (FileList full, FileList pruned, int D, int max) {
+    int df = 0, n = 0;
+    for (FileList f = full; f != NULL; f = f->next) df++;
+    for (FileList p = pruned; p != NULL; p = p->next) n++;
+    if (max <= 0 || df <= max) return sameFiles (full, pruned, 0);
+    if (n != max) return 0;
+
+    double idfBefore = log10 ((double) D / df), idfAfter = log10 ((double) D / max);
+    double lowestKept = INFINITY, highestDropped = -INFINITY;
+    FileList p = pruned;
+    for (FileList f = full; f != NULL; f = f->next) {
+        if (p != NULL && strcmp(p->filename, f->filename) == 0) {
+            if (fabs (p->tf * idfAfter - f->tf * idfBefore) > 1e-12) return 0;
+            if (f->tf < lowestKept) lowestKept = f->tf;
+            p = p->next;
+        } else if (f->tf > highestDropped) {
+            highestDropped = f->tf;
+        }
+    }
+    return p == NULL && lowestKept >= highestDropped;
+}
+
+static int isStopword (char **stopwords, char *word) {
+    for (int i = 0; stopwords != NULL && stopwords[i] != NULL; i++) {
+        if (strcmp(stopwords[i], word) == 0) return 1;
+    }
+    return 0;
+}
+
+static long countWords (InvertedIndexBST tree) {
+    if (tree == NULL) return 0;
+    return countWords (tree->left) + 1 + countWords (tree->right);
+}
+
+static void usage (char *prog) {
+    fprintf (
+        stderr,
+        "Usage: %s Ndocs Seed\n"
+        "1 <= Ndocs <= 10000, Seed = a random number other than 0\n"
+        "Checks pruneInvertedIndex against the full index, on a collection\n"
+        "of Ndocs files made from Seed\n",
+        prog
+    );
+    exit (EXIT_FAILURE);
+}
@@ -0,0 +1,127 @@
+// tquery.c ... the allocation-free queries against the list versions
+//
+// For random one- to four-word queries over a made-up collection (common
+// words, rare words and words not in it), calculateTfIdfInto and
+// retrieveInto must give exactly the lists calculateTfIdf and retrieve
+// give: all of them with room for every result, the first max with less
+// room, and a size to try again with when retrieveInto runs out of room.
+// Then times both versions of retrieve.
+//
+// Usage: tquery Nqueries Seed
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "External.h"
+#include "Query.h"
+#include "tcollection.h"
+
+#define NDOCS 1000
+#define NWORDS 200
+#define VOCAB 20000
+#define INDEX "data/index.txt"
+
+static void usage (char *prog) __attribute__((noreturn));
+static int startsWith (TfIdfList list, TfIdfResult out[], int n);
+static int listLength (TfIdfList list);
+
+int main (int argc, char *argv[]) {
+    if (argc != 3) usage (argv[0]);
+    int nq = atoi (argv[1]);
+    uint64_t seed = strtoull (argv[2], NULL, 10);
+    if (nq < 1 || nq > 1000000 || seed == 0) usage (argv[0]);
+
+    char *collection = makeCollection (NDOCS, NWORDS, VOCAB, seed);
+    generateInvertedIndexExternal (collection, INDEX, (size_t) 1 << 30);
+    InvertedIndexBST tree = loadInvertedIndex (INDEX);
+    TfIdfResult *out = malloc (NDOCS * sizeof (TfIdfResult));
+    assert(out != NULL);
+
+    int ok = 1;
+    char buf[4][16];
+    char *words[5];
+    for (int q = 0; q < nq && ok; q++) {
+        makeQuery (buf, words, VOCAB, VOCAB + q, &seed);
+        int small = nextRandom (&seed) % 8;
+
+        TfIdfList list = calculateTfIdf (tree, words[0], NDOCS);
+        int len = listLength (list);
+        int n = calculateTfIdfInto (tree, words[0], NDOCS, out, NDOCS);
+        ok = n == len && sameResults (list, out, n, 0);
+        n = calculateTfIdfInto (tree, words[0], NDOCS, out, small);
+        ok = ok && n == len && startsWith (list, out, small < n ? small : n);
+        freeTfIdfList (list);
+
+        list = retrieve (tree, words, NDOCS);
+        len = listLength (list);
+        n = retrieveInto (tree, words, NDOCS, out, NDOCS);
+        ok = ok && n == len && sameResults (list, out, n, 0);
+        n = retrieveInto (tree, words, NDOCS, out, small);
+        if (n > small) {
+            // out of room: the size returned must be enough
+            TfIdfResult *again = malloc (n * sizeof (TfIdfResult));
+            assert(again != NULL);
+            ok = ok && n >= len;
+            n = retrieveInto (tree, words, NDOCS, again, n);
+            ok = ok && n == len && sameResults (list, again, n, 0);
+            free (again);
+        } else {
+            ok = ok && n == len && sameResults (list, out, n, 0);
+        }
+        freeTfIdfList (list);
+    }
+
+    // the same queries again, timed
+    uint64_t s = strtoull (argv[2], NULL, 10);
+    struct timespec t;
+    double listTime = 0, intoTime = 0;
+    long results = 0;
+    for (int q = 0; q < nq; q++) {
+        makeQuery (buf, words, VOCAB, VOCAB + q, &s);
+        since (&t);
+        TfIdfList list = retrieve (tree, words, NDOCS);
+        freeTfIdfList (list);
+        listTime += since (&t);
+        results += retrieveInto (tree, words, NDOCS, out, NDOCS);
+        intoTime += since (&t);
+    }
+    printf("%d queries, %.1f results each: retrieve %.1f us, retrieveInto %.1f us\n",
+        nq, (double) results / nq, listTime / nq * 1e6, intoTime / nq * 1e6);
+    printf("tquery: %s\n", ok ? "ok" : "not ok");
+    free (out);
+    freeInvertedIndex (tree);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Helper: out[0..n) are the first n results of list
+static int startsWith (TfIdfList list, TfIdfResult out[], int n) {
+    for (int i = 0; i < n; i++, list = list->next) {
+        if (list == NULL || strcmp(list->filename, out[i].filename) != 0
+                || list->tfidf_sum != out[i].tfidf_sum) return 0;
+    }
+    return 1;
+}
+
+static int listLength (TfIdfList list) {
+    int n = 0;
+    for (; list != NULL; list = list->next) n++;
+    return n;
+}
+
+static void usage (char *prog) {
+    fprintf (
+        stderr,
+        "Usage: %s Nqueries Seed\n"
+        "1 <= Nqueries <= 1000000, Seed = a random number other than 0\n"
+        "Checks calculateTfIdfInto and retrieveInto against calculateTfIdf\n"
+        "and retrieve, on a collection made from Seed\n",
+        prog
+    );
+    exit (EXIT_FAILURE);
+}
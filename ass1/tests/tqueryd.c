@@ -0,0 +1,296 @@
+// tqueryd.c ... the query server against the library
+//
+// Starts ../queryd/queryd on an index of a made-up collection, then has
+// several connections at once each send a long pipeline of requests
+// (tfidf, retrieve, unknown commands and empty lines) without waiting
+// for replies.  Every reply must be, byte for byte, what the request
+// gives when run here through calculateTfIdfInto or retrieveInto, and in
+// request order.  Then checks stats, over-long requests and quit, and
+// that the server exits cleanly on SIGTERM.  The server's own output is
+// in data/queryd.log.
+//
+// Usage: tqueryd Nrequests Nconnections Seed
+
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <err.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "External.h"
+#include "Query.h"
+#include "tcollection.h"
+
+#define QUERYD "../queryd/queryd"
+#define SOCKET "data/queryd.sock"
+#define INDEX "data/index.txt"
+#define NDOCS 500
+#define NWORDS 200
+#define VOCAB 10000
+#define MAXCONN 64
+#define USAGE "ERR usage: tfidf WORD | retrieve WORD... | stats | quit\n"
+
+typedef struct Pipeline {
+    int fd;
+    int n;
+    char **requests;    // each ending in '\n'
+    char **replies;     // what each should get back
+    int ok;
+} Pipeline;
+
+static void usage (char *prog) __attribute__((noreturn));
+static void makeRequest (uint64_t *s, InvertedIndexBST tree, char **request, char **reply);
+static char *formatReply (TfIdfResult out[], int n);
+static int connectTo (char *path);
+static void *sendRequests (void *arg);
+static void *runPipeline (void *arg);
+static char *readReply (FILE *in);
+
+static TfIdfResult results[NDOCS * 4];
+
+int main (int argc, char *argv[]) {
+    if (argc != 4) usage (argv[0]);
+    int nreq = atoi (argv[1]);
+    int nconn = atoi (argv[2]);
+    uint64_t seed = strtoull (argv[3], NULL, 10);
+    if (nreq < 1 || nreq > 1000000 || nconn < 1 || nconn > MAXCONN || seed == 0) usage (argv[0]);
+
+    char *collection = makeCollection (NDOCS, NWORDS, VOCAB, seed);
+    generateInvertedIndexExternal (collection, INDEX, (size_t) 1 << 30);
+    InvertedIndexBST tree = loadInvertedIndex (INDEX);
+
+    pid_t pid = fork ();
+    if (pid < 0) err (EX_OSERR, "fork");
+    if (pid == 0) {
+        // its latency report on exit goes to the log, not in among ours
+        freopen ("data/queryd.log", "w", stderr);
+        execl (QUERYD, QUERYD, SOCKET, "-i", INDEX, "-w", "4", (char *) NULL);
+        err (EX_OSERR, "%s", QUERYD);
+    }
+
+    Pipeline pipes[MAXCONN];
+    pthread_t threads[MAXCONN];
+    for (int c = 0; c < nconn; c++) {
+        Pipeline *p = &pipes[c];
+        p->fd = connectTo (SOCKET);
+        p->n = nreq;
+        p->requests = malloc (nreq * sizeof (char *));
+        p->replies = malloc (nreq * sizeof (char *));
+        assert(p->requests != NULL && p->replies != NULL);
+        for (int i = 0; i < nreq; i++) makeRequest (&seed, tree, &p->requests[i], &p->replies[i]);
+    }
+    struct timespec t;
+    since (&t);
+    for (int c = 0; c < nconn; c++) {
+        if (pthread_create (&threads[c], NULL, runPipeline, &pipes[c]) != 0) {
+            errx (EX_OSERR, "couldn't start connection");
+        }
+    }
+    int ok = 1;
+    for (int c = 0; c < nconn; c++) {
+        pthread_join (threads[c], NULL);
+        ok &= pipes[c].ok;
+    }
+    double secs = since (&t);
+    printf("%d connections x %d pipelined requests: %.0f requests/s; %s\n",
+        nconn, nreq, nconn * nreq / secs, ok ? "ok" : "not ok");
+
+    // one more connection, for stats, over-long requests and quit
+    int fd = connectTo (SOCKET);
+    FILE *in = fdopen (fd, "r");
+    assert(in != NULL);
+    char *reply = NULL;
+    write (fd, "stats\n", 6);
+    reply = readReply (in);
+    int statsOk = reply != NULL && strstr (reply, "\nrequests ") != NULL;
+    free (reply);
+
+    // an over-long line, too many words and an over-long word each get
+    // exactly one error; after that the connection works as before
+    char word[16], request[32];
+    snprintf (request, sizeof request, "tfidf %s\n", vocabWord (0, word));
+    char *want = formatReply (results, calculateTfIdfInto (tree, word, NDOCS, results, NDOCS));
+    size_t longlen = 10000;
+    char *line = malloc (longlen + 1);
+    assert(line != NULL);
+    memset (line, 'x', longlen);
+    memcpy (line, "retrieve ", 9);
+    line[longlen - 1] = '\n';
+    line[longlen] = '\0';
+    write (fd, line, longlen);
+    // 300 one-letter words
+    for (int i = 9; i < 9 + 600; i += 2) line[i] = ' ';
+    line[9 + 600] = '\n';
+    write (fd, line, 9 + 600 + 1);
+    // one 150-letter word
+    memset (line, 'x', longlen);
+    memcpy (line, "tfidf ", 6);
+    line[6 + 150] = '\n';
+    write (fd, line, 6 + 150 + 1);
+    write (fd, request, strlen (request));
+    char *wantErr[] = { "ERR line too long\n", "ERR too many words\n", "ERR word too long\n", want };
+    int longOk = 1;
+    for (int i = 0; i < 4; i++) {
+        reply = readReply (in);
+        longOk &= reply != NULL && strcmp (reply, wantErr[i]) == 0;
+        free (reply);
+    }
+    free (want);
+    free (line);
+
+    write (fd, "quit\n", 5);
+    int quitOk = (reply = readReply (in)) == NULL;
+    free (reply);
+    fclose (in);
+    printf("stats %s, over-long requests %s, quit %s\n", statsOk ? "ok" : "not ok",
+        longOk ? "ok" : "not ok", quitOk ? "ok" : "not ok");
+
+    int status;
+    kill (pid, SIGTERM);
+    waitpid (pid, &status, 0);
+    int exitOk = WIFEXITED (status) && WEXITSTATUS (status) == 0 && access (SOCKET, F_OK) != 0;
+    ok = ok && statsOk && longOk && quitOk && exitOk;
+    printf("tqueryd: %s\n", ok ? "ok" : "not ok");
+
+    for (int c = 0; c < nconn; c++) {
+        for (int i = 0; i < nreq; i++) {
+            free (pipes[c].requests[i]);
+            free (pipes[c].replies[i]);
+        }
+        free (pipes[c].requests);
+        free (pipes[c].replies);
+    }
+    freeInvertedIndex (tree);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Helper: a random request, and the reply it should get
+static void makeRequest (uint64_t *s, InvertedIndexBST tree, char **request, char **reply) {
+    char req[256];
+    char words[4][16];
+    char *search[5];
+    int kind = nextRandom (s) % 16;
+    int nw = (kind < 6) ? 1 : 1 + nextRandom (s) % 4;
+    int len = snprintf (req, sizeof req, "%s", (kind < 6) ? "tfidf" : "retrieve");
+    for (int i = 0; i < nw; i++) {
+        search[i] = vocabWord (pickWord (s, VOCAB), words[i]);
+        len += snprintf (req + len, sizeof req - len, " %s", search[i]);
+    }
+    search[nw] = NULL;
+
+    if (kind == 14) {
+        *request = strdup ("frob\n");
+        *reply = strdup (USAGE);
+    } else if (kind == 15) {
+        *request = strdup ("\n");
+        *reply = strdup ("ERR empty request\n");
+    } else {
+        int n = (kind < 6)
+            ? calculateTfIdfInto (tree, search[0], NDOCS, results, NDOCS * 4)
+            : retrieveInto (tree, search, NDOCS, results, NDOCS * 4);
+        snprintf (req + len, sizeof req - len, "\n");
+        // a capital letter, which the server normalises away
+        if (nextRandom (s) % 4 == 0) req[len - 1] += 'A' - 'a';
+        *request = strdup (req);
+        *reply = formatReply (results, n);
+    }
+    assert(*request != NULL && *reply != NULL);
+}
+
+// Helper: the reply queryd sends for n results
+static char *formatReply (TfIdfResult out[], int n) {
+    size_t cap = 64 + n * 128;
+    char *reply = malloc (cap);
+    assert(reply != NULL);
+    size_t len = snprintf (reply, cap, "OK %d\n", n);
+    for (int i = 0; i < n; i++) {
+        len += snprintf (reply + len, cap - len, "%.6f %s\n", out[i].tfidf_sum, out[i].filename);
+    }
+    return reply;
+}
+
+// Helper: connect to the server, waiting up to 10 seconds for it to start
+static int connectTo (char *path) {
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    strcpy (addr.sun_path, path);
+    for (int tries = 0; tries < 1000; tries++) {
+        int fd = socket (AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0) err (EX_OSERR, "socket");
+        if (connect (fd, (struct sockaddr *) &addr, sizeof addr) == 0) return fd;
+        close (fd);
+        usleep (10000);
+    }
+    errx (EX_UNAVAILABLE, "couldn't connect to %s", path);
+}
+
+// Helper: write every request of a pipeline without waiting for replies
+static void *sendRequests (void *arg) {
+    Pipeline *p = arg;
+    for (int i = 0; i < p->n; i++) {
+        size_t len = strlen (p->requests[i]);
+        if (write (p->fd, p->requests[i], len) != (ssize_t) len) break;
+    }
+    return NULL;
+}
+
+// Helper: send a pipeline from another thread while reading the replies here
+static void *runPipeline (void *arg) {
+    Pipeline *p = arg;
+    pthread_t sender;
+    if (pthread_create (&sender, NULL, sendRequests, p) != 0) {
+        errx (EX_OSERR, "couldn't start sender");
+    }
+    FILE *in = fdopen (p->fd, "r");
+    assert(in != NULL);
+    p->ok = 1;
+    for (int i = 0; i < p->n && p->ok; i++) {
+        char *reply = readReply (in);
+        p->ok = reply != NULL && strcmp (reply, p->replies[i]) == 0;
+        if (!p->ok) fprintf(stderr, "request %d: %sgot: %.200s\n", i, p->requests[i], reply);
+        free (reply);
+    }
+    pthread_join (sender, NULL);
+    fclose (in);
+    return NULL;
+}
+
+// Helper: one whole reply ("OK n" and n lines, or one "ERR" line), or NULL at EOF
+static char *readReply (FILE *in) {
+    char *reply = NULL, *line = NULL;
+    size_t len = 0, linecap = 0;
+    ssize_t got;
+    int lines = 1;
+    for (int i = 0; i < lines && (got = getline (&line, &linecap, in)) > 0; i++) {
+        if (i == 0 && strncmp (line, "OK ", 3) == 0) lines += atoi (line + 3);
+        reply = realloc (reply, len + got + 1);
+        assert(reply != NULL);
+        memcpy (reply + len, line, got + 1);
+        len += got;
+    }
+    free (line);
+    return reply;
+}
+
+static void usage (char *prog) {
+    fprintf (
+        stderr,
+        "Usage: %s Nrequests Nconnections Seed\n"
+        "1 <= Nrequests <= 1000000, 1 <= Nconnections <= %d,\n"
+        "Seed = a random number other than 0\n"
+        "Checks " QUERYD " (make it first) against the library, on a\n"
+        "collection made from Seed\n",
+        prog, MAXCONN
+    );
+    exit (EXIT_FAILURE);
+}
@@ -0,0 +1,117 @@
+// tshard.c ... the sharded index against the single tree
+//
+// Splits the index of a made-up collection into 1, 2, 4 and 8 shards.
+// Every word must be in the shard shardFor names, with the same postings,
+// and for random queries shardedRetrieveInto and shardedRetrieve must
+// give what retrieve gives (the sums to within 1e-12, as they are added
+// shard by shard).  generateShardedIndex must split the same index.
+// Times retrieveInto against shardedRetrieveInto for each shard count.
+//
+// Usage: tshard Nqueries Seed
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "External.h"
+#include "Query.h"
+#include "Shard.h"
+#include "tcollection.h"
+
+#define NDOCS 200
+#define NWORDS 200
+#define VOCAB 10000
+#define INDEX "data/index.txt"
+
+static void usage (char *prog) __attribute__((noreturn));
+static int sameShards (ShardedIndex si, InvertedIndexBST tree);
+static int testQueries (ShardedIndex si, InvertedIndexBST tree, int nq, uint64_t seed);
+
+int main (int argc, char *argv[]) {
+    if (argc != 3) usage (argv[0]);
+    int nq = atoi (argv[1]);
+    uint64_t seed = strtoull (argv[2], NULL, 10);
+    if (nq < 1 || nq > 1000000 || seed == 0) usage (argv[0]);
+
+    char *collection = makeCollection (NDOCS, NWORDS, VOCAB, seed);
+    generateInvertedIndexExternal (collection, INDEX, (size_t) 1 << 30);
+    InvertedIndexBST tree = loadInvertedIndex (INDEX);
+
+    int ok = 1;
+    printf("%-7s %14s %22s\n", "shards", "retrieveInto", "shardedRetrieveInto");
+    for (int nshards = 1; nshards <= 8; nshards *= 2) {
+        ShardedIndex si = newShardedIndex (loadInvertedIndex (INDEX), nshards);
+        ok &= shardCount (si) == nshards && sameShards (si, tree);
+        ok &= testQueries (si, tree, nq, seed);
+        dropShardedIndex (si);
+    }
+
+    ShardedIndex si = generateShardedIndex (collection, 4);
+    InvertedIndexBST built = generateInvertedIndex (collection);
+    ok &= sameIndex (built, tree, 1e-12) && sameShards (si, tree);
+    dropShardedIndex (si);
+    freeInvertedIndex (built);
+
+    printf("tshard: %s\n", ok ? "ok" : "not ok");
+    freeInvertedIndex (tree);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Helper: every word of tree is in the shard shardFor names, with the
+// same postings
+static int sameShards (ShardedIndex si, InvertedIndexBST tree) {
+    if (tree == NULL) return 1;
+    InvertedIndexBST node = findWord (shardFor (si, tree->word), tree->word);
+    return node != NULL && sameFiles (node->fileList, tree->fileList, 0)
+        && sameShards (si, tree->left) && sameShards (si, tree->right);
+}
+
+// Helper: queries give what retrieve gives; prints the time each takes
+static int testQueries (ShardedIndex si, InvertedIndexBST tree, int nq, uint64_t seed) {
+    TfIdfResult *out = malloc (NDOCS * sizeof (TfIdfResult));
+    assert(out != NULL);
+    char buf[4][16];
+    char *words[5];
+    int ok = 1;
+    for (int q = 0; q < nq && ok; q++) {
+        makeQuery (buf, words, VOCAB, VOCAB + q, &seed);
+        TfIdfList want = retrieve (tree, words, NDOCS);
+        TfIdfList got = shardedRetrieve (si, words, NDOCS);
+        int n = shardedRetrieveInto (si, words, NDOCS, out, NDOCS);
+        ok = sameLists (got, want, 1e-12) && sameResults (want, out, n, 1e-12);
+        freeTfIdfList (want);
+        freeTfIdfList (got);
+    }
+
+    // the same queries again, timed
+    uint64_t s = seed;
+    struct timespec t;
+    double plain = 0, sharded = 0;
+    for (int q = 0; q < nq; q++) {
+        makeQuery (buf, words, VOCAB, VOCAB + q, &s);
+        since (&t);
+        retrieveInto (tree, words, NDOCS, out, NDOCS);
+        plain += since (&t);
+        shardedRetrieveInto (si, words, NDOCS, out, NDOCS);
+        sharded += since (&t);
+    }
+    printf("%-7d %11.1f us %19.1f us\n", shardCount (si), plain / nq * 1e6, sharded / nq * 1e6);
+    free (out);
+    return ok;
+}
+
+static void usage (char *prog) {
+    fprintf (
+        stderr,
+        "Usage: %s Nqueries Seed\n"
+        "1 <= Nqueries <= 1000000, Seed = a random number other than 0\n"
+        "Checks sharded indexes against the single tree, on a collection\n"
+        "made from Seed\n",
+        prog
+    );
+    exit (EXIT_FAILURE);
+}
@@ -0,0 +1,270 @@
+// tsnapshot.c ... versioned snapshots against rebuilding the index
+//
+// Each round indexes half of a small made-up collection, versions it and
+// adds the other half a file at a time, then rewrites two files and adds
+// them again.  Every version must equal the index built from scratch
+// from the files as they were when it was published (a re-added file
+// keeps D the same), however long a reader held it.  Then readers query
+// a larger collection while a writer adds to it, each checking that its
+// pinned version does not change under it, and their latency is timed.
+// Last, files of thousands of new words, and files whose new words all
+// sort after every word so far, must leave the tree no deeper than a
+// scapegoat tree's bound.
+//
+// Usage: tsnapshot Nrounds Nreaders Seed
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "invertedIndex.h"
+#include "Tree.h"
+#include "External.h"
+#include "Query.h"
+#include "Snapshot.h"
+#include "tcollection.h"
+
+#define MAXREADERS 16
+#define INDEX "data/index.txt"
+#define LIST "data/list.txt"
+#define BIGDOCS 400
+#define BIGWORDS 200
+#define BIGVOCAB 10000
+#define NEWWORDS 3000
+#define NAPPENDS 40
+
+typedef struct Reader {
+    SnapshotStore store;
+    uint64_t seed;
+    long queries;
+    double secs[2];     // time spent querying before and during the updates
+    long counts[2];
+    int ok;
+} Reader;
+
+static void usage (char *prog) __attribute__((noreturn));
+static int testRound (uint64_t *s);
+static InvertedIndexBST indexOf (int from, int to);
+static int sameAsBuilt (Snapshot snap, int from, int to);
+static int testReaders (int nreaders, uint64_t seed);
+static void *reader (void *arg);
+static int testDepth (uint64_t *s);
+static int shallowEnough (Snapshot snap);
+static long countWords (InvertedIndexBST t);
+
+static atomic_int updating, stopping;
+
+int main (int argc, char *argv[]) {
+    if (argc != 4) usage (argv[0]);
+    int nrounds = atoi (argv[1]);
+    int nreaders = atoi (argv[2]);
+    uint64_t seed = strtoull (argv[3], NULL, 10);
+    if (nrounds < 1 || nreaders < 1 || nreaders > MAXREADERS || seed == 0) usage (argv[0]);
+
+    int bad = 0;
+    for (int r = 0; r < nrounds; r++) bad += !testRound (&seed);
+    printf("%d rounds of adding and re-adding files: %d bad\n", nrounds, bad);
+    int ok = (bad == 0) & testReaders (nreaders, seed);
+    ok &= testDepth (&seed);
+    printf("tsnapshot: %s\n", ok ? "ok" : "not ok");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Helper: one round on eight files of a few words from a small vocabulary,
+// so re-added files often lose words and gain others
+static int testRound (uint64_t *s) {
+    for (int d = 0; d < 8; d++) makeDocument (d, 20, 40, s);
+    SnapshotStore store = newSnapshotStore (indexOf (0, 4), 4);
+    for (int d = 4; d < 8; d++) {
+        char name[32];
+        snapshotAddFile (store, docName (d, name));
+    }
+    Snapshot before = snapshotAcquire (store);
+    int ok = snapshotDocs (before) == 8 && sameAsBuilt (before, 0, 8);
+    InvertedIndexBST old = indexOf (0, 8);
+
+    char name[32];
+    makeDocument (1, 20, 40, s);
+    makeDocument (6, 20, 40, s);
+    snapshotAddFile (store, docName (6, name));
+    Snapshot mid = snapshotAcquire (store);
+    snapshotAddFile (store, docName (1, name));
+    ok = ok && snapshotAddFile (store, "data/none.txt") == 0;
+    Snapshot after = snapshotAcquire (store);
+    ok = ok && snapshotDocs (mid) == 8 && snapshotDocs (after) == 8
+        && sameAsBuilt (after, 0, 8);
+    snapshotRelease (store, mid);
+
+    // the first version must not have changed under its reader
+    ok = ok && sameIndex (snapshotTree (before), old, 1e-12);
+    snapshotRelease (store, before);
+    snapshotRelease (store, after);
+    freeInvertedIndex (old);
+    dropSnapshotStore (store);
+    return ok;
+}
+
+// Helper: the index of files from to to - 1, built from scratch
+static InvertedIndexBST indexOf (int from, int to) {
+    generateInvertedIndexExternal (makeList (LIST, from, to), INDEX, (size_t) 1 << 30);
+    return loadInvertedIndex (INDEX);
+}
+
+// Helper: snap has the index of files from to to - 1
+static int sameAsBuilt (Snapshot snap, int from, int to) {
+    InvertedIndexBST want = indexOf (from, to);
+    int same = sameIndex (snapshotTree (snap), want, 1e-12);
+    freeInvertedIndex (want);
+    return same;
+}
+
+// Helper: readers query while half of a collection is added to the other half
+static int testReaders (int nreaders, uint64_t seed) {
+    uint64_t s = seed;
+    for (int d = 0; d < BIGDOCS; d++) makeDocument (d, BIGWORDS, BIGVOCAB, &s);
+    SnapshotStore store = newSnapshotStore (indexOf (0, BIGDOCS / 2), BIGDOCS / 2);
+
+    Reader readers[MAXREADERS];
+    pthread_t threads[MAXREADERS];
+    updating = stopping = 0;
+    for (int i = 0; i < nreaders; i++) {
+        readers[i] = (Reader) { .store = store, .seed = seed + i + 1, .ok = 1 };
+        pthread_create (&threads[i], NULL, reader, &readers[i]);
+    }
+    struct timespec idle = { 0, 200000000 }, t;
+    nanosleep (&idle, NULL);
+    updating = 1;
+    since (&t);
+    for (int d = BIGDOCS / 2; d < BIGDOCS; d++) {
+        char name[32];
+        snapshotAddFile (store, docName (d, name));
+    }
+    double adding = since (&t);
+    stopping = 1;
+
+    int ok = 1;
+    double secs[2] = { 0 };
+    long counts[2] = { 0 };
+    for (int i = 0; i < nreaders; i++) {
+        pthread_join (threads[i], NULL);
+        ok &= readers[i].ok;
+        for (int p = 0; p < 2; p++) {
+            secs[p] += readers[i].secs[p];
+            counts[p] += readers[i].counts[p];
+        }
+    }
+    Snapshot snap = snapshotAcquire (store);
+    ok = ok && snapshotDocs (snap) == BIGDOCS && sameAsBuilt (snap, 0, BIGDOCS);
+    snapshotRelease (store, snap);
+    dropSnapshotStore (store);
+
+    printf("%d files added in %.3fs; %d readers: %.1f us/query before, %.1f us during\n",
+        BIGDOCS / 2, adding, nreaders, secs[0] / (counts[0] ? counts[0] : 1) * 1e6,
+        secs[1] / (counts[1] ? counts[1] : 1) * 1e6);
+    printf("concurrent readers: %s\n", ok ? "ok" : "not ok");
+    return ok;
+}
+
+// Helper: add a file of NEWWORDS new words, then NAPPENDS files of 100
+// words that sort after all the others, checking the depth after each
+static int testDepth (uint64_t *s) {
+    makeDocument (0, 200, 1000, s);
+    SnapshotStore store = newSnapshotStore (indexOf (0, 1), 1);
+    char name[32], word[16];
+    FILE *fp = fopen (docName (1, name), "w");
+    assert(fp != NULL);
+    for (int i = 0; i < NEWWORDS; i++) fprintf(fp, "%s\n", vocabWord (100000 + i, word));
+    fclose (fp);
+    snapshotAddFile (store, name);
+    Snapshot snap = snapshotAcquire (store);
+    int ok = shallowEnough (snap);
+    printf("%d new words: depth %d for %ld words\n", NEWWORDS, depth (snapshotTree (snap)),
+        countWords (snapshotTree (snap)));
+    snapshotRelease (store, snap);
+
+    for (int d = 2; d < NAPPENDS + 2; d++) {
+        fp = fopen (docName (d, name), "w");
+        assert(fp != NULL);
+        for (int i = 0; i < 100; i++) fprintf(fp, "zzzz%05d\n", d * 100 + i);
+        fclose (fp);
+        snapshotAddFile (store, name);
+        snap = snapshotAcquire (store);
+        ok = ok && shallowEnough (snap);
+        snapshotRelease (store, snap);
+    }
+    snap = snapshotAcquire (store);
+    printf("%d files of words at the end: depth %d for %ld words\n", NAPPENDS,
+        depth (snapshotTree (snap)), countWords (snapshotTree (snap)));
+    ok = ok && sameAsBuilt (snap, 0, NAPPENDS + 2);
+    snapshotRelease (store, snap);
+    dropSnapshotStore (store);
+    printf("depth: %s\n", ok ? "ok" : "not ok");
+    return ok;
+}
+
+// Helper: snap's tree is no deeper than log3/2 of its number of words, plus 1
+static int shallowEnough (Snapshot snap) {
+    long n = countWords (snapshotTree (snap));
+    return depth (snapshotTree (snap)) <= log (n) / log (1.5) + 1;
+}
+
+static long countWords (InvertedIndexBST t) {
+    if (t == NULL) return 0;
+    return 1 + countWords (t->left) + countWords (t->right);
+}
+
+// Helper: query pinned versions until told to stop; the same query twice
+// on one version must give the same results
+static void *reader (void *arg) {
+    Reader *r = arg;
+    TfIdfResult *a = malloc (BIGDOCS * sizeof (TfIdfResult));
+    TfIdfResult *b = malloc (BIGDOCS * sizeof (TfIdfResult));
+    assert(a != NULL && b != NULL);
+    char buf[3][16];
+    int lastDocs = 0;
+    struct timespec t;
+    while (!stopping) {
+        int phase = updating;
+        char *words[] = {
+            vocabWord (pickWord (&r->seed, BIGVOCAB), buf[0]),
+            vocabWord (pickWord (&r->seed, BIGVOCAB), buf[1]),
+            vocabWord (pickWord (&r->seed, BIGVOCAB), buf[2]), NULL
+        };
+        since (&t);
+        Snapshot snap = snapshotAcquire (r->store);
+        int D = snapshotDocs (snap);
+        int n = retrieveInto (snapshotTree (snap), words, D, a, BIGDOCS);
+        int m = retrieveInto (snapshotTree (snap), words, D, b, BIGDOCS);
+        snapshotRelease (r->store, snap);
+        r->secs[phase] += since (&t);
+        r->counts[phase]++;
+
+        int same = n == m && n <= D && D >= lastDocs;
+        for (int i = 0; i < n && same; i++) {
+            same = a[i].filename == b[i].filename && a[i].tfidf_sum == b[i].tfidf_sum;
+        }
+        if (!same) r->ok = 0;
+        lastDocs = D;
+    }
+    free (a);
+    free (b);
+    return NULL;
+}
+
+static void usage (char *prog) {
+    fprintf (
+        stderr,
+        "Usage: %s Nrounds Nreaders Seed\n"
+        "1 <= Nrounds, 1 <= Nreaders <= %d, Seed = a random number other than 0\n"
+        "Checks snapshot versions against indexes built from scratch, and\n"
+        "readers against a writer, on collections made from Seed\n",
+        prog, MAXREADERS
+    );
+    exit (EXIT_FAILURE);
+}
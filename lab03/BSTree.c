@@ -197,11 +197,11 @@ static BSTree deleteRoot (BSTree t)
 		succ = succ->left;
 	}
 	t->value = succ->value;
-	free (succ);
 	if (parent == t)
 		parent->right = succ->right;
 	else
 		parent->left = succ->right;
+	free (succ);
 	return t;
 }
 
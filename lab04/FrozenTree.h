@@ -0,0 +1,31 @@
+// FrozenTree.h ... a read-only copy of a Tree, laid out for searching
+//
+// A Tree that will not change again can be frozen into an array in
+// Eytzinger (breadth-first) order: the root at 1, and the children of
+// the item at k at 2k and 2k+1.  A search then follows no pointers, the
+// top levels share a few cache lines, and the next levels can be
+// prefetched before they are needed.  Many threads can search a
+// FrozenTree at once.
+
+#ifndef FROZENTREE_H
+#define FROZENTREE_H
+
+#include "Tree.h"
+
+typedef struct FrozenTreeRep *FrozenTree;
+
+// make a FrozenTree of the items in a Tree, in O(n); the Tree is not
+// changed, and can be dropped if it is no longer needed
+FrozenTree TreeFreeze (Tree);
+// free memory associated with FrozenTree
+void dropFrozenTree (FrozenTree);
+
+// check whether a value is in a FrozenTree
+int FrozenFind (FrozenTree, Key);
+// check whether each of n values is in a FrozenTree, into found[0..n-1];
+// the searches are interleaved, so their cache misses overlap
+void FrozenFindMany (FrozenTree, const Key *, int n, int *found);
+// count #items in FrozenTree
+int FrozenNumNodes (FrozenTree);
+
+#endif
@@ -0,0 +1,294 @@
+// GTree.h ... a Tree ADT written out for any type of item
+//
+// Tree.h fixes its items to ints.  Including this file instead writes
+// out an AVL tree for the item type given by the macros below, with the
+// comparison inlined, rather than called through a pointer to a
+// function taking void *.  It can be included any number of times in
+// one file, for different names; each inclusion undefines the macros.
+//
+//	#define GTREE_NAME StrTree
+//	#define GTREE_ITEM char *
+//	#define GTREE_CMP(k1, k2) strcmp ((k1), (k2))
+//	#include "GTree.h"
+//
+// GTREE_NAME         names the tree type, and prefixes its functions
+// GTREE_ITEM         the type of the items
+// GTREE_KEY          the type items are looked up by (default GTREE_ITEM)
+// GTREE_KEYOF(it)    the key of an item (default it)
+// GTREE_CMP(k1, k2)  < 0, 0 or > 0, as k1 is less, equal or greater;
+//                    the default uses < and >, so it cannot overflow
+// GTREE_COPY(it)     what to store when an item is new (default it)
+// GTREE_FREE(it)     release a stored item (default nothing)
+//
+// For GTREE_NAME T, the functions written are
+//
+//	T newT (void)           create an empty T
+//	T newPooledT (void)     ... whose nodes come from a Pool (Pool.h)
+//	void dropT (T)          free memory associated with T, and its items
+//	int TInsert (T, Item)   insert an item; 0 if its key was already there
+//	int TDelete (T, Key)    delete an item; 0 if it wasn't there
+//	Item *TFind (T, Key)    the stored item with a key, or NULL
+//	int TNumNodes (T)       count #items in T
+//	void TWalk (T, void (*visit) (Item *, void *), void *)
+//	                        call a function on each item, in key order
+//
+// They are all static, so each file that includes this gets its own;
+// helpers have the same prefix, and end in _.
+
+#ifndef GTREE_H
+#define GTREE_H
+
+#include <err.h>
+#include <stdlib.h>
+#include <sysexits.h>
+
+#include "Pool.h"
+
+#define GTREE_CAT_(a, b) a##b
+#define GTREE_CAT(a, b) GTREE_CAT_ (a, b)
+
+#endif
+
+#if ! defined (GTREE_NAME) || ! defined (GTREE_ITEM)
+#error "GTREE_NAME and GTREE_ITEM must be defined before including GTree.h"
+#endif
+#ifndef GTREE_KEY
+#define GTREE_KEY GTREE_ITEM
+#endif
+#ifndef GTREE_KEYOF
+#define GTREE_KEYOF(it) (it)
+#endif
+#ifndef GTREE_CMP
+#define GTREE_CMP(k1, k2) (((k1) > (k2)) - ((k1) < (k2)))
+#endif
+#ifndef GTREE_COPY
+#define GTREE_COPY(it) (it)
+#endif
+#ifndef GTREE_FREE
+#define GTREE_FREE(it) ((void) 0)
+#define GTREE_NOFREE
+#endif
+
+// names in this instance
+#define GT(x) GTREE_CAT (GTREE_NAME, x)
+#define GTLink GT (Link)
+
+typedef struct GT (Node) *GTLink;
+
+typedef struct GT (Node) {
+	GTREE_ITEM value;
+	GTLink left, right;
+	int height;
+} GT (Node);
+
+typedef struct GT (Rep) {
+	GTLink root;
+	int nitems;
+	Pool pool; // where nodes come from, if not malloc
+} GT (Rep);
+
+typedef GT (Rep) *GTREE_NAME;
+
+static inline int GT (Height_) (GTLink t)
+{
+	return t == NULL ? 0 : t->height;
+}
+
+static inline void GT (Fix_) (GTLink t)
+{
+	int hl = GT (Height_) (t->left), hr = GT (Height_) (t->right);
+	t->height = 1 + (hl > hr ? hl : hr);
+}
+
+static inline GTLink GT (RotateR_) (GTLink n1)
+{
+	GTLink n2 = n1->left;
+	n1->left = n2->right;
+	n2->right = n1;
+	GT (Fix_) (n1);
+	GT (Fix_) (n2);
+	return n2;
+}
+
+static inline GTLink GT (RotateL_) (GTLink n2)
+{
+	GTLink n1 = n2->right;
+	n2->right = n1->left;
+	n1->left = n2;
+	GT (Fix_) (n2);
+	GT (Fix_) (n1);
+	return n1;
+}
+
+// restore the AVL property at t, after an insert or delete below it
+static inline GTLink GT (Balance_) (GTLink t)
+{
+	int balance = GT (Height_) (t->left) - GT (Height_) (t->right);
+	if (balance > 1) {
+		if (GT (Height_) (t->left->left) < GT (Height_) (t->left->right))
+			t->left = GT (RotateL_) (t->left);
+		return GT (RotateR_) (t);
+	}
+	if (balance < -1) {
+		if (GT (Height_) (t->right->right) < GT (Height_) (t->right->left))
+			t->right = GT (RotateR_) (t->right);
+		return GT (RotateL_) (t);
+	}
+	GT (Fix_) (t);
+	return t;
+}
+
+static inline GTREE_NAME GTREE_CAT (new, GTREE_NAME) (void)
+{
+	GTREE_NAME new = malloc (sizeof *new);
+	if (new == NULL) err (EX_OSERR, "couldn't allocate tree");
+	*new = (GT (Rep)) { .root = NULL, .nitems = 0, .pool = NULL };
+	return new;
+}
+
+static inline GTREE_NAME GTREE_CAT (newPooled, GTREE_NAME) (void)
+{
+	GTREE_NAME new = GTREE_CAT (new, GTREE_NAME) ();
+	new->pool = newPool (sizeof (GT (Node)));
+	return new;
+}
+
+static inline void GT (FreeNode_) (GTREE_NAME t, GTLink n)
+{
+	if (t->pool != NULL)
+		PoolFree (t->pool, n);
+	else
+		free (n);
+}
+
+static inline void GT (Drop_) (GTREE_NAME t, GTLink n)
+{
+	if (n == NULL) return;
+	GT (Drop_) (t, n->left);
+	GT (Drop_) (t, n->right);
+	GTREE_FREE (n->value);
+	GT (FreeNode_) (t, n);
+}
+
+static inline void GTREE_CAT (drop, GTREE_NAME) (GTREE_NAME t)
+{
+	if (t == NULL) return;
+#ifdef GTREE_NOFREE
+	// the nodes go with the Pool, and hold nothing else to free
+	if (t->pool == NULL)
+#endif
+		GT (Drop_) (t, t->root);
+	dropPool (t->pool);
+	free (t);
+}
+
+static inline GTLink GT (Insert_) (GTREE_NAME t, GTLink n, GTREE_ITEM it, int *added)
+{
+	if (n == NULL) {
+		GTLink new = (t->pool != NULL) ? PoolAlloc (t->pool) : malloc (sizeof *new);
+		if (new == NULL) err (EX_OSERR, "couldn't allocate tree node");
+		*new = (GT (Node)) { .value = GTREE_COPY (it), .left = NULL, .right = NULL, .height = 1 };
+		*added = 1;
+		return new;
+	}
+	int diff = GTREE_CMP (GTREE_KEYOF (it), GTREE_KEYOF (n->value));
+	if (diff == 0) return n;
+	if (diff < 0)
+		n->left = GT (Insert_) (t, n->left, it, added);
+	else
+		n->right = GT (Insert_) (t, n->right, it, added);
+	return GT (Balance_) (n);
+}
+
+static inline int GT (Insert) (GTREE_NAME t, GTREE_ITEM it)
+{
+	int added = 0;
+	t->root = GT (Insert_) (t, t->root, it, &added);
+	t->nitems += added;
+	return added;
+}
+
+// take the smallest node out of the subtree n, into *min
+static inline GTLink GT (RemoveMin_) (GTLink n, GTLink *min)
+{
+	if (n->left == NULL) {
+		*min = n;
+		return n->right;
+	}
+	n->left = GT (RemoveMin_) (n->left, min);
+	return GT (Balance_) (n);
+}
+
+static inline GTLink GT (Delete_) (GTREE_NAME t, GTLink n, GTREE_KEY k, int *deleted)
+{
+	if (n == NULL) return NULL;
+	int diff = GTREE_CMP (k, GTREE_KEYOF (n->value));
+	if (diff < 0) {
+		n->left = GT (Delete_) (t, n->left, k, deleted);
+	} else if (diff > 0) {
+		n->right = GT (Delete_) (t, n->right, k, deleted);
+	} else {
+		// the successor's node takes n's place, so no item is copied
+		GTLink succ = n->right;
+		if (succ == NULL) succ = n->left;
+		else {
+			GTLink right = GT (RemoveMin_) (n->right, &succ);
+			succ->left = n->left;
+			succ->right = right;
+			succ = GT (Balance_) (succ);
+		}
+		GTREE_FREE (n->value);
+		GT (FreeNode_) (t, n);
+		*deleted = 1;
+		return succ;
+	}
+	return GT (Balance_) (n);
+}
+
+static inline int GT (Delete) (GTREE_NAME t, GTREE_KEY k)
+{
+	int deleted = 0;
+	t->root = GT (Delete_) (t, t->root, k, &deleted);
+	t->nitems -= deleted;
+	return deleted;
+}
+
+static inline GTREE_ITEM *GT (Find) (GTREE_NAME t, GTREE_KEY k)
+{
+	GTLink n = t->root;
+	while (n != NULL) {
+		int diff = GTREE_CMP (k, GTREE_KEYOF (n->value));
+		if (diff == 0) return &n->value;
+		n = diff < 0 ? n->left : n->right;
+	}
+	return NULL;
+}
+
+static inline int GT (NumNodes) (GTREE_NAME t)
+{
+	return t->nitems;
+}
+
+static inline void GT (Walk_) (GTLink n, void (*visit) (GTREE_ITEM *, void *), void *cl)
+{
+	for (; n != NULL; n = n->right) {
+		GT (Walk_) (n->left, visit, cl);
+		visit (&n->value, cl);
+	}
+}
+
+static inline void GT (Walk) (GTREE_NAME t, void (*visit) (GTREE_ITEM *, void *), void *cl)
+{
+	GT (Walk_) (t->root, visit, cl);
+}
+
+#undef GT
+#undef GTLink
+#undef GTREE_NAME
+#undef GTREE_ITEM
+#undef GTREE_KEY
+#undef GTREE_KEYOF
+#undef GTREE_CMP
+#undef GTREE_COPY
+#undef GTREE_FREE
+#undef GTREE_NOFREE
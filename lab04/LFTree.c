@@ -0,0 +1,424 @@
+// LFTree.c ... lock-free external binary search tree
+//
+// After Natarajan and Mittal, "Fast Concurrent Lock-Free Binary Search
+// Trees" (PPoPP 2014).  Every internal node has two children; items are
+// in the leaves.  A child pointer (an Edge) carries two marks in its low
+// bits: FLAG says the leaf below it is being deleted, TAG says the edge
+// must not change because its sibling's leaf is being deleted.  Marked
+// edges are never changed, only replaced from above.
+//
+// Insert: find the leaf where the key belongs and swing its parent's
+// edge, with one CAS, to a new internal node over the old leaf and a new
+// leaf.  Delete: flag the edge to the leaf (that is the point at which
+// the item is gone), tag the edge to its sibling, then swing the edge
+// above the parent down to the sibling.  Any thread that runs into a
+// marked edge finishes that delete before going on, so nobody waits.
+//
+// Three sentinel leaves, bigger than any key, mean that the tree always
+// has a grandparent above every real leaf.
+
+#include <err.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sysexits.h>
+
+#include "LFTree.h"
+
+#define FLAG ((Edge) 1)
+#define TAG ((Edge) 2)
+#define MARKS (FLAG | TAG)
+
+typedef struct Node *Link;
+typedef uintptr_t Edge; // a Link, with marks in its low bits
+
+typedef struct Node {
+	Item value;
+	int inf; // 0 for an item; 1, 2, 3 for sentinels, above every key
+	Edge left, right; // both 0 in a leaf
+} Node;
+
+typedef struct LFTreeRep {
+	Link root; // sentinel inf 3, whose left child is sentinel inf 2
+} LFTreeRep;
+
+// where a search for a key ended: leaf, its parent, and the edge from
+// ancestor to successor, the last untagged edge on the path to parent
+typedef struct Seek {
+	Link ancestor, successor, parent, leaf;
+} Seek;
+
+// Epoch-based reclamation.  A thread in an LFTree function announces the
+// global epoch in its Record.  The epoch only advances when every thread
+// in a function has announced it; so once it has advanced twice past the
+// epoch in which a node was taken out of the tree, no thread can still
+// hold a pointer to that node, and it is freed.
+
+#define RETIRE_BATCH 64 // retires between tries to advance the epoch
+
+typedef struct Record {
+	struct Record *next; // all Records, linked from records
+	int inUse; // claimed by a thread
+	unsigned long state; // epoch << 1, | 1 while in an LFTree function
+	Link *limbo[3]; // retired in epochs congruent to 0, 1, 2 mod 3
+	int nlimbo[3], maxlimbo[3];
+	int sinceAdvance;
+} Record;
+
+static Record *records = NULL;
+static unsigned long globalEpoch = 0;
+static pthread_key_t recordKey;
+static pthread_once_t recordOnce = PTHREAD_ONCE_INIT;
+static _Thread_local Record *self = NULL;
+
+// Forward references for private functions
+
+static Link newNode (Item, int, Edge, Edge);
+static void drop (Link);
+static int count (Link);
+static void seek (LFTree, Key, Seek *);
+static int cleanup (Key, Seek *);
+
+static void epochEnter (void);
+static void epochExit (void);
+static void retire (Link);
+static void tryAdvance (void);
+static void freeLimbo (Record *, int);
+static void makeRecordKey (void);
+static void releaseRecord (void *);
+
+static inline Link addr (Edge e)
+{
+	return (Link) (e & ~MARKS);
+}
+
+static inline Edge load (Edge *e)
+{
+	return __atomic_load_n (e, __ATOMIC_ACQUIRE);
+}
+
+static inline int cas (Edge *e, Edge old, Edge new)
+{
+	return __atomic_compare_exchange_n (
+		e, &old, new, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+}
+
+// Helper: does a search for k go left at n?  (keys equal to n's go right)
+static inline int goesLeft (Key k, Link n)
+{
+	return n->inf != 0 || less (k, key (n->value));
+}
+
+static inline Edge *childEdge (Link n, Key k)
+{
+	return goesLeft (k, n) ? &n->left : &n->right;
+}
+
+static inline int isItem (Link n, Key k)
+{
+	return n->inf == 0 && eq (k, key (n->value));
+}
+
+// Interface: create a new empty LFTree
+LFTree newLFTree (void)
+{
+	LFTreeRep *new = malloc (sizeof *new);
+	if (new == NULL) err (EX_OSERR, "couldn't allocate LFTree");
+	Link s = newNode (0, 2, (Edge) newNode (0, 1, 0, 0), (Edge) newNode (0, 2, 0, 0));
+	new->root = newNode (0, 3, (Edge) s, (Edge) newNode (0, 3, 0, 0));
+	return new;
+}
+
+// Helper: make a new node
+static Link newNode (Item v, int inf, Edge left, Edge right)
+{
+	Node *new = malloc (sizeof *new);
+	if (new == NULL) err (EX_OSERR, "couldn't allocate LFTree node");
+	*new = (Node) { .value = v, .inf = inf, .left = left, .right = right };
+	return new;
+}
+
+// Interface: free memory associated with LFTree
+void dropLFTree (LFTree t)
+{
+	if (t == NULL) return;
+	drop (t->root);
+	free (t);
+}
+
+// Helper: recursive drop
+static void drop (Link t)
+{
+	if (t == NULL) return;
+	drop (addr (t->left));
+	drop (addr (t->right));
+	free (t);
+}
+
+// Interface: count #items in LFTree
+int LFTreeNumNodes (LFTree t)
+{
+	epochEnter ();
+	int n = count (t->root);
+	epochExit ();
+	return n;
+}
+
+// Helper: count the item leaves under t
+static int count (Link t)
+{
+	Link l = addr (load (&t->left));
+	if (l == NULL) return t->inf == 0;
+	return count (l) + count (addr (load (&t->right)));
+}
+
+// Interface: check whether a value is in an LFTree
+int LFTreeFind (LFTree t, Key k)
+{
+	epochEnter ();
+	Link curr = t->root;
+	for (;;) {
+		Link next = addr (load (childEdge (curr, k)));
+		if (next == NULL) break;
+		curr = next;
+	}
+	int found = isItem (curr, k);
+	epochExit ();
+	return found;
+}
+
+// Interface: insert a new value into an LFTree
+int LFTreeInsert (LFTree t, Item it)
+{
+	Key k = key (it);
+	Link leaf = newNode (it, 0, 0, 0);
+	Link internal = newNode (it, 0, 0, 0);
+	Seek s;
+	epochEnter ();
+	for (;;) {
+		seek (t, k, &s);
+		if (isItem (s.leaf, k)) {
+			epochExit ();
+			free (leaf);
+			free (internal);
+			return 0;
+		}
+
+		// the internal node routes on the bigger of the two keys
+		if (goesLeft (k, s.leaf)) {
+			*internal = (Node) { .value = s.leaf->value, .inf = s.leaf->inf,
+				.left = (Edge) leaf, .right = (Edge) s.leaf };
+		} else {
+			*internal = (Node) { .value = it, .left = (Edge) s.leaf, .right = (Edge) leaf };
+		}
+		Edge *child = childEdge (s.parent, k);
+		if (cas (child, (Edge) s.leaf, (Edge) internal))
+			break;
+
+		// if the leaf is being deleted, help, then try again
+		Edge e = load (child);
+		if (addr (e) == s.leaf && (e & MARKS))
+			cleanup (k, &s);
+	}
+	epochExit ();
+	return 1;
+}
+
+// Interface: delete a value from an LFTree
+int LFTreeDelete (LFTree t, Key k)
+{
+	Link leaf = NULL; // once our flag is on the edge to it
+	Seek s;
+	epochEnter ();
+	for (;;) {
+		seek (t, k, &s);
+		if (leaf == NULL) {
+			if (! isItem (s.leaf, k)) {
+				epochExit ();
+				return 0;
+			}
+			Edge *child = childEdge (s.parent, k);
+			if (cas (child, (Edge) s.leaf, (Edge) s.leaf | FLAG)) {
+				leaf = s.leaf;
+				if (cleanup (k, &s))
+					break;
+			} else {
+				Edge e = load (child);
+				if (addr (e) == s.leaf && (e & MARKS))
+					cleanup (k, &s);
+			}
+		} else {
+			// another thread may have finished taking it out
+			if (s.leaf != leaf || cleanup (k, &s))
+				break;
+		}
+	}
+	epochExit ();
+	return 1;
+}
+
+// Helper: find where k is, or would go
+static void seek (LFTree t, Key k, Seek *s)
+{
+	Link r = t->root;
+	Link sentinel = addr (load (&r->left));
+	s->ancestor = r;
+	s->successor = sentinel;
+	s->parent = sentinel;
+	Edge parentEdge = load (&sentinel->left);
+	s->leaf = addr (parentEdge);
+	Edge currEdge = load (childEdge (s->leaf, k));
+	Link curr = addr (currEdge);
+	while (curr != NULL) {
+		if (! (parentEdge & TAG)) {
+			s->ancestor = s->parent;
+			s->successor = s->leaf;
+		}
+		s->parent = s->leaf;
+		s->leaf = curr;
+		parentEdge = currEdge;
+		currEdge = load (childEdge (curr, k));
+		curr = addr (currEdge);
+	}
+}
+
+// Helper: finish the delete of a flagged child of s->parent, by moving its
+// sibling up to replace s->successor.  Returns 1 if this thread did it,
+// and so retires what came out: the nodes from successor down to parent,
+// and the flagged leaf hanging off each of them.
+static int cleanup (Key k, Seek *s)
+{
+	Link parent = s->parent;
+	Edge *successorEdge = childEdge (s->ancestor, k);
+	Edge *child = childEdge (parent, k);
+	Edge *sibling = (child == &parent->left) ? &parent->right : &parent->left;
+	if (! (load (child) & FLAG)) {
+		// it is k's sibling that is being deleted
+		Edge *tmp = child;
+		child = sibling;
+		sibling = tmp;
+	}
+
+	__atomic_fetch_or (sibling, TAG, __ATOMIC_SEQ_CST);
+	Edge e = load (sibling);
+	if (! cas (successorEdge, (Edge) s->successor, e & ~TAG))
+		return 0;
+
+	for (Link n = s->successor; n != parent; ) {
+		Edge *on = childEdge (n, k);
+		Edge *off = (on == &n->left) ? &n->right : &n->left;
+		Link next = addr (load (on));
+		retire (addr (load (off)));
+		retire (n);
+		n = next;
+	}
+	retire (addr (load (child)));
+	retire (parent);
+	return 1;
+}
+
+// Interface: free every node waiting to be reclaimed
+void LFTreeQuiesce (void)
+{
+	for (Record *r = __atomic_load_n (&records, __ATOMIC_ACQUIRE); r != NULL; r = r->next)
+		for (int i = 0; i < 3; i++)
+			freeLimbo (r, i);
+}
+
+// Helper: announce the epoch; this thread's nodes retired two or more
+// epochs ago can now be freed
+static void epochEnter (void)
+{
+	Record *r = self;
+	if (r == NULL) {
+		pthread_once (&recordOnce, makeRecordKey);
+		// reuse the Record of a thread that has finished, if there is one
+		for (r = __atomic_load_n (&records, __ATOMIC_ACQUIRE); r != NULL; r = r->next) {
+			int unused = 0;
+			if (__atomic_compare_exchange_n (
+					&r->inUse, &unused, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+				break;
+		}
+		if (r == NULL) {
+			r = calloc (1, sizeof *r);
+			if (r == NULL) err (EX_OSERR, "couldn't allocate LFTree epoch record");
+			r->inUse = 1;
+			r->next = __atomic_load_n (&records, __ATOMIC_RELAXED);
+			while (! __atomic_compare_exchange_n (
+					&records, &r->next, r, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+				;
+		}
+		pthread_setspecific (recordKey, r);
+		self = r;
+	}
+
+	// the epoch announced must still be the global one afterwards
+	unsigned long e = __atomic_load_n (&globalEpoch, __ATOMIC_SEQ_CST);
+	for (;;) {
+		__atomic_store_n (&r->state, e << 1 | 1, __ATOMIC_SEQ_CST);
+		unsigned long now = __atomic_load_n (&globalEpoch, __ATOMIC_SEQ_CST);
+		if (now == e) break;
+		e = now;
+	}
+	freeLimbo (r, (e + 1) % 3);
+}
+
+static void epochExit (void)
+{
+	__atomic_store_n (&self->state, 0, __ATOMIC_RELEASE);
+}
+
+// Helper: free n once no thread can reach it.  It is filed under the
+// global epoch now, which is at least that of any thread that saw it.
+static void retire (Link n)
+{
+	Record *r = self;
+	int i = __atomic_load_n (&globalEpoch, __ATOMIC_SEQ_CST) % 3;
+	if (r->nlimbo[i] == r->maxlimbo[i]) {
+		int max = r->maxlimbo[i] == 0 ? RETIRE_BATCH : 2 * r->maxlimbo[i];
+		Link *bigger = realloc (r->limbo[i], (size_t) max * sizeof (Link));
+		if (bigger == NULL) err (EX_OSERR, "couldn't allocate LFTree limbo list");
+		r->limbo[i] = bigger;
+		r->maxlimbo[i] = max;
+	}
+	r->limbo[i][r->nlimbo[i]++] = n;
+	if (++r->sinceAdvance >= RETIRE_BATCH) {
+		r->sinceAdvance = 0;
+		tryAdvance ();
+	}
+}
+
+// Helper: move to the next epoch, if every thread inside has seen this one
+static void tryAdvance (void)
+{
+	unsigned long e = __atomic_load_n (&globalEpoch, __ATOMIC_SEQ_CST);
+	for (Record *r = __atomic_load_n (&records, __ATOMIC_ACQUIRE); r != NULL; r = r->next) {
+		unsigned long state = __atomic_load_n (&r->state, __ATOMIC_SEQ_CST);
+		if ((state & 1) && (state >> 1) != e)
+			return;
+	}
+	__atomic_compare_exchange_n (
+		&globalEpoch, &e, e + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED);
+}
+
+static void freeLimbo (Record *r, int i)
+{
+	for (int j = 0; j < r->nlimbo[i]; j++)
+		free (r->limbo[i][j]);
+	r->nlimbo[i] = 0;
+}
+
+static void makeRecordKey (void)
+{
+	if (pthread_key_create (&recordKey, releaseRecord) != 0)
+		errx (EX_OSERR, "couldn't create LFTree thread key");
+}
+
+// Helper: at thread exit, give up the Record; its limbo lists go with
+// it, to the next thread that takes it
+static void releaseRecord (void *arg)
+{
+	Record *r = arg;
+	__atomic_store_n (&r->state, 0, __ATOMIC_RELEASE);
+	__atomic_store_n (&r->inUse, 0, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,36 @@
+// LFTree.h ... interface to a lock-free binary search tree
+//
+// Any number of threads can insert, delete and search an LFTree at
+// once, without locks: a thread that is held up never holds up the
+// others.  It is Natarajan and Mittal's external tree (PPoPP 2014): the
+// items are in the leaves, and internal nodes only route searches.
+// It is not rebalanced, so it is only as balanced as the order in which
+// items arrive makes it.  Nodes taken out of the tree are freed once no
+// thread can still be looking at them (epoch-based reclamation).
+
+#ifndef LFTREE_H
+#define LFTREE_H
+
+#include "Tree.h"
+
+typedef struct LFTreeRep *LFTree;
+
+// create an empty LFTree
+LFTree newLFTree (void);
+// free memory associated with LFTree; no other thread may be using it
+void dropLFTree (LFTree);
+
+// insert a new value into an LFTree; 0 if it was already there
+int LFTreeInsert (LFTree, Item);
+// delete a value from an LFTree; 0 if it wasn't there
+int LFTreeDelete (LFTree, Key);
+// check whether a value is in an LFTree
+int LFTreeFind (LFTree, Key);
+// count #items in LFTree; exact only while nothing is changing it
+int LFTreeNumNodes (LFTree);
+
+// free every node still waiting to be reclaimed, in all LFTrees; only
+// when no thread is inside an LFTree function (e.g. before exit)
+void LFTreeQuiesce (void);
+
+#endif
@@ -0,0 +1,80 @@
+// Pool.c ... pool of fixed-size objects, in slabs with a free list
+
+#include <err.h>
+#include <stdlib.h>
+#include <sysexits.h>
+
+#include "Pool.h"
+
+#define FIRST_SLAB 64 // objects in the first slab
+#define MAX_SLAB 4096 // most objects in a slab
+
+// a slab is this header, then the objects
+typedef union Slab {
+	union Slab *next;
+	max_align_t align;
+} Slab;
+
+typedef struct PoolRep {
+	size_t size; // of an object, rounded up to a pointer's
+	void *free; // objects freed; each holds the next one's address
+	char *next, *end; // the part of the newest slab not yet handed out
+	Slab *slabs;
+	size_t nextSlab; // objects in the next slab
+} PoolRep;
+
+// Interface: create a Pool of objects of the given size
+Pool newPool (size_t size)
+{
+	PoolRep *new = malloc (sizeof *new);
+	if (new == NULL) err (EX_OSERR, "couldn't allocate Pool");
+	size_t unit = sizeof (void *);
+	if (size < unit) size = unit;
+	*new = (PoolRep) {
+		.size = (size + unit - 1) / unit * unit,
+		.nextSlab = FIRST_SLAB,
+	};
+	return new;
+}
+
+// Interface: free a Pool and everything in it
+void dropPool (Pool p)
+{
+	if (p == NULL) return;
+	Slab *s = p->slabs;
+	while (s != NULL) {
+		Slab *next = s->next;
+		free (s);
+		s = next;
+	}
+	free (p);
+}
+
+// Interface: allocate an object
+void *PoolAlloc (Pool p)
+{
+	if (p->free != NULL) {
+		void *obj = p->free;
+		p->free = *(void **) obj;
+		return obj;
+	}
+	if (p->next == p->end) {
+		Slab *s = malloc (sizeof (Slab) + p->nextSlab * p->size);
+		if (s == NULL) err (EX_OSERR, "couldn't allocate Pool slab");
+		s->next = p->slabs;
+		p->slabs = s;
+		p->next = (char *) (s + 1);
+		p->end = p->next + p->nextSlab * p->size;
+		if (p->nextSlab < MAX_SLAB) p->nextSlab *= 2;
+	}
+	void *obj = p->next;
+	p->next += p->size;
+	return obj;
+}
+
+// Interface: give an object back
+void PoolFree (Pool p, void *obj)
+{
+	*(void **) obj = p->free;
+	p->free = obj;
+}
@@ -0,0 +1,25 @@
+// Pool.h ... interface to a pool of fixed-size objects
+//
+// Objects are carved out of big slabs, and freed objects go on a free
+// list for the next allocation, so neither costs a call to malloc or
+// free.  Dropping a Pool frees it a slab at a time, not an object at a
+// time.  Slabs start small and double, so a small Pool stays small.
+
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+
+typedef struct PoolRep *Pool;
+
+// create a Pool of objects of the given size
+Pool newPool (size_t);
+// free a Pool, and every object allocated from it
+void dropPool (Pool);
+
+// allocate an object from a Pool; aligned as a pointer, and not zeroed
+void *PoolAlloc (Pool);
+// give an object back to the Pool it came from
+void PoolFree (Pool, void *);
+
+#endif
@@ -0,0 +1,79 @@
+// SyncTree.c ... a Tree shared between threads, behind a readers-writer lock
+
+#include <err.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sysexits.h>
+
+#include "SyncTree.h"
+
+typedef struct SyncTreeRep {
+	pthread_rwlock_t lock;
+	Tree tree;
+	int searchWrites; // TreeFind changes the Tree (splay)
+} SyncTreeRep;
+
+// Interface: share a Tree
+SyncTree newSyncTree (Tree t)
+{
+	SyncTreeRep *new = malloc (sizeof *new);
+	if (new == NULL) err (EX_OSERR, "couldn't allocate SyncTree");
+	*new = (SyncTreeRep) { .tree = t, .searchWrites = TreeStyle (t) == InsertSplay };
+
+	pthread_rwlockattr_t attr;
+	pthread_rwlockattr_init (&attr);
+#ifdef __GLIBC__
+	// glibc lets a steady stream of readers starve the writer otherwise
+	pthread_rwlockattr_setkind_np (&attr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+#endif
+	if (pthread_rwlock_init (&new->lock, &attr) != 0)
+		errx (EX_OSERR, "couldn't initialise SyncTree lock");
+	pthread_rwlockattr_destroy (&attr);
+	return new;
+}
+
+// Interface: free memory associated with SyncTree
+void dropSyncTree (SyncTree st)
+{
+	if (st == NULL) return;
+	pthread_rwlock_destroy (&st->lock);
+	dropTree (st->tree);
+	free (st);
+}
+
+// Interface: insert a new value into a SyncTree
+void SyncTreeInsert (SyncTree st, Item it)
+{
+	pthread_rwlock_wrlock (&st->lock);
+	TreeInsert (st->tree, it);
+	pthread_rwlock_unlock (&st->lock);
+}
+
+// Interface: delete a value from a SyncTree
+void SyncTreeDelete (SyncTree st, Key k)
+{
+	pthread_rwlock_wrlock (&st->lock);
+	TreeDelete (st->tree, k);
+	pthread_rwlock_unlock (&st->lock);
+}
+
+// Interface: check whether a value is in a SyncTree
+int SyncTreeFind (SyncTree st, Key k)
+{
+	if (st->searchWrites)
+		pthread_rwlock_wrlock (&st->lock);
+	else
+		pthread_rwlock_rdlock (&st->lock);
+	int found = TreeFind (st->tree, k);
+	pthread_rwlock_unlock (&st->lock);
+	return found;
+}
+
+// Interface: count #nodes in SyncTree
+int SyncTreeNumNodes (SyncTree st)
+{
+	pthread_rwlock_rdlock (&st->lock);
+	int n = TreeNumNodes (st->tree);
+	pthread_rwlock_unlock (&st->lock);
+	return n;
+}
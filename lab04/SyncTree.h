@@ -0,0 +1,29 @@
+// SyncTree.h ... a Tree shared between threads
+//
+// Many threads can search a SyncTree at once, while updates take turns
+// with each other and with the searches, under a readers-writer lock.
+// A splay tree changes shape on every search, so there every operation
+// takes the lock for writing.
+
+#ifndef SYNCTREE_H
+#define SYNCTREE_H
+
+#include "Tree.h"
+
+typedef struct SyncTreeRep *SyncTree;
+
+// share a Tree; the SyncTree owns it from now on
+SyncTree newSyncTree (Tree);
+// free memory associated with SyncTree, and its Tree
+void dropSyncTree (SyncTree);
+
+// insert a new value into a SyncTree
+void SyncTreeInsert (SyncTree, Item);
+// delete a value from a SyncTree
+void SyncTreeDelete (SyncTree, Key);
+// check whether a value is in a SyncTree
+int SyncTreeFind (SyncTree, Key);
+// count #nodes in SyncTree
+int SyncTreeNumNodes (SyncTree);
+
+#endif
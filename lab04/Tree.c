@@ -8,6 +8,7 @@
 #include <string.h>
 #include <sysexits.h>
 
+#include "Pool.h"
 #include "Tree.h"
 
 // Representation of Trees and Nodes
@@ -17,7 +18,9 @@ typedef struct Node *Link;
 typedef struct Node {
 	Item value;
 	Link left, right;
-	Tree within; // which tree contains this Node
+	int size; // #nodes in the subtree
+	int height; // of the subtree; only relied on by InsertAVL
+	int red; // colour of the link from the parent, for InsertRedBlack
 } Node;
 
 typedef struct TreeRep {
@@ -25,39 +28,79 @@ typedef struct TreeRep {
 	Style insert;
 	int ncompares;
 	int nrotates;
+	Link block; // nodes allocated together by TreeBuildFromSorted
+	int nblock;
+	Pool pool; // where the other nodes come from, if not malloc
 } TreeRep;
 
-// Forward references for private functions
-
-static Link newNode (Item);
-static void drop (Link);
-static int depth (Link);
-static int size (Link);
+// Context for one operation on a Tree: which Tree, and the counts of its
+// work, added to the Tree's when it is done (see tally).  Passed down to
+// every helper, instead of a global or a Tree pointer in each Node, so
+// that different threads can work on different Trees, and on one Tree
+// under a readers-writer lock (see SyncTree.h).
+typedef struct Ctx {
+	Tree tree;
+	int ncompares;
+	int nrotates;
+} Ctx;
 
-static Link insert (Link, Item);
-static Link insertAtRoot (Link, Item);
-static Link insertRandom (Link, Item);
-static Link insertRebalance (Link, Item);
-static Link insertSplay (Link, Item);
-static Link insertAVL (Link, Item);
+#define ITER_LOCAL 64
 
-static Link search (Link, Key);
-static Link searchSplay (Link, Key, int *);
+typedef struct TreeIterRep {
+	Key hi;
+	Link *stack; // nodes still to be visited; the next one is on top
+	int top, max;
+	Link local[ITER_LOCAL]; // deep enough for any balanced tree
+} TreeIterRep;
 
-static Link delete (Link, Key);
-static Link deleteRoot (Link);
+// Forward references for private functions
 
-static Link partition (Link, int);
-static Link rebalance (Link);
-static Link rotateR (Link);
-static Link rotateL (Link);
+static Link newNode (Tree, Item);
+static void freeNode (Tree, Link);
+static void drop (Tree, Link);
+static Link build (Ctx *, Item *, int, int, int, int);
+static void tally (Ctx *);
+static int depth (Link);
+static int size (Link);
+static int height (Link);
+static void fixNode (Link);
+
+static Link insert (Ctx *, Link, Item);
+static Link insertAtRoot (Ctx *, Link, Item);
+static Link insertRandom (Ctx *, Link, Item);
+static Link insertRebalance (Ctx *, Link, Item);
+static Link insertSplay (Ctx *, Link, Item);
+static Link insertAVL (Ctx *, Link, Item);
+static Link insertRedBlack (Ctx *, Link, Item);
+
+static Link search (Ctx *, Link, Key);
+static Link searchSplay (Ctx *, Link, Key, int *);
+
+static Link delete (Ctx *, Link, Key);
+static Link deleteRoot (Ctx *, Link);
+static Link deleteAVL (Ctx *, Link, Key);
+static Link balanceAVL (Ctx *, Link);
+static Link deleteRedBlack (Ctx *, Link, Key);
+static Link deleteMinRB (Ctx *, Link);
+static Link moveRedLeft (Ctx *, Link);
+static Link moveRedRight (Ctx *, Link);
+static Link fixUpRB (Ctx *, Link);
+static int isRed (Link);
+static void flipColours (Link);
+static Link rotateLRB (Ctx *, Link);
+static Link rotateRRB (Ctx *, Link);
+
+static Link partition (Ctx *, Link, int);
+static Link rebalance (Ctx *, Link);
+static Link rotateR (Ctx *, Link);
+static Link rotateL (Ctx *, Link);
+
+static void iterStart (TreeIterRep *, Tree, Key, Key);
+static void iterPush (TreeIterRep *, Link);
+static Link iterNext (TreeIterRep *);
 
 static void doShowTree (Link);
 
-// used to hold current tree during insertion
-
-static Tree thisTree = NULL;
-
 // Interface: create a new empty Tree
 Tree newTree (Style ins)
 {
@@ -67,12 +110,76 @@ Tree newTree (Style ins)
 	return new;
 }
 
-// Helper: make a new node containing a value
-static Link newNode (Item v)
+// Interface: create a new empty Tree, whose nodes come from a Pool
+Tree newPooledTree (Style ins)
+{
+	Tree t = newTree (ins);
+	t->pool = newPool (sizeof (Node));
+	return t;
+}
+
+// Helper: make a new node of Tree t containing a value
+static Link newNode (Tree t, Item v)
+{
+	Node *new;
+	if (t->pool != NULL) {
+		new = PoolAlloc (t->pool);
+	} else {
+		new = malloc (sizeof *new);
+		if (new == NULL) err (EX_OSERR, "couldn't allocate Tree node");
+	}
+	*new = (Node) { .value = v, .size = 1, .height = 1 };
+	return new;
+}
+
+// Helper: free a node of Tree t, unless it is part of t's block
+static void freeNode (Tree t, Link n)
+{
+	if (t->block != NULL && t->block <= n && n < t->block + t->nblock)
+		return;
+	if (t->pool != NULL)
+		PoolFree (t->pool, n);
+	else
+		free (n);
+}
+
+// Interface: build a balanced Tree from n items in ascending key order
+Tree TreeBuildFromSorted (Style ins, Item *items, int n)
+{
+	for (int i = 1; i < n; i++)
+		assert (less (key (items[i - 1]), key (items[i])));
+	Tree t = newTree (ins);
+	if (n == 0) return t;
+
+	t->block = malloc ((size_t) n * sizeof (Node));
+	if (t->block == NULL) err (EX_OSERR, "couldn't allocate Tree nodes");
+	t->nblock = n;
+	int maxDepth = 0;
+	for (int m = n; m > 0; m /= 2)
+		maxDepth++;
+	Ctx c = { .tree = t };
+	t->root = build (&c, items, 0, n - 1, 1, maxDepth);
+	t->root->red = 0;
+	tally (&c);
+	return t;
+}
+
+// Helper: link items[lo..hi] into a balanced subtree at the given depth,
+// using the block node in each item's position.  All the empty subtrees
+// are at depth maxDepth or maxDepth + 1, so colouring the nodes at depth
+// maxDepth red gives equal black heights; for InsertRedBlack, fixUpRB
+// then makes the red links lean left, bottom up.
+static Link build (Ctx *c, Item *items, int lo, int hi, int d, int maxDepth)
 {
-	Node *new = malloc (sizeof *new);
-	if (new == NULL) err (EX_OSERR, "couldn't allocate Tree node");
-	*new = (Node) { .value = v, .within = thisTree };
+	if (lo > hi) return NULL;
+	int mid = lo + (hi - lo) / 2;
+	Link new = &c->tree->block[mid];
+	*new = (Node) { .value = items[mid], .red = (d == maxDepth) };
+	new->left = build (c, items, lo, mid - 1, d + 1, maxDepth);
+	new->right = build (c, items, mid + 1, hi, d + 1, maxDepth);
+	if (c->tree->insert == InsertRedBlack)
+		return fixUpRB (c, new);
+	fixNode (new);
 	return new;
 }
 
@@ -80,18 +187,32 @@ static Link newNode (Item v)
 void dropTree (Tree t)
 {
 	if (t == NULL) return;
-	drop (t->root);
+	// a Pool goes a slab at a time, without visiting the nodes
+	if (t->pool != NULL)
+		dropPool (t->pool);
+	else
+		drop (t, t->root);
+	free (t->block);
 	free (t);
 }
 
 // Helper: recursive drop
-static void drop (Link t)
+static void drop (Tree tree, Link t)
 {
 	if (t == NULL)
 		return;
-	drop (t->left);
-	drop (t->right);
-	free (t);
+	drop (tree, t->left);
+	drop (tree, t->right);
+	freeNode (tree, t);
+}
+
+// Helper: add an operation's counts to its Tree's.  Readers holding a
+// shared lock may tally at the same time, so the adds are atomic.
+static void tally (Ctx *c)
+{
+	__atomic_fetch_add (&c->tree->ncompares, c->ncompares, __ATOMIC_RELAXED);
+	if (c->nrotates != 0)
+		__atomic_fetch_add (&c->tree->nrotates, c->nrotates, __ATOMIC_RELAXED);
 }
 
 // Interface: display a Tree
@@ -110,6 +231,12 @@ void showTree (Tree t)
 		doShowTree (t->root);
 }
 
+// Interface: how values are inserted into a Tree
+Style TreeStyle (Tree t)
+{
+	return t->insert;
+}
+
 // Interface: depth of Tree (max path length)
 int TreeDepth (Tree t)
 {
@@ -131,79 +258,101 @@ int TreeNumNodes (Tree t)
 	return size (t->root);
 }
 
-// Helper: recursive node counter
+// Helper: cached node count of a subtree (0 if empty)
 static int size (Link t)
 {
-	if (t == NULL) return 0;
-	return 1 + size (t->left) + size (t->right);
+	return (t == NULL) ? 0 : t->size;
+}
+
+// Helper: cached height of a subtree (0 if empty)
+static int height (Link t)
+{
+	return (t == NULL) ? 0 : t->height;
+}
+
+// Helper: recompute a node's size and height from its children's;
+// every change to a subtree's shape must be followed by this, bottom up
+static void fixNode (Link t)
+{
+	int hL = height (t->left);
+	int hR = height (t->right);
+	t->height = 1 + ((hL > hR) ? hL : hR);
+	t->size = 1 + size (t->left) + size (t->right);
 }
 
 // Interface: insert a new value into a Tree
 void TreeInsert (Tree t, Item it)
 {
-	thisTree = t;
+	Ctx c = { .tree = t };
 	switch (t->insert) {
 	case InsertAtLeaf:
-		t->root = insert (t->root, it);
+		t->root = insert (&c, t->root, it);
 		break;
 	case InsertAtRoot:
-		t->root = insertAtRoot (t->root, it);
+		t->root = insertAtRoot (&c, t->root, it);
 		break;
 	case InsertRandom:
-		t->root = insertRandom (t->root, it);
+		t->root = insertRandom (&c, t->root, it);
 		break;
 	case InsertRebalance:
-		t->root = insertRebalance (t->root, it);
+		t->root = insertRebalance (&c, t->root, it);
 		break;
 	case InsertSplay:
-		t->root = insertSplay (t->root, it);
+		t->root = insertSplay (&c, t->root, it);
 		break;
 	case InsertAVL:
-		t->root = insertAVL (t->root, it);
+		t->root = insertAVL (&c, t->root, it);
+		break;
+	case InsertRedBlack:
+		t->root = insertRedBlack (&c, t->root, it);
+		t->root->red = 0;
 		break;
 	}
+	tally (&c);
 
 	// printf("After inserting %d, tree is:\n",key(it));
 	// showTree(t);
 }
 
 // Helpers: various styles of insert
-static Link insert (Link t, Item it)
+static Link insert (Ctx *c, Link t, Item it)
 {
-	if (t == NULL) return newNode (it);
+	if (t == NULL) return newNode (c->tree, it);
 	int diff = cmp (key (it), key (t->value));
 	if (diff == 0)      t->value = it;
-	else if (diff <  0) t->left  = insert (t->left,  it);
-	else if (diff  > 0) t->right = insert (t->right, it);
-	t->within->ncompares++;
+	else if (diff <  0) t->left  = insert (c, t->left,  it);
+	else if (diff  > 0) t->right = insert (c, t->right, it);
+	c->ncompares++;
+	fixNode (t);
 	return t;
 }
 
-static Link insertAtRoot (Link t, Item it)
+static Link insertAtRoot (Ctx *c, Link t, Item it)
 {
-	if (t == NULL) return newNode (it);
+	if (t == NULL) return newNode (c->tree, it);
 	int diff = cmp (key (it), key (t->value));
 	if (diff == 0) {
 		t->value = it;
 	} else if (diff < 0) {
-		t->left = insertAtRoot (t->left, it);
-		t = rotateR (t);
+		t->left = insertAtRoot (c, t->left, it);
+		t = rotateR (c, t);
 	} else if (diff > 0) {
-		t->right = insertAtRoot (t->right, it);
-		t = rotateL (t);
+		t->right = insertAtRoot (c, t->right, it);
+		t = rotateL (c, t);
 	}
-	t->within->ncompares++;
+	c->ncompares++;
+	fixNode (t);
 	return t;
 }
 
-static Link insertRandom (Link t, Item it)
+static Link insertRandom (Ctx *c, Link t, Item it)
 {
-	if (t == NULL) return newNode (it);
+	if (t == NULL) return newNode (c->tree, it);
 	int chance = rand () % 2;
 	if (chance != 0)
-		t = insertAtRoot (t, it);
+		t = insertAtRoot (c, t, it);
 	else
-		t = insert (t, it);
+		t = insert (c, t, it);
 	return t;
 }
 
@@ -214,106 +363,151 @@ static inline double ratio (double a, double b)
 	return max >= 1 ? min / max : __builtin_inf ();
 }
 
-static Link insertRebalance (Link t, Item it)
+static Link insertRebalance (Ctx *c, Link t, Item it)
 {
-	t = insert (t, it);
+	t = insert (c, t, it);
 	double lsize = size (t->left), rsize = size (t->right);
-	if (ratio (lsize, rsize) > 1.1) t = rebalance (t);
+	if (ratio (lsize, rsize) > 1.1) t = rebalance (c, t);
 	return t;
 }
 
-static Link insertSplay (Link t, Item it)
+static Link insertSplay (Ctx *c, Link t, Item it)
 {
-	if (t == NULL) return newNode (it);
+	if (t == NULL) return newNode (c->tree, it);
 
 	Key v = key (it);
 	int diff = cmp (v, key (t->value));
-	t->within->ncompares++;
+	c->ncompares++;
 
 	if (diff == 0) {
 		t->value = it;
 
 	} else if (diff < 0) {
+		// a key already at the child is replaced there, not added below it
+		int diffL = (t->left == NULL) ? 0 : cmp (v, key (t->left->value));
 		if (t->left == NULL) {
-			t->left = newNode (it);
-		} else if (less (v, key (t->left->value))) {
-	        t->within->ncompares++;
-			t->left->left = insertSplay (t->left->left, it);
-			t = rotateR (t);
+			t->left = newNode (c->tree, it);
+		} else if (diffL == 0) {
+	        c->ncompares++;
+			t->left->value = it;
+		} else if (diffL < 0) {
+	        c->ncompares++;
+			t->left->left = insertSplay (c, t->left->left, it);
+			t = rotateR (c, t);
 		} else {    
-	        t->within->ncompares++;
-			t->left->right = insertSplay (t->left->right, it);
-			t->left = rotateL (t->left);
+	        c->ncompares++;
+			t->left->right = insertSplay (c, t->left->right, it);
+			t->left = rotateL (c, t->left);
 		}
 
-		t = rotateR (t);
+		t = rotateR (c, t);
 
 	} else if (diff > 0) {
+		int diffR = (t->right == NULL) ? 0 : cmp (v, key (t->right->value));
 		if (t->right == NULL) {
-			t->right = newNode (it);
-		} else if (less (key (t->right->value), v)) {
-	        t->within->ncompares++;
-			t->right->right = insertSplay (t->right->right, it);
-			t = rotateL (t);
+			t->right = newNode (c->tree, it);
+		} else if (diffR == 0) {
+	        c->ncompares++;
+			t->right->value = it;
+		} else if (diffR > 0) {
+	        c->ncompares++;
+			t->right->right = insertSplay (c, t->right->right, it);
+			t = rotateL (c, t);
 		} else {
-	        t->within->ncompares++;
-			t->right->left = insertSplay (t->right->left, it);
-			t->right = rotateR (t->right);
+	        c->ncompares++;
+			t->right->left = insertSplay (c, t->right->left, it);
+			t->right = rotateR (c, t->right);
 		}
 
-		t = rotateL (t);
+		t = rotateL (c, t);
 	}
 
 	return t;
 }
 
-static Link insertAVL (Link t, Item it)
+static Link insertAVL (Ctx *c, Link t, Item it)
 {
-	if (t == NULL) return newNode (it);
+	if (t == NULL) return newNode (c->tree, it);
 	int diff = cmp (key (it), key (t->value));
-	t->within->ncompares++;
+	c->ncompares++;
 	if (diff == 0)     t->value = it;
-	else if (diff < 0) t->left  = insertAVL (t->left, it);
-	else if (diff > 0) t->right = insertAVL (t->right, it);
+	else if (diff < 0) t->left  = insertAVL (c, t->left, it);
+	else if (diff > 0) t->right = insertAVL (c, t->right, it);
+	return balanceAVL (c, t);
+}
 
-	int dL = depth (t->left);
-	int dR = depth (t->right);
-	if ((dL - dR) > 1) t = rotateR (t);
-	if ((dR - dL) > 1) t = rotateL (t);
+// Helper: restore the AVL property at t, after an insert or delete
+// below it has changed one subtree's height by at most 1
+static Link balanceAVL (Ctx *c, Link t)
+{
+	int balance = height (t->left) - height (t->right);
+	if (balance > 1) {
+		// left-right case needs a double rotation
+		if (height (t->left->left) < height (t->left->right))
+			t->left = rotateL (c, t->left);
+		t = rotateR (c, t);
+	} else if (balance < -1) {
+		// right-left case
+		if (height (t->right->right) < height (t->right->left))
+			t->right = rotateR (c, t->right);
+		t = rotateL (c, t);
+	} else {
+		fixNode (t);
+	}
 	return t;
 }
 
+// Left-leaning red-black tree (Sedgewick): a red link joins a node to
+// its left child in the same 2-3 node, and colours are fixed on the way
+// back up from the insert.
+static Link insertRedBlack (Ctx *c, Link t, Item it)
+{
+	if (t == NULL) {
+		Link new = newNode (c->tree, it);
+		new->red = 1;
+		return new;
+	}
+	int diff = cmp (key (it), key (t->value));
+	c->ncompares++;
+	if (diff == 0)     t->value = it;
+	else if (diff < 0) t->left  = insertRedBlack (c, t->left, it);
+	else if (diff > 0) t->right = insertRedBlack (c, t->right, it);
+	return fixUpRB (c, t);
+}
+
 // Interface: check whether a value is in a Tree
 int TreeFind (Tree t, Key k)
 {
+	Ctx c = { .tree = t };
 	Link res;
 	int found = 0;
 	if (t->insert == InsertSplay) {
-		t->root = searchSplay (t->root, k, &found);
+		t->root = searchSplay (&c, t->root, k, &found);
 		res = found ? t->root : NULL;
 	} else
-		res = search (t->root, k);
+		res = search (&c, t->root, k);
+	tally (&c);
 	return (res != NULL);
 }
 
 // Helpers: search functions to return Node containing key
-static Link search (Link t, Key k)
+static Link search (Ctx *c, Link t, Key k)
 {
 	if (t == NULL)
 		return NULL;
 	Link res = NULL;
 	int diff = cmp (k, t->value);
-	t->within->ncompares++;
+	c->ncompares++;
 	if (diff == 0)
 		res = t;
 	else if (diff < 0)
-		res = search (t->left, k);
+		res = search (c, t->left, k);
 	else if (diff > 0)
-		res = search (t->right, k);
+		res = search (c, t->right, k);
 	return res;
 }
 
-static Link searchSplay (Link t, Key k, int *found)
+static Link searchSplay (Ctx *c, Link t, Key k, int *found)
 {
 	Link res;
 	if (t == NULL) {
@@ -321,32 +515,32 @@ static Link searchSplay (Link t, Key k, int *found)
 		*found = 0;
 		res = NULL;
 	} else if (eq (key (t->value), k)) {
-        t->within->ncompares++;
+        c->ncompares++;
 		*found = 1; // item found, store true
 		res = t;
 	} else if (less (k, key (t->value))) {
-        t->within->ncompares++;
+        c->ncompares++;
 		if (t->left == NULL) {
 			*found = 0; // item not found
 			// res = rotateRight(t);
 			res = t;
 		} else if (eq (key (t->left->value), k)) {
-            t->within->ncompares++;
+            c->ncompares++;
 			*found = 1;
-			res = rotateR (t);
+			res = rotateR (c, t);
 		} else {
 			if (less (k, key (t->left->value))) {
-                t->within->ncompares++;
+                c->ncompares++;
 				// left-left
-				t->left->left = searchSplay (t->left->left, k, found);
-				t = rotateR (t);
+				t->left->left = searchSplay (c, t->left->left, k, found);
+				t = rotateR (c, t);
 			} else {
-                t->within->ncompares++;
+                c->ncompares++;
 				// left-right
-				t->left->right = searchSplay (t->left->right, k, found);
-				t->left = rotateL (t->left);
+				t->left->right = searchSplay (c, t->left->right, k, found);
+				t->left = rotateL (c, t->left);
 			}
-			res = rotateR (t);
+			res = rotateR (c, t);
 		}
 	} else { // k > key(t->value)
 		if (t->right == NULL) {
@@ -354,69 +548,220 @@ static Link searchSplay (Link t, Key k, int *found)
 			// res = rotateLeft(t);
 			res = t;
 		} else if (eq (key (t->right->value), k)) {
-            t->within->ncompares++;
+            c->ncompares++;
 			*found = 1;
-			res = rotateL (t);
+			res = rotateL (c, t);
 		} else {
 			if (less (key (t->right->value), k)) {
-                t->within->ncompares++;
+                c->ncompares++;
 				/* right-right */
 				t->right->right =
-					searchSplay (t->right->right, k, found);
-				t = rotateL (t);
+					searchSplay (c, t->right->right, k, found);
+				t = rotateL (c, t);
 			} else {
-                t->within->ncompares++;
+                c->ncompares++;
 				/* right-left */
-				t->right->left = searchSplay (t->right->left, k, found);
-				t->right = rotateR (t->right);
+				t->right->left = searchSplay (c, t->right->left, k, found);
+				t->right = rotateR (c, t->right);
 			}
-			res = rotateL (t);
+			res = rotateL (c, t);
 		}
 	}
 	return res;
 }
 
+// Interface: the i'th smallest item in a Tree, counting from 0
+Item TreeSelect (Tree t, int i)
+{
+	assert (0 <= i && i < size (t->root));
+	Link curr = t->root;
+	for (;;) {
+		int n = size (curr->left);
+		if (i == n)
+			return curr->value;
+		if (i < n) {
+			curr = curr->left;
+		} else {
+			i -= n + 1;
+			curr = curr->right;
+		}
+	}
+}
+
+// Interface: how many keys in a Tree are less than k
+int TreeRank (Tree t, Key k)
+{
+	Ctx c = { .tree = t };
+	int rank = 0;
+	Link curr = t->root;
+	while (curr != NULL) {
+		int diff = cmp (k, key (curr->value));
+		c.ncompares++;
+		if (diff <= 0) {
+			if (diff == 0) {
+				rank += size (curr->left);
+				break;
+			}
+			curr = curr->left;
+		} else {
+			rank += size (curr->left) + 1;
+			curr = curr->right;
+		}
+	}
+	tally (&c);
+	return rank;
+}
+
+// Interface: call visit on each item with lo <= key <= hi, in key order
+void TreeRange (Tree t, Key lo, Key hi, void (*visit) (Item, void *), void *cl)
+{
+	TreeIterRep it;
+	iterStart (&it, t, lo, hi);
+	for (Link n = iterNext (&it); n != NULL; n = iterNext (&it))
+		visit (n->value, cl);
+	if (it.stack != it.local) free (it.stack);
+}
+
+// Interface: iterator over the items with lo <= key <= hi
+TreeIter newTreeIter (Tree t, Key lo, Key hi)
+{
+	TreeIterRep *new = malloc (sizeof *new);
+	if (new == NULL) err (EX_OSERR, "couldn't allocate TreeIter");
+	iterStart (new, t, lo, hi);
+	return new;
+}
+
+// Interface: free memory associated with TreeIter
+void dropTreeIter (TreeIter it)
+{
+	if (it == NULL) return;
+	if (it->stack != it->local) free (it->stack);
+	free (it);
+}
+
+// Interface: are there items left?
+int TreeIterHasNext (TreeIter it)
+{
+	return it->top > 0 && ! less (it->hi, key (it->stack[it->top - 1]->value));
+}
+
+// Interface: the next item, in key order
+Item TreeIterNext (TreeIter it)
+{
+	assert (TreeIterHasNext (it));
+	return iterNext (it)->value;
+}
+
+// Helper: stack the path to the first key >= lo; only the nodes where
+// the path goes left are kept, as the ones it goes right from are < lo
+static void iterStart (TreeIterRep *it, Tree t, Key lo, Key hi)
+{
+	it->hi = hi;
+	it->stack = it->local;
+	it->top = 0;
+	it->max = ITER_LOCAL;
+	if (less (hi, lo)) return;
+	Ctx c = { .tree = t };
+	Link curr = t->root;
+	while (curr != NULL) {
+		c.ncompares++;
+		if (less (key (curr->value), lo)) {
+			curr = curr->right;
+		} else {
+			iterPush (it, curr);
+			curr = curr->left;
+		}
+	}
+	tally (&c);
+}
+
+// Helper: push a node, growing the stack if a tree is very deep
+static void iterPush (TreeIterRep *it, Link n)
+{
+	if (it->top == it->max) {
+		Link *bigger = malloc (2 * (size_t) it->max * sizeof (Link));
+		if (bigger == NULL) err (EX_OSERR, "couldn't allocate TreeIter stack");
+		memcpy (bigger, it->stack, (size_t) it->top * sizeof (Link));
+		if (it->stack != it->local) free (it->stack);
+		it->stack = bigger;
+		it->max *= 2;
+	}
+	it->stack[it->top++] = n;
+}
+
+// Helper: pop the next node in key order, then stack the leftmost path
+// of its right subtree; NULL once past hi
+static Link iterNext (TreeIterRep *it)
+{
+	if (it->top == 0) return NULL;
+	Link n = it->stack[--it->top];
+	if (less (it->hi, key (n->value))) {
+		it->top = 0;
+		return NULL;
+	}
+	for (Link curr = n->right; curr != NULL; curr = curr->left)
+		iterPush (it, curr);
+	return n;
+}
+
 // Interface: delete a value from a Tree
 void TreeDelete (Tree t, Key k)
 {
-	t->root = delete (t->root, k);
+	Ctx c = { .tree = t };
+	if (t->insert == InsertAVL) {
+		t->root = deleteAVL (&c, t->root, k);
+	} else if (t->insert == InsertRedBlack) {
+		// the top-down colour moves assume k is in the tree
+		if (search (&c, t->root, k) != NULL) {
+			if (! isRed (t->root->left) && ! isRed (t->root->right))
+				t->root->red = 1;
+			t->root = deleteRedBlack (&c, t->root, k);
+			if (t->root != NULL) t->root->red = 0;
+		}
+	} else {
+		t->root = delete (&c, t->root, k);
+	}
+	tally (&c);
 }
 
 // Helper: recursive delete
-static Link delete (Link t, Key k)
+static Link delete (Ctx *c, Link t, Key k)
 {
 	if (t == NULL)
 		return NULL;
 	int diff = cmp (k, t->value);
-	t->within->ncompares++;
-	if (diff == 0)
-		t = deleteRoot (t);
-	else if (diff < 0)
-		t->left = delete (t->left, k);
-	else if (diff > 0)
-		t->right = delete (t->right, k);
+	c->ncompares++;
+	if (diff == 0) {
+		t = deleteRoot (c, t);
+	} else if (diff < 0) {
+		t->left = delete (c, t->left, k);
+		fixNode (t);
+	} else if (diff > 0) {
+		t->right = delete (c, t->right, k);
+		fixNode (t);
+	}
 	return t;
 }
 
 // Helper: delete root of tree
-static Link deleteRoot (Link t)
+static Link deleteRoot (Ctx *c, Link t)
 {
 	Link newRoot;
 	// if no subtrees, tree empty after delete
 	if (t->left == NULL && t->right == NULL) {
-		free (t);
+		freeNode (c->tree, t);
 		return NULL;
 	}
 	// if only right subtree, make it the new root
 	else if (t->left == NULL && t->right != NULL) {
 		newRoot = t->right;
-		free (t);
+		freeNode (c->tree, t);
 		return newRoot;
 	}
 	// if only left subtree, make it the new root
 	else if (t->left != NULL && t->right == NULL) {
 		newRoot = t->left;
-		free (t);
+		freeNode (c->tree, t);
 		return newRoot;
 	}
 	// else (t->left != NULL && t->right != NULL)
@@ -429,62 +774,205 @@ static Link deleteRoot (Link t)
 		succ = succ->left;
 	}
 	int succVal = succ->value;
-	t = delete (t, succVal);
+	t = delete (c, t, succVal);
 	t->value = succVal;
 	return t;
 }
 
+// Helper: delete from an AVL tree, rebalancing on the way back up
+static Link deleteAVL (Ctx *c, Link t, Key k)
+{
+	if (t == NULL)
+		return NULL;
+	int diff = cmp (k, key (t->value));
+	c->ncompares++;
+	if (diff < 0) {
+		t->left = deleteAVL (c, t->left, k);
+	} else if (diff > 0) {
+		t->right = deleteAVL (c, t->right, k);
+	} else if (t->left == NULL || t->right == NULL) {
+		Link child = (t->left != NULL) ? t->left : t->right;
+		freeNode (c->tree, t);
+		return child;
+	} else {
+		// two subtrees: take the inorder successor's value
+		Link succ = t->right;
+		while (succ->left != NULL)
+			succ = succ->left;
+		t->value = succ->value;
+		t->right = deleteAVL (c, t->right, key (succ->value));
+	}
+	return balanceAVL (c, t);
+}
+
+// Helper: delete k (which is in the tree) from a red-black tree, pushing
+// a red link down ahead of it so that the node removed is never a 2-node
+static Link deleteRedBlack (Ctx *c, Link t, Key k)
+{
+	c->ncompares++;
+	if (less (k, key (t->value))) {
+		if (! isRed (t->left) && ! isRed (t->left->left))
+			t = moveRedLeft (c, t);
+		t->left = deleteRedBlack (c, t->left, k);
+	} else {
+		if (isRed (t->left))
+			t = rotateRRB (c, t);
+		c->ncompares++;
+		if (eq (k, key (t->value)) && t->right == NULL) {
+			freeNode (c->tree, t);
+			return NULL;
+		}
+		if (! isRed (t->right) && ! isRed (t->right->left))
+			t = moveRedRight (c, t);
+		c->ncompares++;
+		if (eq (k, key (t->value))) {
+			// take the inorder successor's value
+			Link succ = t->right;
+			while (succ->left != NULL)
+				succ = succ->left;
+			t->value = succ->value;
+			t->right = deleteMinRB (c, t->right);
+		} else {
+			t->right = deleteRedBlack (c, t->right, k);
+		}
+	}
+	return fixUpRB (c, t);
+}
+
+// Helper: delete the smallest node of a red-black tree
+static Link deleteMinRB (Ctx *c, Link t)
+{
+	if (t->left == NULL) {
+		freeNode (c->tree, t);
+		return NULL;
+	}
+	if (! isRed (t->left) && ! isRed (t->left->left))
+		t = moveRedLeft (c, t);
+	t->left = deleteMinRB (c, t->left);
+	return fixUpRB (c, t);
+}
+
+// Helper: make t->left or one of its children red
+static Link moveRedLeft (Ctx *c, Link t)
+{
+	flipColours (t);
+	if (isRed (t->right->left)) {
+		t->right = rotateRRB (c, t->right);
+		t = rotateLRB (c, t);
+		flipColours (t);
+	}
+	return t;
+}
+
+// Helper: make t->right or one of its children red
+static Link moveRedRight (Ctx *c, Link t)
+{
+	flipColours (t);
+	if (isRed (t->left->left)) {
+		t = rotateRRB (c, t);
+		flipColours (t);
+	}
+	return t;
+}
+
+// Helper: restore left-leaning red-black shape at t on the way up
+static Link fixUpRB (Ctx *c, Link t)
+{
+	fixNode (t);
+	if (isRed (t->right) && ! isRed (t->left))
+		t = rotateLRB (c, t);
+	if (isRed (t->left) && isRed (t->left->left))
+		t = rotateRRB (c, t);
+	if (isRed (t->left) && isRed (t->right))
+		flipColours (t);
+	return t;
+}
+
+static int isRed (Link t)
+{
+	return t != NULL && t->red;
+}
+
+// Helper: split or join a 4-node
+static void flipColours (Link t)
+{
+	t->red = ! t->red;
+	t->left->red = ! t->left->red;
+	t->right->red = ! t->right->red;
+}
+
+// Helpers: rotations that keep the link colours with their positions
+static Link rotateLRB (Ctx *c, Link t)
+{
+	Link new = rotateL (c, t);
+	new->red = t->red;
+	t->red = 1;
+	return new;
+}
+
+static Link rotateRRB (Ctx *c, Link t)
+{
+	Link new = rotateR (c, t);
+	new->red = t->red;
+	t->red = 1;
+	return new;
+}
+
 // Helper: rebalance tree by moving median to root
-static Link rebalance (Link t)
+static Link rebalance (Ctx *c, Link t)
 {
 	if (t == NULL) return NULL;
 	if (size (t) < 2) return t;
 	// put node with median key at root
-	t = partition (t, size (t) / 2);
+	t = partition (c, t, size (t) / 2);
 	// then rebalance each subtree
-	t->left = rebalance (t->left);
-	t->right = rebalance (t->right);
+	t->left = rebalance (c, t->left);
+	t->right = rebalance (c, t->right);
 	return t;
 }
 
 // Helper: move i'th element to root
-static Link partition (Link t, int i)
+static Link partition (Ctx *c, Link t, int i)
 {
 	if (t == NULL) return NULL;
 	assert (0 <= i && i < size (t));
 	int n = size (t->left);
 	if (i < n) {
-		t->left = partition (t->left, i);
-		t = rotateR (t);
+		t->left = partition (c, t->left, i);
+		t = rotateR (c, t);
 	}
 	if (i > n) {
-		t->right = partition (t->right, i - n - 1);
-		t = rotateL (t);
+		t->right = partition (c, t->right, i - n - 1);
+		t = rotateL (c, t);
 	}
 	return t;
 }
 
 // Helper: rotate tree left around root 
-static Link rotateL (Link n2)
+static Link rotateL (Ctx *c, Link n2)
 {
-    n2->within->nrotates++;
+    c->nrotates++;
 	if (n2 == NULL) return NULL;
 	Link n1 = n2->right;
 	if (n1 == NULL) return n2;
 	n2->right = n1->left;
 	n1->left = n2;
+	fixNode (n2);
+	fixNode (n1);
 	return n1; 
 }
 
 // Helper: rotate tree right around root
-static Link rotateR (Link n1)
+static Link rotateR (Ctx *c, Link n1)
 {
-    n1->within->nrotates++;
+    c->nrotates++;
 	if (n1 == NULL) return NULL;
 	Link n2 = n1->left;
 	if (n2 == NULL) return n1;
 	n1->left = n2->right;
 	n2->right = n1;
+	fixNode (n1);
+	fixNode (n2);
 	return n2;
 }
 
@@ -5,6 +5,12 @@
 #define BSTREE_H
 
 // client view of a Tree
+//
+// Different Trees can be used from different threads at once.  One Tree
+// can be read by many threads at once (TreeFind, except on a splay tree,
+// TreeSelect, TreeRank, TreeRange, TreeDepth, TreeNumNodes), but a change
+// to it must not overlap anything else; SyncTree.h wraps a Tree in a lock
+// that allows just that.
 typedef struct TreeRep *Tree;
 
 // kinds of insertion supported
@@ -14,14 +20,15 @@ typedef enum {
 	InsertRandom,
 	InsertRebalance,
 	InsertSplay,
-	InsertAVL
+	InsertAVL,
+	InsertRedBlack
 } Style;
 
 // Items and operations on Items
 typedef int Key;
 typedef Key Item; // item is just a key
 #define key(it) (it)
-#define cmp(k1, k2) ((k1) - (k2))
+#define cmp(k1, k2) (((k1) > (k2)) - ((k1) < (k2))) // no overflow, unlike k1 - k2
 #define less(k1, k2) (cmp (k1, k2) < 0)
 #define eq(k1, k2) (cmp (k1, k2) == 0)
 
@@ -29,6 +36,11 @@ typedef Key Item; // item is just a key
 
 // create an empty Tree
 Tree newTree (Style);
+// create an empty Tree that takes its nodes from a pool (see Pool.h),
+// instead of malloc; dropTree is then O(#slabs), not O(#nodes)
+Tree newPooledTree (Style);
+// build a balanced Tree from n items in ascending order, in O(n)
+Tree TreeBuildFromSorted (Style, Item *, int);
 // free memory associated with Tree
 void dropTree (Tree);
 // display a Tree + stats about Tree
@@ -40,9 +52,31 @@ void TreeInsert (Tree, Item);
 void TreeDelete (Tree, Key);
 // check whether a value is in a Tree
 int TreeFind (Tree, Key);
+// how values are inserted into Tree
+Style TreeStyle (Tree);
 // compute depth of Tree
 int TreeDepth (Tree);
 // count #nodes in Tree
 int TreeNumNodes (Tree);
+// the i'th smallest item in Tree (0 <= i < #nodes)
+Item TreeSelect (Tree, int);
+// count keys in Tree less than a given key
+int TreeRank (Tree, Key);
+// call a function on each item with lo <= key <= hi, in key order
+void TreeRange (Tree, Key lo, Key hi, void (*visit) (Item, void *), void *);
+
+// in-order iterator over a range of a Tree; each step takes amortised
+// O(1), with no allocation, and the iterator is invalid once the Tree
+// changes (TreeInsert, TreeDelete, and TreeFind on a splay tree)
+typedef struct TreeIterRep *TreeIter;
+
+// create an iterator over the items with lo <= key <= hi
+TreeIter newTreeIter (Tree, Key lo, Key hi);
+// free memory associated with TreeIter
+void dropTreeIter (TreeIter);
+// check whether there are items left
+int TreeIterHasNext (TreeIter);
+// the next item, in key order
+Item TreeIterNext (TreeIter);
 
 #endif
@@ -0,0 +1,232 @@
+// tgtree.c ... trees generated by GTree.h, for other types of key
+// Checks and times a tree of 64-bit keys, against the same tree calling
+// its comparison through a pointer to a function on void *, as a
+// qsort-style generic tree would; then a tree of strings, and one of
+// (word, count) records keyed by their word.
+
+#include <err.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <time.h>
+
+// 64-bit keys, over their whole range, where k1 - k2 would overflow
+#define GTREE_NAME LongTree
+#define GTREE_ITEM int64_t
+#include "GTree.h"
+
+// ... and compared through a pointer, for comparison
+static int cmpLong (const void *, const void *);
+static int (*volatile cmpFn) (const void *, const void *) = cmpLong;
+#define GTREE_NAME LongFnTree
+#define GTREE_ITEM int64_t
+#define GTREE_CMP(k1, k2) cmpFn (&(k1), &(k2))
+#include "GTree.h"
+
+// strings, which the tree copies and frees
+#define GTREE_NAME StrTree
+#define GTREE_ITEM char *
+#define GTREE_CMP(k1, k2) strcmp ((k1), (k2))
+#define GTREE_COPY(s) strdup (s)
+#define GTREE_FREE(s) free (s)
+#include "GTree.h"
+
+// records, looked up by their word
+typedef struct Count {
+	char *word;
+	int count;
+} Count;
+
+#define GTREE_NAME CountTree
+#define GTREE_ITEM Count
+#define GTREE_KEY const char *
+#define GTREE_KEYOF(c) ((c).word)
+#define GTREE_CMP(k1, k2) strcmp ((k1), (k2))
+#define GTREE_FREE(c) free ((c).word)
+#include "GTree.h"
+
+static void usage (void) __attribute__((noreturn));
+static int testLong (int64_t *, int);
+static int testStr (int64_t *, int);
+static int testCount (int);
+static void checkOrder (int64_t *, void *);
+static void sumCounts (Count *, void *);
+static uint64_t next (uint64_t *);
+static double since (struct timespec *);
+
+int main (int argc, char *argv[])
+{
+	if (! (2 <= argc && argc <= 3)) usage ();
+
+	// number of keys
+	int N = atoi (argv[1]);
+	if (N < 1 || N > 100000000) usage ();
+
+	// random number seed
+	int seed = argc >= 3 ? atoi (argv[2]) : 1234;
+
+	int64_t *keys = malloc ((size_t) N * sizeof (int64_t));
+	if (keys == NULL) err (EX_OSERR, "couldn't allocate keys");
+	uint64_t s = (uint64_t) seed * 1000003 + 1;
+	for (int i = 0; i < N; i++)
+		keys[i] = (int64_t) next (&s);
+
+	int ok = testLong (keys, N) & testStr (keys, N);
+	printf ("Trees of %d keys hold what they should; %s\n", N, ok ? "ok" : "not ok");
+	ok &= testCount (N);
+	free (keys);
+	return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// insert all the keys, find them all, then delete every other one
+static int testLong (int64_t *keys, int N)
+{
+	struct timespec t0;
+	int ok = 1;
+	printf ("%-11s %12s %12s %12s\n", "tree", "insert ns", "find ns", "delete ns");
+
+	LongTree t = newLongTree ();
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (int i = 0; i < N; i++)
+		LongTreeInsert (t, keys[i]);
+	double ins = since (&t0);
+	for (int i = 0; i < N; i++)
+		ok &= LongTreeFind (t, keys[i]) != NULL;
+	double find = since (&t0);
+	for (int i = 0; i < N; i += 2)
+		LongTreeDelete (t, keys[i]);
+	double del = since (&t0);
+	for (int i = 0; i < N; i++)
+		ok &= (LongTreeFind (t, keys[i]) != NULL) == (i % 2 == 1);
+	int64_t *prev = NULL;
+	LongTreeWalk (t, checkOrder, &prev);
+	ok &= prev != (int64_t *) 1 && LongTreeNumNodes (t) == N / 2;
+	dropLongTree (t);
+	printf ("%-11s %12.1f %12.1f %12.1f\n", "LongTree", ins / N, find / N, del / ((N + 1) / 2));
+
+	LongFnTree f = newLongFnTree ();
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (int i = 0; i < N; i++)
+		LongFnTreeInsert (f, keys[i]);
+	ins = since (&t0);
+	for (int i = 0; i < N; i++)
+		ok &= LongFnTreeFind (f, keys[i]) != NULL;
+	find = since (&t0);
+	for (int i = 0; i < N; i += 2)
+		LongFnTreeDelete (f, keys[i]);
+	del = since (&t0);
+	ok &= LongFnTreeNumNodes (f) == N / 2;
+	dropLongFnTree (f);
+	printf ("%-11s %12.1f %12.1f %12.1f\n", "LongFnTree", ins / N, find / N, del / ((N + 1) / 2));
+	return ok;
+}
+
+// the same, with the keys written out as strings
+static int testStr (int64_t *keys, int N)
+{
+	char (*words)[24] = malloc ((size_t) N * sizeof *words);
+	if (words == NULL) err (EX_OSERR, "couldn't allocate words");
+	for (int i = 0; i < N; i++)
+		snprintf (words[i], sizeof words[i], "%" PRId64, keys[i]);
+
+	struct timespec t0;
+	int ok = 1;
+	StrTree t = newPooledStrTree ();
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (int i = 0; i < N; i++)
+		StrTreeInsert (t, words[i]);
+	double ins = since (&t0);
+	for (int i = 0; i < N; i++)
+		ok &= StrTreeFind (t, words[i]) != NULL;
+	double find = since (&t0);
+	for (int i = 0; i < N; i += 2)
+		StrTreeDelete (t, words[i]);
+	double del = since (&t0);
+	for (int i = 0; i < N; i++)
+		ok &= (StrTreeFind (t, words[i]) != NULL) == (i % 2 == 1);
+	ok &= StrTreeNumNodes (t) == N / 2;
+	dropStrTree (t);
+	free (words);
+	printf ("%-11s %12.1f %12.1f %12.1f\n", "StrTree", ins / N, find / N, del / ((N + 1) / 2));
+	return ok;
+}
+
+// count N words drawn from 1000, in records
+static int testCount (int N)
+{
+	CountTree t = newCountTree ();
+	uint64_t s = 42;
+	char word[16];
+	for (int i = 0; i < N; i++) {
+		snprintf (word, sizeof word, "w%03d", (int) (next (&s) % 1000));
+		Count *c = CountTreeFind (t, word);
+		if (c != NULL)
+			c->count++;
+		else
+			CountTreeInsert (t, (Count) { .word = strdup (word), .count = 1 });
+	}
+	long total = 0;
+	CountTreeWalk (t, sumCounts, &total);
+	int ok = total == N && CountTreeNumNodes (t) <= 1000;
+	printf ("CountTree: %d distinct words, counts add up to %ld; %s\n",
+		CountTreeNumNodes (t), total, ok ? "ok" : "not ok");
+	dropCountTree (t);
+	return ok;
+}
+
+// a walk must visit keys in ascending order; marks prev as 1 if not
+static void checkOrder (int64_t *k, void *cl)
+{
+	int64_t **prev = cl;
+	if (*prev == (int64_t *) 1) return;
+	*prev = (*prev != NULL && **prev >= *k) ? (int64_t *) 1 : k;
+}
+
+static void sumCounts (Count *c, void *cl)
+{
+	*(long *) cl += c->count;
+}
+
+static int cmpLong (const void *a, const void *b)
+{
+	int64_t x = *(const int64_t *) a, y = *(const int64_t *) b;
+	return (x > y) - (x < y);
+}
+
+// xorshift64*, as in tsync.c
+static uint64_t next (uint64_t *s)
+{
+	*s ^= *s >> 12;
+	*s ^= *s << 25;
+	*s ^= *s >> 27;
+	return *s * 0x2545F4914F6CDD1DULL;
+}
+
+// ns since *t, which is then reset to now
+static double since (struct timespec *t)
+{
+	struct timespec now;
+	clock_gettime (CLOCK_MONOTONIC, &now);
+	double ns = (now.tv_sec - t->tv_sec) * 1e9 + (now.tv_nsec - t->tv_nsec);
+	*t = now;
+	return ns;
+}
+
+static void usage (void)
+{
+	// on Linux, libbsd provides `getprogname'.
+	const char *getprogname (void);
+
+	fprintf (
+		stderr,
+		"Usage: %s N Seed\n"
+		"1 <= N <= 100000000, Seed = a random number\n"
+		"Checks and times trees from GTree.h of N 64-bit keys, and of\n"
+		"the same keys as strings\n",
+		getprogname ()
+	);
+	exit (EX_USAGE);
+}
@@ -3,15 +3,22 @@
 // Written by John Shepherd, March 2013
 
 #include <err.h>
+#include <limits.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/wait.h>
 #include <sysexits.h>
+#include <time.h>
+#include <unistd.h>
 
+#include "FrozenTree.h"
 #include "Tree.h"
 
-// all values are in range 0000..9999
+// all values are in range 0000..9999, unless N is too big for that;
+// then random values are in range 0..4N-1
 #define RANGE 10000
+#define MAXN (INT_MAX / 4)
 
 static void usage (void) __attribute__((noreturn));
 static void mkprefix (int *, int, int, int);
@@ -19,8 +26,16 @@ static void mkuniq (int *, int);
 static int *makeValues (int, char, int);
 static Tree makeTree (int *, int, char);
 static void runTests (Tree, int *, int, char);
+static void showRange (Tree, int, int);
+static void timeRanges (Tree, int);
+static void countItem (Item, void *);
+static void timeAllocs (Style, int);
+static void churn (Style, int, bool);
+static void timeFinds (Tree, int);
+static long rssKiB (void);
 
 static int ix = 0; // used by mkprefix()
+static int range = RANGE; // values are less than this
 
 int main (int argc, char *argv[])
 {
@@ -28,7 +43,8 @@ int main (int argc, char *argv[])
 
 	// number of nodes in the tree
 	int N = atoi (argv[1]);
-	if (N < 0 || N >= RANGE) usage ();
+	if (N < 0 || N > MAXN) usage ();
+	if (N >= RANGE) range = 4 * N;
 
 	// order in which values are inserted
 	char order = argc >= 3 ? argv[2][0] : 'P';
@@ -74,6 +90,42 @@ int main (int argc, char *argv[])
 				printf ("Not found\n");
 			break;
 
+		case 'n':
+			if (0 <= value && value < TreeNumNodes (mytree))
+				printf ("%d\n", TreeSelect (mytree, value));
+			else
+				printf ("No such value\n");
+			break;
+
+		case 'r':
+			printf ("%d values less than %d\n", TreeRank (mytree, value), value);
+			break;
+
+		case 'g': {
+			int lo, hi;
+			if (sscanf (&line[1], "%d %d", &lo, &hi) == 2)
+				showRange (mytree, lo, hi);
+			else
+				printf ("Usage: g LO HI\n");
+			show = false;
+			break;
+		}
+
+		case 'w':
+			timeRanges (mytree, value);
+			show = false;
+			break;
+
+		case 'm':
+			timeAllocs (TreeStyle (mytree), value);
+			show = false;
+			break;
+
+		case 'z':
+			timeFinds (mytree, value);
+			show = false;
+			break;
+
 		case 's':
 			// nothing to do ... it's displayed below
 			break;
@@ -101,6 +153,12 @@ int main (int argc, char *argv[])
 			printf ("i N ... insert N into tree\n");
 			printf ("d N ... delete N from tree\n");
 			printf ("f N ... search for N in tree\n");
+			printf ("n N ... N'th smallest value in tree, from 0\n");
+			printf ("r N ... count values in tree less than N\n");
+			printf ("g L H . print values in tree from L to H\n");
+			printf ("w N ... time N range scans of each width\n");
+			printf ("m N ... time malloc'd vs pooled nodes, churning N values\n");
+			printf ("z N ... time N searches of tree vs frozen tree\n");
 			printf ("s   ... display tree if not big\n");
 			printf ("v   ... print values in tree\n");
 			printf ("t   ... run tests on tree\n");
@@ -127,7 +185,8 @@ int main (int argc, char *argv[])
 // run search tests on tree
 static void runTests (Tree t, int *values, int N, char order)
 {
-	Key not[RANGE];
+	Key *not = malloc (((size_t) N / 3 + 2) * sizeof (Key));
+	if (not == NULL) err (EX_OSERR, "couldn't allocate search values");
 
 	printf ("Tree search test\n");
 
@@ -154,7 +213,7 @@ static void runTests (Tree t, int *values, int N, char order)
 	{
 		int NN = 0;
 		not[NN++] = 0;
-		not[NN++] = RANGE;
+		not[NN++] = range;
 
 		int start, incr;
 		switch (order) {
@@ -165,16 +224,18 @@ static void runTests (Tree t, int *values, int N, char order)
 		default: usage ();
 		}
 
+		// mark the values in the tree, rather than search for each x
+		bool *in = calloc ((size_t) range + 1, sizeof (bool));
+		if (in == NULL) err (EX_OSERR, "couldn't allocate value map");
+		for (int i = 0; i < N; i++)
+			in[values[i]] = true;
+
 		int ok = 0;
 		for (int x = start; NN < N / 3; x += incr) {
-			int i;
-			for (i = 0; i < N; i++)
-				if (x == values[i])
-					break;
-
-			if (i == N) // x is not in tree
+			if (x < 0 || x > range || ! in[x]) // x is not in tree
 				not[NN++] = x;
 		}
+		free (in);
 
 		// search for values *not* in tree
 		for (int i = 0; i < NN; i++)
@@ -185,6 +246,157 @@ static void runTests (Tree t, int *values, int N, char order)
 		printf ("Found %d matches; ", NN - ok);
 		printf ("%s\n", (ok == NN) ? "ok" : "not ok");
 	}
+	free (not);
+}
+
+// print the values from lo to hi, with an iterator
+static void showRange (Tree t, int lo, int hi)
+{
+	int n = 0;
+	TreeIter it = newTreeIter (t, lo, hi);
+	while (TreeIterHasNext (it)) {
+		if (n % 15 == 0 && n > 0)
+			printf ("\n");
+		printf ("%d ", TreeIterNext (it));
+		n++;
+	}
+	dropTreeIter (it);
+	printf ("%s%d values from %d to %d\n", n > 0 ? "\n" : "", n, lo, hi);
+}
+
+// time nscans range scans at random places, for widths 1, 10, 100, ...
+static void timeRanges (Tree t, int nscans)
+{
+	if (nscans <= 0) nscans = 1000;
+	srand (0); // for consistency
+	printf ("%10s %10s %12s %10s %10s\n",
+		"width", "scans", "values", "ns/scan", "ns/value");
+	for (long width = 1; width <= range; width *= 10) {
+		long nvalues = 0;
+		struct timespec t0, t1;
+		clock_gettime (CLOCK_MONOTONIC, &t0);
+		for (int i = 0; i < nscans; i++) {
+			int lo = rand () % (range - (int) width + 1);
+			TreeRange (t, lo, lo + (int) width - 1, countItem, &nvalues);
+		}
+		clock_gettime (CLOCK_MONOTONIC, &t1);
+		double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+		printf ("%10ld %10d %12ld %10.1f %10.2f\n", width, nscans, nvalues,
+			ns / nscans, nvalues > 0 ? ns / nvalues : 0.0);
+	}
+}
+
+static void countItem (Item it, void *cl)
+{
+	(void) it;
+	(*(long *) cl)++;
+}
+
+// compare trees of this style with malloc'd and with pooled nodes
+static void timeAllocs (Style ins, int N)
+{
+	if (N <= 0) N = 1000000;
+	printf ("%-7s %10s %12s %12s %12s %12s\n",
+		"nodes", "values", "build ns/op", "churn ns/op", "drop ms", "RSS KiB");
+	churn (ins, N, false);
+	churn (ins, N, true);
+}
+
+// insert N random values into a new Tree, then N times delete one of
+// them and insert another, then drop it; in a child process, so that
+// its RSS is its own
+static void churn (Style ins, int N, bool pooled)
+{
+	fflush (stdout);
+	pid_t pid = fork ();
+	if (pid < 0) err (EX_OSERR, "couldn't fork");
+	if (pid > 0) {
+		waitpid (pid, NULL, 0);
+		return;
+	}
+
+	int *in = malloc ((size_t) N * sizeof (int));
+	if (in == NULL) err (EX_OSERR, "couldn't allocate values");
+	long rss = rssKiB ();
+	struct timespec t0, t1, t2, t3;
+	srand (0); // for consistency
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	Tree t = pooled ? newPooledTree (ins) : newTree (ins);
+	for (int i = 0; i < N; i++) {
+		in[i] = rand () % (4 * N);
+		TreeInsert (t, in[i]);
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	for (int i = 0; i < N; i++) {
+		int j = rand () % N;
+		TreeDelete (t, in[j]);
+		in[j] = rand () % (4 * N);
+		TreeInsert (t, in[j]);
+	}
+	clock_gettime (CLOCK_MONOTONIC, &t2);
+	rss = rssKiB () - rss;
+	int n = TreeNumNodes (t);
+	dropTree (t);
+	clock_gettime (CLOCK_MONOTONIC, &t3);
+
+#define NS(a, b) ((b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec))
+	printf ("%-7s %10d %12.1f %12.1f %12.2f %12ld\n", pooled ? "pool" : "malloc",
+		n, NS (t0, t1) / N, NS (t1, t2) / (2.0 * N), NS (t2, t3) / 1e6, rss);
+#undef NS
+	fflush (stdout);
+	_exit (EXIT_SUCCESS);
+}
+
+// time nfinds random searches of the Tree, then of a FrozenTree of it,
+// one at a time and in batches
+static void timeFinds (Tree t, int nfinds)
+{
+	if (nfinds <= 0) nfinds = 1000000;
+	Key *keys = malloc ((size_t) nfinds * sizeof (Key));
+	int *found = malloc ((size_t) nfinds * sizeof (int));
+	if (keys == NULL || found == NULL) err (EX_OSERR, "couldn't allocate search values");
+	srand (0); // for consistency
+	for (int i = 0; i < nfinds; i++)
+		keys[i] = rand () % range;
+
+	struct timespec t0, t1, t2, t3, t4;
+	int nTree = 0, nFrozen = 0, nMany = 0;
+	clock_gettime (CLOCK_MONOTONIC, &t0);
+	for (int i = 0; i < nfinds; i++)
+		nTree += TreeFind (t, keys[i]);
+	clock_gettime (CLOCK_MONOTONIC, &t1);
+	FrozenTree f = TreeFreeze (t);
+	clock_gettime (CLOCK_MONOTONIC, &t2);
+	for (int i = 0; i < nfinds; i++)
+		nFrozen += FrozenFind (f, keys[i]);
+	clock_gettime (CLOCK_MONOTONIC, &t3);
+	FrozenFindMany (f, keys, nfinds, found);
+	clock_gettime (CLOCK_MONOTONIC, &t4);
+	for (int i = 0; i < nfinds; i++)
+		nMany += found[i];
+	dropFrozenTree (f);
+	free (keys);
+	free (found);
+
+#define NS(a, b) ((b.tv_sec - a.tv_sec) * 1e9 + (b.tv_nsec - a.tv_nsec))
+	printf ("%-12s %10s %12s\n", "search", "found", "ns/search");
+	printf ("%-12s %10d %12.1f\n", "TreeFind", nTree, NS (t0, t1) / nfinds);
+	printf ("%-12s %10d %12.1f\n", "FrozenFind", nFrozen, NS (t2, t3) / nfinds);
+	printf ("%-12s %10d %12.1f\n", "FrozenMany", nMany, NS (t3, t4) / nfinds);
+	printf ("froze %d nodes in %.2f ms; %s\n", TreeNumNodes (t), NS (t1, t2) / 1e6,
+		nTree == nFrozen && nTree == nMany ? "ok" : "not ok");
+#undef NS
+}
+
+// resident set size of this process, from Linux's /proc
+static long rssKiB (void)
+{
+	long pages = 0, resident = 0;
+	FILE *f = fopen ("/proc/self/statm", "r");
+	if (f == NULL) return 0;
+	if (fscanf (f, "%ld %ld", &pages, &resident) != 2) resident = 0;
+	fclose (f);
+	return resident * (sysconf (_SC_PAGESIZE) / 1024);
 }
 
 // generate array of values to be inserted in tree
@@ -233,9 +445,31 @@ static Tree makeTree (int *values, int N, char style)
 	case 'B': ins = InsertRebalance; break;
 	case 'S': ins = InsertSplay; break;
 	case 'V': ins = InsertAVL; break;
+	case 'K': ins = InsertRedBlack; break;
 	default: usage ();
 	}
 
+	// big sorted inputs (orders A and D) are bulk loaded; small ones are
+	// still inserted one by one, to show what each style does with them
+	if (N >= RANGE) {
+		int up = 1, down = 1;
+		for (int i = 1; i < N; i++) {
+			if (values[i - 1] >= values[i]) up = 0;
+			if (values[i - 1] <= values[i]) down = 0;
+		}
+		if (up)
+			return TreeBuildFromSorted (ins, values, N);
+		if (down) {
+			int *sorted = malloc ((size_t) N * sizeof (int));
+			if (sorted == NULL) err (EX_OSERR, "couldn't allocate values");
+			for (int i = 0; i < N; i++)
+				sorted[i] = values[N - 1 - i];
+			Tree t = TreeBuildFromSorted (ins, sorted, N);
+			free (sorted);
+			return t;
+		}
+	}
+
 	Tree t = newTree (ins);
 	for (int i = 0; i < N; i++)
 		TreeInsert (t, values[i]);
@@ -253,13 +487,15 @@ static void mkprefix (int *v, int N, int lo, int hi)
 
 static void mkuniq (int *v, int N)
 {
-	bool already[RANGE] = {false};
+	bool *already = calloc ((size_t) range, sizeof (bool));
+	if (already == NULL) err (EX_OSERR, "couldn't allocate value map");
 	for (int i = 0; i < N; i++) {
-		int x = 1 + rand () % (RANGE - 1);
+		int x = 1 + rand () % (range - 1);
 		if (already[x]) { i--; continue; }
 		already[x] = true;
 		v[i] = x;
 	}
+	free (already);
 }
 
 static void usage (void)
@@ -270,12 +506,12 @@ static void usage (void)
 	fprintf (
 		stderr,
 		"Usage: %s N Order Insert Seed\n"
-		"0 <= N <= 9999, Seed = a random number\n"
+		"0 <= N <= %d, Seed = a random number\n"
 		"Order = Ascending|Descending|Prefix|Random\n"
-		"Insert = Leaf|At-root|reBalance|Random|Splay|aVl\n"
+		"Insert = Leaf|At-root|reBalance|Random|Splay|aVl|redblacK\n"
 		"For Order and Insert, use just the upper-case letter\n"
 		"e.g. for AVL, use V; for Rebalancing, use B\n",
-		getprogname ()
+		getprogname (), MAXN
 	);
 	exit (EX_USAGE);
 }
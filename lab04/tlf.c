@@ -0,0 +1,241 @@
+// tlf.c ... stress test and scaling benchmark for LFTree
+// First hammers a few keys from many threads and checks that what each
+// thread saw adds up; then, for several mixes of operations and 1, 2,
+// 4 ... threads, compares the throughput of an LFTree with a SyncTree
+
+#include <err.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sysexits.h>
+#include <time.h>
+
+#include "LFTree.h"
+#include "SyncTree.h"
+
+#define MAXTHREADS 1024
+#define STRESSKEYS 64 // few keys, so threads keep colliding
+#define STRESSOPS 200000 // per thread
+
+// percentages of finds and inserts; the rest are deletes
+typedef struct Mix {
+	int find, insert;
+} Mix;
+
+static const Mix mixes[] = { { 100, 0 }, { 90, 5 }, { 50, 25 } };
+#define NMIXES (sizeof mixes / sizeof mixes[0])
+
+typedef struct Worker {
+	LFTree lf; // one of these two is used
+	SyncTree sync;
+	int range; // keys are 0 .. range-1
+	Mix mix;
+	uint64_t seed;
+	long nops;
+	int *net; // for the stress test: inserts - deletes of each key
+} Worker;
+
+static void usage (void) __attribute__((noreturn));
+static int stressTest (int, int);
+static double run (LFTree, SyncTree, int, Mix, int, double, int);
+static void *stress (void *);
+static void *bench (void *);
+static void startAll (Worker *, int, void *(*) (void *));
+static uint64_t next (uint64_t *);
+
+static pthread_t tid[MAXTHREADS];
+static int stop = 0; // set when benchmark workers should finish
+
+int main (int argc, char *argv[])
+{
+	if (! (2 <= argc && argc <= 5)) usage ();
+
+	// number of items in the trees; keys are in 0 .. 2N-1
+	int N = atoi (argv[1]);
+	if (N < 1 || N > 500000000) usage ();
+
+	// most threads to try
+	int maxThreads = argc >= 3 ? atoi (argv[2]) : 64;
+	if (maxThreads < 1 || maxThreads > MAXTHREADS) usage ();
+
+	// seconds for each run
+	double secs = argc >= 4 ? atof (argv[3]) : 0.5;
+	if (secs <= 0) usage ();
+
+	// random number seed
+	int seed = argc >= 5 ? atoi (argv[4]) : 1234;
+
+	if (! stressTest (maxThreads, seed))
+		return EXIT_FAILURE;
+
+	// fill both trees with the even keys, in random order, as an LFTree
+	// is not rebalanced; the SyncTree is AVL
+	Item *values = malloc ((size_t) N * sizeof (Item));
+	if (values == NULL) err (EX_OSERR, "couldn't allocate values");
+	for (int i = 0; i < N; i++)
+		values[i] = 2 * i;
+	SyncTree sync = newSyncTree (TreeBuildFromSorted (InsertAVL, values, N));
+	uint64_t s = (uint64_t) seed * 1000003 + 1;
+	for (int i = N - 1; i > 0; i--) {
+		int j = (int) (next (&s) % (uint64_t) (i + 1));
+		Item tmp = values[i];
+		values[i] = values[j];
+		values[j] = tmp;
+	}
+	LFTree lf = newLFTree ();
+	for (int i = 0; i < N; i++)
+		LFTreeInsert (lf, values[i]);
+	free (values);
+
+	printf ("\n%8s %14s %14s %14s\n", "threads", "find/ins/del", "LFTree ops/s", "SyncTree ops/s");
+	for (size_t m = 0; m < NMIXES; m++) {
+		for (int n = 1; n <= maxThreads; n *= 2) {
+			double lfRate = run (lf, NULL, 2 * N, mixes[m], n, secs, seed);
+			double syncRate = run (NULL, sync, 2 * N, mixes[m], n, secs, seed);
+			printf ("%8d %8d/%d/%d %14.0f %14.0f\n", n, mixes[m].find, mixes[m].insert,
+				100 - mixes[m].find - mixes[m].insert, lfRate, syncRate);
+		}
+	}
+
+	dropLFTree (lf);
+	dropSyncTree (sync);
+	LFTreeQuiesce ();
+	return EXIT_SUCCESS;
+}
+
+// many threads insert and delete a few keys; the number of successful
+// inserts less deletes of each key must come out as 0 or 1, and say
+// whether it is in the tree at the end
+static int stressTest (int nthreads, int seed)
+{
+	LFTree t = newLFTree ();
+	Worker w[MAXTHREADS];
+	for (int i = 0; i < nthreads; i++) {
+		w[i] = (Worker) { .lf = t, .range = STRESSKEYS, .mix = { 20, 40 },
+			.seed = (uint64_t) seed * 7919 + i + 1 };
+		w[i].net = calloc (STRESSKEYS, sizeof (int));
+		if (w[i].net == NULL) err (EX_OSERR, "couldn't allocate counts");
+	}
+	startAll (w, nthreads, stress);
+
+	int ok = 1, n = 0;
+	for (int k = 0; k < STRESSKEYS; k++) {
+		int net = 0;
+		for (int i = 0; i < nthreads; i++)
+			net += w[i].net[k];
+		if (net != LFTreeFind (t, k) || (net != 0 && net != 1))
+			ok = 0;
+		n += net;
+	}
+	if (LFTreeNumNodes (t) != n)
+		ok = 0;
+	printf ("Stress test: %d threads, %d operations each on %d keys\n",
+		nthreads, STRESSOPS, STRESSKEYS);
+	printf ("%d keys left in tree; %s\n", n, ok ? "ok" : "not ok");
+
+	for (int i = 0; i < nthreads; i++)
+		free (w[i].net);
+	dropLFTree (t);
+	return ok;
+}
+
+static void *stress (void *arg)
+{
+	Worker *w = arg;
+	for (int i = 0; i < STRESSOPS; i++) {
+		uint64_t r = next (&w->seed);
+		Key k = (Key) (r % (uint64_t) w->range);
+		int op = (int) ((r >> 32) % 100);
+		if (op < w->mix.find)
+			LFTreeFind (w->lf, k);
+		else if (op < w->mix.find + w->mix.insert)
+			w->net[k] += LFTreeInsert (w->lf, k);
+		else
+			w->net[k] -= LFTreeDelete (w->lf, k);
+	}
+	return NULL;
+}
+
+// operations per second from nthreads threads for secs seconds
+static double run (LFTree lf, SyncTree sync, int range, Mix mix, int nthreads,
+	double secs, int seed)
+{
+	Worker w[MAXTHREADS];
+	for (int i = 0; i < nthreads; i++)
+		w[i] = (Worker) { .lf = lf, .sync = sync, .range = range, .mix = mix,
+			.seed = (uint64_t) seed * 104729 + i + 1 };
+	__atomic_store_n (&stop, 0, __ATOMIC_RELAXED);
+	for (int i = 0; i < nthreads; i++)
+		if (pthread_create (&tid[i], NULL, bench, &w[i]) != 0)
+			errx (EX_OSERR, "couldn't create thread");
+
+	struct timespec nap = { (time_t) secs, (long) ((secs - (time_t) secs) * 1e9) };
+	nanosleep (&nap, NULL);
+	__atomic_store_n (&stop, 1, __ATOMIC_RELAXED);
+
+	long nops = 0;
+	for (int i = 0; i < nthreads; i++) {
+		pthread_join (tid[i], NULL);
+		nops += w[i].nops;
+	}
+	return nops / secs;
+}
+
+// inserts and deletes are equally likely, so the size stays about N
+static void *bench (void *arg)
+{
+	Worker *w = arg;
+	while (! __atomic_load_n (&stop, __ATOMIC_RELAXED)) {
+		for (int i = 0; i < 64; i++) {
+			uint64_t r = next (&w->seed);
+			Key k = (Key) (r % (uint64_t) w->range);
+			int op = (int) ((r >> 32) % 100);
+			if (w->lf != NULL) {
+				if (op < w->mix.find) LFTreeFind (w->lf, k);
+				else if (op < w->mix.find + w->mix.insert) LFTreeInsert (w->lf, k);
+				else LFTreeDelete (w->lf, k);
+			} else {
+				if (op < w->mix.find) SyncTreeFind (w->sync, k);
+				else if (op < w->mix.find + w->mix.insert) SyncTreeInsert (w->sync, k);
+				else SyncTreeDelete (w->sync, k);
+			}
+		}
+		w->nops += 64;
+	}
+	return NULL;
+}
+
+static void startAll (Worker *w, int nthreads, void *(*work) (void *))
+{
+	for (int i = 0; i < nthreads; i++)
+		if (pthread_create (&tid[i], NULL, work, &w[i]) != 0)
+			errx (EX_OSERR, "couldn't create thread");
+	for (int i = 0; i < nthreads; i++)
+		pthread_join (tid[i], NULL);
+}
+
+// xorshift64*, so that threads don't share rand()'s state
+static uint64_t next (uint64_t *s)
+{
+	*s ^= *s >> 12;
+	*s ^= *s << 25;
+	*s ^= *s >> 27;
+	return *s * 0x2545F4914F6CDD1DULL;
+}
+
+static void usage (void)
+{
+	// on Linux, libbsd provides `getprogname'.
+	const char *getprogname (void);
+
+	fprintf (
+		stderr,
+		"Usage: %s N Threads Seconds Seed\n"
+		"1 <= N, 1 <= Threads <= %d, Seed = a random number\n"
+		"Stress tests an LFTree with Threads threads, then runs 1, 2, 4 ...\n"
+		"Threads threads on an LFTree and a SyncTree of N items, Seconds each\n",
+		getprogname (), MAXTHREADS
+	);
+	exit (EX_USAGE);
+}
@@ -0,0 +1,160 @@
+// tsync.c ... throughput of a SyncTree searched by many threads
+// Builds a tree, then for 1, 2, 4 ... reader threads runs the readers
+// searching it while one writer thread inserts and deletes values
+
+#include <err.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sysexits.h>
+#include <time.h>
+
+#include "SyncTree.h"
+
+#define MAXTHREADS 1024
+
+typedef struct Worker {
+	SyncTree tree;
+	int N;
+	uint64_t seed;
+	long nops; // finds, or inserts + deletes
+	long nwrong; // finds that gave the wrong answer
+} Worker;
+
+static void usage (void) __attribute__((noreturn));
+static void *reader (void *);
+static void *writer (void *);
+static uint64_t next (uint64_t *);
+
+static int stop = 0; // set when the workers should finish
+
+int main (int argc, char *argv[])
+{
+	if (! (2 <= argc && argc <= 6)) usage ();
+
+	// number of nodes in the tree
+	int N = atoi (argv[1]);
+	if (N < 1 || N > 500000000) usage ();
+
+	// most reader threads to try
+	int maxThreads = argc >= 3 ? atoi (argv[2]) : 4;
+	if (maxThreads < 1 || maxThreads > MAXTHREADS) usage ();
+
+	// seconds for each run
+	double secs = argc >= 4 ? atof (argv[3]) : 1.0;
+	if (secs <= 0) usage ();
+
+	// style of insertion
+	Style ins;
+	switch (argc >= 5 ? argv[4][0] : 'V') {
+	case 'L': ins = InsertAtLeaf; break;
+	case 'A': ins = InsertAtRoot; break;
+	case 'R': ins = InsertRandom; break;
+	case 'B': ins = InsertRebalance; break;
+	case 'S': ins = InsertSplay; break;
+	case 'V': ins = InsertAVL; break;
+	case 'K': ins = InsertRedBlack; break;
+	default: usage ();
+	}
+
+	// random number seed
+	int seed = argc >= 6 ? atoi (argv[5]) : 1234;
+
+	// the even values 0, 2 ... 2N-2 stay in the tree; the writer only
+	// inserts and deletes odd ones, so readers know what they should find
+	Item *values = malloc ((size_t) N * sizeof (Item));
+	if (values == NULL) err (EX_OSERR, "couldn't allocate values");
+	for (int i = 0; i < N; i++)
+		values[i] = 2 * i;
+	SyncTree tree = newSyncTree (TreeBuildFromSorted (ins, values, N));
+	free (values);
+
+	printf ("%8s %14s %14s %12s  %s\n",
+		"readers", "finds/sec", "per reader", "updates/sec", "check");
+	for (int nreaders = 1; nreaders <= maxThreads; nreaders *= 2) {
+		Worker w[MAXTHREADS + 1];
+		pthread_t tid[MAXTHREADS + 1];
+		__atomic_store_n (&stop, 0, __ATOMIC_RELAXED);
+		for (int i = 0; i <= nreaders; i++) {
+			w[i] = (Worker) { tree, N, (uint64_t) seed * 1000003 + i + 1, 0, 0 };
+			if (pthread_create (&tid[i], NULL, i < nreaders ? reader : writer, &w[i]) != 0)
+				errx (EX_OSERR, "couldn't create thread");
+		}
+
+		struct timespec nap = { (time_t) secs, (long) ((secs - (time_t) secs) * 1e9) };
+		nanosleep (&nap, NULL);
+		__atomic_store_n (&stop, 1, __ATOMIC_RELAXED);
+
+		long finds = 0, wrong = 0;
+		for (int i = 0; i <= nreaders; i++) {
+			pthread_join (tid[i], NULL);
+			if (i < nreaders) finds += w[i].nops;
+			wrong += w[i].nwrong;
+		}
+		if (SyncTreeNumNodes (tree) != N) wrong++;
+		printf ("%8d %14.0f %14.0f %12.0f  %s\n", nreaders,
+			finds / secs, finds / secs / nreaders, w[nreaders].nops / secs,
+			wrong == 0 ? "ok" : "not ok");
+	}
+
+	dropSyncTree (tree);
+	return EXIT_SUCCESS;
+}
+
+// search for random values, at least half of them in the tree
+static void *reader (void *arg)
+{
+	Worker *w = arg;
+	while (! __atomic_load_n (&stop, __ATOMIC_RELAXED)) {
+		for (int i = 0; i < 64; i++) {
+			Key k = (Key) (next (&w->seed) % (2 * (uint64_t) w->N));
+			// an odd value may be there for a moment, an even one always
+			if (! SyncTreeFind (w->tree, k) && k % 2 == 0)
+				w->nwrong++;
+		}
+		w->nops += 64;
+	}
+	return NULL;
+}
+
+// insert a random odd value, then delete it again
+static void *writer (void *arg)
+{
+	Worker *w = arg;
+	while (! __atomic_load_n (&stop, __ATOMIC_RELAXED)) {
+		Key k = (Key) (next (&w->seed) % (uint64_t) w->N) * 2 + 1;
+		SyncTreeInsert (w->tree, k);
+		if (! SyncTreeFind (w->tree, k))
+			w->nwrong++;
+		SyncTreeDelete (w->tree, k);
+		w->nops += 2;
+	}
+	return NULL;
+}
+
+// xorshift64*, so that threads don't share rand()'s state
+static uint64_t next (uint64_t *s)
+{
+	*s ^= *s >> 12;
+	*s ^= *s << 25;
+	*s ^= *s >> 27;
+	return *s * 0x2545F4914F6CDD1DULL;
+}
+
+static void usage (void)
+{
+	// on Linux, libbsd provides `getprogname'.
+	const char *getprogname (void);
+
+	fprintf (
+		stderr,
+		"Usage: %s N Threads Seconds Insert Seed\n"
+		"1 <= N, 1 <= Threads <= %d, Seed = a random number\n"
+		"Runs 1, 2, 4 ... Threads readers and one writer, Seconds each\n"
+		"Insert = Leaf|At-root|reBalance|Random|Splay|aVl|redblacK\n"
+		"use just the upper-case letter, e.g. for AVL, use V\n",
+		getprogname (), MAXTHREADS
+	);
+	exit (EX_USAGE);
+}
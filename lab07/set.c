@@ -1,5 +1,7 @@
-// set.c ... simple, inefficient Set of Strings
+// set.c ... simple Set of Strings
 // Written by John Shepherd, September 2015
+// The strings are kept in a balanced tree generated by GTree.h, with
+// strcmp inlined, rather than in a sorted list.
 
 #include <assert.h>
 #include <err.h>
@@ -10,36 +12,34 @@
 
 #include "set.h"
 
-#define strEQ(s, t) (strcmp ((s), (t)) == 0)
-#define strLT(s, t) (strcmp ((s), (t)) < 0)
-
-typedef struct Node *Link;
-
-typedef struct Node {
-	char *val;
-	Link next;
-} Node;
+#define GTREE_NAME StrTree
+#define GTREE_ITEM char *
+#define GTREE_CMP(s, t) strcmp ((s), (t))
+#define GTREE_COPY(s) strdup (s)
+#define GTREE_FREE(s) free (s)
+#include "GTree.h"
 
 typedef struct SetRep {
-	int nelems;
-	Link elems;
+	StrTree elems;
 } SetRep;
 
 // Function signatures
 
-static Link newNode (char *);
-static void dropNode (Link);
-static int findNode (Link, char *, Link *, Link *);
+static Set wrap (StrTree);
+static void showElem (char **, void *);
 
 // newSet()
 // - create an initially empty Set
 Set newSet (void)
 {
-	Set new = malloc (sizeof *new);
-	if (new == NULL)
-		err (EX_OSERR, "couldn't allocate Set");
-	*new = (SetRep){.nelems = 0, .elems = NULL};
-	return new;
+	return wrap (newStrTree ());
+}
+
+// newPooledSet()
+// - create an initially empty Set, whose nodes come from a Pool
+Set newPooledSet (void)
+{
+	return wrap (newPooledStrTree ());
 }
 
 // dropSet(Set)
@@ -48,13 +48,7 @@ void dropSet (Set s)
 {
 	if (s == NULL)
 		return;
-	Link curr = s->elems;
-	while (curr != NULL) {
-		Link next = curr->next;
-		dropNode (curr);
-		curr = next;
-	}
-
+	dropStrTree (s->elems);
 	free (s);
 }
 
@@ -63,22 +57,7 @@ void dropSet (Set s)
 void insertInto (Set s, char *str)
 {
 	assert (s != NULL);
-	Link curr, prev;
-	int found = findNode (s->elems, str, &curr, &prev);
-	if (found)
-		return; // already in Set
-
-	Link new = newNode (str);
-	s->nelems++;
-	if (prev == NULL) {
-		// add at start of list of elems
-		new->next = s->elems;
-		s->elems = new;
-	} else {
-		// add into list of elems
-		new->next = prev->next;
-		prev->next = new;
-	}
+	StrTreeInsert (s->elems, str);
 }
 
 // dropFrom(Set,Str)
@@ -86,16 +65,7 @@ void insertInto (Set s, char *str)
 void dropFrom (Set s, char *str)
 {
 	assert (s != NULL);
-	Link curr, prev;
-	int found = findNode (s->elems, str, &curr, &prev);
-	if (!found)
-		return;
-	s->nelems--;
-	if (prev == NULL)
-		s->elems = curr->next;
-	else
-		prev->next = curr->next;
-	dropNode (curr);
+	StrTreeDelete (s->elems, str);
 }
 
 // isElem(Set,Str)
@@ -103,8 +73,7 @@ void dropFrom (Set s, char *str)
 int isElem (Set s, char *str)
 {
 	assert (s != NULL);
-	Link curr, prev;
-	return findNode (s->elems, str, &curr, &prev);
+	return StrTreeFind (s->elems, str) != NULL;
 }
 
 // nElems(Set)
@@ -112,59 +81,35 @@ int isElem (Set s, char *str)
 int nElems (Set s)
 {
 	assert (s != NULL);
-	return s->nelems;
+	return StrTreeNumNodes (s->elems);
 }
 
 // showSet(Set)
 // - display Set (for debugging)
 void showSet (Set s)
 {
-	Link curr;
-	if (s->nelems == 0)
+	if (nElems (s) == 0)
 		printf ("Set is empty\n");
 	else {
-		printf ("Set has %d elements:\n", s->nelems);
+		printf ("Set has %d elements:\n", nElems (s));
 		int id = 0;
-		curr = s->elems;
-		while (curr != NULL) {
-			printf ("[%03d] %s\n", id, curr->val);
-			id++;
-			curr = curr->next;
-		}
+		StrTreeWalk (s->elems, showElem, &id);
 	}
 }
 
 // Helper functions
 
-static Link newNode (char *str)
+static Set wrap (StrTree elems)
 {
-	Link new = malloc (sizeof (Node));
-	assert (new != NULL);
-	new->val = strdup (str);
-	new->next = NULL;
+	Set new = malloc (sizeof *new);
+	if (new == NULL)
+		err (EX_OSERR, "couldn't allocate Set");
+	*new = (SetRep){.elems = elems};
 	return new;
 }
 
-static void dropNode (Link curr)
+static void showElem (char **str, void *cl)
 {
-	assert (curr != NULL);
-	free (curr->val);
-	free (curr);
-}
-
-// findNode(L,Str)
-// - finds where Str could be added into L
-// - if already in L, curr->val == Str
-// - if not already in L, curr and prev indicate where to insert
-// - return value indicates whether Str found or not
-static int findNode (Link list, char *str, Link *cur, Link *pre)
-{
-	Link curr = list, prev = NULL;
-	while (curr != NULL && strLT (curr->val, str)) {
-		prev = curr;
-		curr = curr->next;
-	}
-	*cur = curr;
-	*pre = prev;
-	return (curr != NULL && strEQ (str, curr->val));
+	int *id = cl;
+	printf ("[%03d] %s\n", (*id)++, *str);
 }
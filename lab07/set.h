@@ -9,6 +9,7 @@ typedef struct SetRep *Set;
 // Function signatures
 
 Set newSet (void);
+Set newPooledSet (void);
 void dropSet (Set);
 void insertInto (Set, char *);
 void dropFrom (Set, char *);